@@ -5,6 +5,13 @@
 #include "quic_helpers.h"
 #include "path_algo.h"
 #include "camera_task.h"
+#include "abr.h"
+#include "stripe.h"
+#include "path_sched.h"
+#include "path_table.h"
+#include "mloop.h"
+#include "netmon.h"
+#include "race.h"
 
 /* ============================================================
  * [1] 연결 상태 및 콜백 이벤트 처리
@@ -25,6 +32,7 @@ static void on_cb_event(picoquic_call_back_event_t ev, tx_t* st, picoquic_cnx_t*
             st->ready_ts_us = picoquic_current_time();
             st->hs_done_ts = picoquic_current_time();
             LOGF("[CB] handshake complete → ready");
+            ptab_seed(cnx, st, picoquic_current_time());
             break;
 
         case picoquic_callback_close:
@@ -48,9 +56,18 @@ static int client_cb(
     picoquic_call_back_event_t ev, void* ctx,
     void* stream_ctx
 ){
-    (void)stream_id; (void)bytes; (void)length; (void)stream_ctx;
-    
     tx_t* st = (tx_t*)ctx;
+
+    /* JIT 송신: picoquic이 패킷을 만들 때 active 스트림 데이터를 요청 */
+    if (st && ev == picoquic_callback_prepare_to_send) {
+        return jit_prepare_to_send(cnx, st, stream_id, bytes, length, stream_ctx);
+    }
+
+    /* 경로 이벤트: 경로 테이블만 갱신 (stream_id = unique_path_id) */
+    if (st && ptab_on_event(cnx, st, ev, stream_id)) {
+        return 0;
+    }
+
     if (st) {
         on_cb_event(ev, st, cnx);
     }
@@ -78,6 +95,10 @@ static int loop_cb(
     /* 0. 기본 상태 확인 */
     if (!st || !c) return 0;
 
+    /* 시작 경쟁 중에는 후보 연결만 돌리고, 이긴 연결을 st->cnx로 씀 */
+    if (st->race.n && race_poll(st, now)) return 0;
+    c = st->cnx;
+
     picoquic_state_enum cs = picoquic_get_cnx_state(c);
     
     /* 연결이 끊어지는 중이거나 이미 종료된 경우 루프 종료 */
@@ -95,13 +116,14 @@ static int loop_cb(
 
     /* 1. 미검증 경로(unreached path) 보호 */
     /* Address Validation이 완료되지 않은 경로의 메트릭이 알고리즘에 영향을 주지 않도록 무효화합니다. */
+    /* 하트비트(PATH_CHALLENGE) 응답을 기다리는 경로는 검증이 잠시 풀린 것뿐이므로 그대로 둡니다. */
     for (int i = 0; i < c->nb_paths; i++) {
 
         picoquic_path_t* p = c->path[i];
 
         if (!p || !p->first_tuple) continue;
 
-        if (!p->first_tuple->challenge_verified) {
+        if (!p->first_tuple->challenge_verified && !hb_inflight(st, c, i)) {
             p->smoothed_rtt = UINT64_MAX/2;
             p->rtt_min      = UINT64_MAX/2;
             p->receive_rate_estimate = 0;
@@ -148,6 +170,12 @@ static int loop_cb(
         st->didC = 1;
     }
 
+    /* 인터페이스 감시 이벤트: 새 주소는 바로 probe, 사라진 주소의 경로는 바로 abandon */
+    netmon_poll(c, st, now);
+
+    /* 설정된 추가 인터페이스(--path)도 경로를 열고 검증을 유지 */
+    sched_probe_roles(c, st, now);
+
 
     /* 4. Keep-alive 송신 (검증된 모든 경로 대상) */
     /* 1초마다 모든 유효 경로에 짧은 데이터를 보내 연결 유지를 확인합니다. */
@@ -169,48 +197,37 @@ static int loop_cb(
     }
 
 
-    /* 5. 카메라 프레임 수집 (스레드 안전) */
-    /* 카메라 스레드가 캡처한 최신 데이터를 뮤텍스 락을 사용하여 복사해옵니다. */
-    int cam_len = 0;
-    uint64_t cam_seq = 0;
+    /* 전달 기한이 지난 프레임은 재전송하지 않고 버림 (프레임별 스트림은 reset) */
+    jit_expire(c, st);
 
-    pthread_mutex_lock(&st->cam_mtx);
-    cam_len = st->cam_len;
-    cam_seq = st->cam_seq;
+    /* 5. 카메라 프레임 수집 (lock-free 우편함) */
+    /* 새 프레임이 있으면 소비자 슬롯으로 교환만 하고, 슬롯 데이터를 복사 없이 그대로 전송합니다. */
+    const mb_slot_t* fr = mb_acquire(&st->cam_mb);
 
     /* 새 프레임이 없거나 데이터가 없는 경우 대기 */
-    if (cam_seq == st->last_sent_seq || cam_len <= 0) {
-        pthread_mutex_unlock(&st->cam_mtx);
+    if (!fr || fr->len == 0) {
         picoquic_set_app_wake_time(c, now + 5000);
         return 0;
     }
 
-    /* 수집용 버퍼 크기가 작으면 재할당(Realloc) */
-    if (st->cap_cap < (size_t)cam_len) {
-        uint8_t* tmp = realloc(st->cap_buf, cam_len);
-
-        if (!tmp) { 
-            pthread_mutex_unlock(&st->cam_mtx); 
-            return 0; 
-        }
+    int cam_len = (int)fr->len;
+    st->last_sent_seq = fr->seq;
 
-        st->cap_buf = tmp;
-        st->cap_cap = cam_len;
+    /* H.264: 참조가 끊긴 AU는 다음 IDR까지 보내지 않음 (JPEG은 항상 통과) */
+    if (!au_gate(st, fr)) {
+        picoquic_set_app_wake_time(c, now + 5000);
+        return 0;
     }
 
-    /* 공유 버퍼의 데이터를 전송용 버퍼로 복사 */
-    memcpy(st->cap_buf, st->cam_buf, cam_len);
-    st->last_sent_seq = cam_seq;
-    pthread_mutex_unlock(&st->cam_mtx);
-
-    /* 프레임 길이를 QUIC Varint로 인코딩하여 헤더 준비 */
-    size_t hlen = varint_enc(cam_len, st->lenb);
 
+    /* 경로별 품질 추정기 갱신 (표본 간격 20ms, 경로당 O(1)) + 하트비트 생존 감지 */
+    est_update(c, st, now);
+    hb_update(c, st, now);
 
     /* 6. 경로 필터링 및 미검증 경로 재검증 시도 */
     pathsel_t sel[MAX_PATHS];
     int sc = 0;
-    build_unique_verified_paths(c, sel, &sc);
+    build_unique_verified_paths(c, st, sel, &sc);
 
     if (sc == 0) {
         picoquic_set_app_wake_time(c, now + 20000);
@@ -233,7 +250,8 @@ static int loop_cb(
             }
         }
             
-        if (!in_sel && !p->first_tuple->challenge_verified) {
+        /* 하트비트 응답을 기다리는 경로는 이미 챌린지가 나가 있으므로 다시 킥하지 않음 */
+        if (!in_sel && !p->first_tuple->challenge_verified && !hb_inflight(st, c, i)) {
             kick_path_verification(c, st, i);
         }
     }
@@ -257,22 +275,29 @@ static int loop_cb(
 
 
     /* 8. 주 경로(PRIMARY) 선택 알고리즘 가동 */
-    /* Wi-Fi(wlan)를 우선하되 품질 열화 시 USB(핫스팟)로 전환합니다. */
-    int k = pick_primary_idx(
-        c, sel, sc,
-        st->ip_wlan_be, st->ip_usb_be,
-        &st->last_primary_idx,
-        now,
-        &st->last_switch_ts);
+    /* 설정된 정책(--sched)으로 고릅니다. 기본 priority는 Wi-Fi(wlan)를 우선하되 품질 열화 시 USB(핫스팟)로 전환합니다. */
+    int k = sched_pick(c, st, sel, sc, now);
 
     /* 선택된 경로가 여전히 유효한지 확인하고 안되면 폴백 경로 선택 */
-    k = choose_verified_or_fallback(c, k);
+    k = choose_verified_or_fallback(c, st, k);
 
     if (k < 0) { 
         picoquic_set_app_wake_time(c, now + 20000); 
         return 0; 
     }
 
+    /* ABR: 선택된 경로의 용량으로 품질/해상도/프레임률 단계를 조정하고, 프레임률 제한에 걸리면 이번 프레임은 건너뜀 */
+    if (!abr_on_frame(&st->abr, c->path[k], k, (size_t)cam_len, now)) {
+        picoquic_set_app_wake_time(c, now + 5000);
+        return 0;
+    }
+
+    /* 송신 큐 허용: 경로 스트림에 이미 예산 이상 밀려 있으면 새 프레임을 쌓지 않고 건너뜀 (다음 차례엔 최신 프레임) */
+    if (!admit_frame(&st->admit, c, st->sid_per_path[k], k, jit_ahead_bytes(st, k), (size_t)cam_len, now)) {
+        picoquic_set_app_wake_time(c, now + 5000);
+        return 0;
+    }
+
     /* 후보 리스트 구성: 주 경로를 최우선으로, 나머지는 순차적 백업 */
     int candidates[MAX_PATHS];
     int cc = 0;
@@ -282,7 +307,7 @@ static int loop_cb(
         int idx = sel[i].idx;
         if (idx == k) continue;
 
-        if (path_sane_for_send(c, idx)) {
+        if (path_sane_for_send(c, st, idx) && !est_suspect(st, c, idx)) {
             candidates[cc++] = idx;
         }
     }
@@ -296,21 +321,43 @@ static int loop_cb(
 
     /* 9~11. 프레임 전송 (장애 시 즉시 우회) */
     /* 선택된 주 경로로 전송을 시도하고, 실패 시 다음 후보 경로로 즉시 넘어갑니다. */
-    int sent_ok = -1;
+    /* 우편함 슬롯 버퍼를 복사 없이 넘겨받아, picoquic이 패킷을 만들 때(prepare_to_send) 직접 읽게 합니다. */
+    tx_frame_t* tf = txf_take(st, fr);
+    if (!tf) {
+        picoquic_set_app_wake_time(c, now + 5000);
+        return 0;
+    }
 
-    for (int t = 0; t < cc; t++) {
+    int sent_ok = -1, done = 0;
+
+    /* 중복 전송: 경로 전환 중이거나 주 경로가 불확실하면 RTT가 가장 짧은 다른 경로로도 같은 프레임 (예산 내) */
+    int k2 = red_pick(c, st, k, candidates, cc, tf, now);
+    if (k2 >= 0) {
+        sent_ok = red_send(c, st, tf, k, k2);
+        done = 1;
+    }
+
+    /* 스트라이핑: 송신 가능한 경로가 둘 이상이면 프레임을 경로 속도에 맞춰 나눠 동시에 도착하게 보냄 */
+    stripe_chunk_t plan[MAX_PATHS];
+    int np = (!done && st->stripe && cc > 1) ? stripe_plan(c, st, candidates, cc, tf->len, plan) : 0;
+    if (np > 1) {
+        sent_ok = stripe_send(c, st, tf, plan, np);
+        done = 1;
+    }
+
+    for (int t = 0; !done && t < cc; t++) {
 
         int try_idx = candidates[t];
 
         /* 경로 상태가 건전하지 않으면 검증 패킷만 던지고 스킵 */
-        if (!path_sane_for_send(c, try_idx)) {
+        if (!path_sane_for_send(c, st, try_idx)) {
             static const uint8_t poke = 0x01;
             picoquic_add_to_stream_with_ctx(c, 0, &poke, 1, 0, st);
             continue;
         }
 
-        /* affinity(경로 고정)를 포함하여 실제 데이터 송신 */
-        int sr = send_on_path_safe(c, st, try_idx, st->lenb, hlen, st->cap_buf, cam_len);
+        /* affinity(경로 고정)를 포함하여 경로 스트림에 대기 (아직 안 나간 이전 프레임은 교체) */
+        int sr = send_frame_jit(c, st, try_idx, tf);
 
         if (sr == 0) {
             /* 전송 성공 시 주 경로 인덱스 업데이트 및 종료 */
@@ -318,13 +365,18 @@ static int loop_cb(
             sent_ok = 0;
             break;
         }
+        if (sr == -3) break;   /* 대기 중인 참조 프레임(H.264)은 교체할 수 없음: 이번 프레임 건너뜀 */
     }
+    txf_release(tf);
 
     if (sent_ok != 0) {
         picoquic_set_app_wake_time(c, now + 20000);
         return 0;
     }
 
+    /* 캡처 → 전송 지연은 마지막 바이트가 직렬화될 때 jit_prepare_to_send에서 계측 */
+    st->au_last_seq = fr->seq;
+
 
     /* 12. 네트워크 모니터링 로그 (1초 간격 리포트) */
     static uint64_t last_log_us = 0;
@@ -333,7 +385,42 @@ static int loop_cb(
     bytes_accum[k] += cam_len;
 
     if (now - last_log_us > ONE_SEC_US) {
-        LOGF("[MON] time=%.2fs paths=%d", now / 1e6, c->nb_paths);
+        LOGF("[MON] time=%.2fs paths=%d frame_seq=%" PRIu64 " cam_overwritten=%" PRIu64,
+             now / 1e6, c->nb_paths, st->last_sent_seq, mb_overwritten(&st->cam_mb));
+        if (st->abr.target_ms > 0) {
+            LOGF("[MON] abr level=%d pred=%.0fms cap=%.2fMbps skipped=%" PRIu64 " changes=%" PRIu64,
+                 st->abr.level, st->abr.pred_ms, st->abr.cap_Bps * 8 / 1e6, st->abr.skipped, st->abr.changes);
+        }
+        if (st->stream_per_frame) {
+            LOGF("[MON] frame streams=%" PRIu64 " open_fail=%" PRIu64 " replaced=%" PRIu64,
+                 st->frame_streams, st->stream_open_fail, st->jit_replaced);
+        }
+        if (st->stripe) {
+            LOGF("[MON] stripe frames=%" PRIu64 " chunks=%" PRIu64 " failed=%" PRIu64,
+                 st->stripe_frames, st->stripe_chunks, st->stripe_fail);
+        }
+        if (st->sched != SCHED_PRIORITY || st->nroles > 2 || st->path_events) {
+            LOGF("[MON] sched=%s primary=%d switches=%" PRIu64 " path_events=%" PRIu64,
+                 k_sched_names[st->sched], st->last_primary_idx, st->sched_switches, st->path_events);
+        }
+        if (st->hb_suspects) {
+            LOGF("[MON] heartbeat pings=%" PRIu64 " suspects=%" PRIu64, st->hb_pings, st->hb_suspects);
+        }
+        LOGF("[MON] sockets rx=%" PRIu64 "/%" PRIu64 " tx=%" PRIu64 "/%" PRIu64 " (pkts/calls) gso=%" PRIu64 " no_route=%" PRIu64 " drop=%" PRIu64,
+             st->mloop.rx_pkts, st->mloop.rx_calls, st->mloop.tx_pkts, st->mloop.tx_calls,
+             st->mloop.gso_sends, st->mloop.no_route, st->mloop.tx_drop);
+        if (st->netmon.events) {
+            LOGF("[MON] netmon events=%" PRIu64 " probes=%" PRIu64 " abandons=%" PRIu64 " dropped=%" PRIu64,
+                 st->netmon.events, st->netmon.probes, st->netmon.abandons, st->netmon.dropped);
+        }
+        if (st->red_pct > 0) {
+            LOGF("[MON] redundant frames=%" PRIu64 " no_budget=%" PRIu64 " credit=%.0fKB",
+                 st->red_frames, st->red_no_budget, st->red_credit_B / 1024.0);
+        }
+        if (st->expired || st->expired_unsent) {
+            LOGF("[MON] expired frames: reset=%" PRIu64 " unsent=%" PRIu64 " (deadline %" PRIu64 "ms)",
+                 st->expired, st->expired_unsent, st->deadline_us / 1000);
+        }
 
         for (int i = 0; i < c->nb_paths; i++) {
             picoquic_path_t* pp = c->path[i];
@@ -345,8 +432,11 @@ static int loop_cb(
                 lip, sizeof lip);
 
             double mbps = (bytes_accum[i] * 8.0) / 1e6;
-            LOGF("  path[%d] %s verified=%d %.2f Mb/s",
-                i, lip, pp->first_tuple->challenge_verified, mbps);
+            const path_est_t* e = est_of(st, c, i);
+            LOGF("  path[%d] %s verified=%d %.2f Mb/s rtt=%.1f±%.1fms loss=%.2f%% goodput=%.2fMb/s%s",
+                i, lip, pp->first_tuple->challenge_verified, mbps,
+                e ? e->rtt_ms : 0.0, e ? sqrt(e->rtt_var) : 0.0, e ? e->loss_pct : 0.0,
+                e ? e->goodput_Bps * 8.0 / 1e6 : 0.0, e && e->stale ? " STALE" : "");
 
             bytes_accum[i] = 0;
         }
@@ -372,10 +462,59 @@ int main(int argc, char** argv){
     const char* local_usb_ip  = "192.168.0.170";      // Wi-Fi (wlan0 등)
     int port = 4433;
 
-    if (argc > 1 && argv[1][0]) server_ip     = argv[1];
-    if (argc > 2 && argv[2][0]) local_alt_ip  = argv[2];
-    if (argc > 3 && argv[3][0]) port          = atoi(argv[3]);
-    if (argc > 4 && argv[4][0]) local_usb_ip  = argv[4];
+    /* --옵션은 먼저 분리하고, 나머지는 기존 위치 인자로 해석 */
+    const char* source = NULL;    /* 프레임 소스 (NULL: 카메라) */
+    int enc_workers = 0;          /* 인코딩 워커 수 (0: 자동) */
+    double abr_target_ms = ABR_TARGET_MS_DEFAULT;   /* 프레임 전달 목표 시간 (0: ABR 끔) */
+    double queue_budget_ms = ADMIT_BUDGET_MS_DEFAULT;   /* 송신 큐 대기 허용 시간 (0: 끔) */
+    const char* codec = NULL;     /* jpeg | h264 (NULL: CAM_CODEC 환경 변수) */
+    int gop = 0;                  /* H.264 키프레임 간격 (0: 기본 60) */
+    int bitrate_kbps = 0;         /* H.264 목표 비트레이트 (0: 기본 2000) */
+    const char* stream_mode = "path";   /* path: 경로별 장수 스트림 | frame: 프레임별 스트림 + FIN */
+    double deadline_ms = FRAME_DEADLINE_MS_DEFAULT;   /* 프레임 전달 기한 (0: 끔) */
+    int stripe = 0;               /* 1: 프레임을 검증된 경로들로 나눠 보냄 */
+    double red_pct = 0;           /* 중복 전송 추가 대역 예산 (%, 0: 끔) */
+    const char* sched_name = "priority";   /* 주 경로 선택 정책: priority | minrtt | wrr | cost */
+    const char* path_specs[MAX_PATHS];     /* --path IP[:PRIO[:COST]] (경로 역할) */
+    int npath_specs = 0;
+    double est_half_life_ms = EST_HALF_LIFE_MS_DEFAULT;   /* 경로 추정기 반감기 */
+    double heartbeat_ms = HB_IDLE_MS_DEFAULT;             /* 유휴 경로 하트비트 간격 (0: 끔) */
+    int use_gso = 1;              /* 1: 패킷 루프에서 UDP GSO/GRO 사용 */
+    int race = 0;                 /* 1: 시작 시 설정된 인터페이스마다 핸드셰이크 경쟁 */
+    double race_stagger_ms = 0;   /* 경쟁 후보 사이 시작 시차 (0: 동시에) */
+    const char* netmon_opt = "1";         /* 인터페이스 감시: 0 | 1 (설정된 IP) | auto (새 인터페이스도 채택) */
+    char* pos[8];
+    int npos = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--source") && i + 1 < argc) source = argv[++i];
+        else if (!strcmp(argv[i], "--enc-workers") && i + 1 < argc) enc_workers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--abr-target-ms") && i + 1 < argc) abr_target_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--queue-budget-ms") && i + 1 < argc) queue_budget_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--codec") && i + 1 < argc) codec = argv[++i];
+        else if (!strcmp(argv[i], "--gop") && i + 1 < argc) gop = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bitrate") && i + 1 < argc) bitrate_kbps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--stream-mode") && i + 1 < argc) stream_mode = argv[++i];
+        else if (!strcmp(argv[i], "--frame-deadline-ms") && i + 1 < argc) deadline_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--stripe") && i + 1 < argc) stripe = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--redundancy-pct") && i + 1 < argc) red_pct = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--sched") && i + 1 < argc) sched_name = argv[++i];
+        else if (!strcmp(argv[i], "--est-half-life-ms") && i + 1 < argc) est_half_life_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--heartbeat-ms") && i + 1 < argc) heartbeat_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--netmon") && i + 1 < argc) netmon_opt = argv[++i];
+        else if (!strcmp(argv[i], "--gso") && i + 1 < argc) use_gso = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--race") && i + 1 < argc) race = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--race-stagger-ms") && i + 1 < argc) race_stagger_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--path") && i + 1 < argc) {
+            if (npath_specs < MAX_PATHS) path_specs[npath_specs++] = argv[i + 1];
+            i++;
+        }
+        else if (npos < 8) pos[npos++] = argv[i];
+    }
+
+    if (npos > 0 && pos[0][0]) server_ip     = pos[0];
+    if (npos > 1 && pos[1][0]) local_alt_ip  = pos[1];
+    if (npos > 2 && pos[2][0]) port          = atoi(pos[2]);
+    if (npos > 3 && pos[3][0]) local_usb_ip  = pos[3];
 
     LOGF("[MAIN] args: server=%s port=%d alt=%s usb=%s",
          server_ip, port, local_alt_ip, local_usb_ip);
@@ -447,8 +586,27 @@ int main(int argc, char** argv){
     st.ip_wlan_be = inet_addr(local_usb_ip); 
     st.ip_usb_be  = inet_addr(local_alt_ip); 
     st.last_primary_idx = -1;
+
+    /* 경로 역할(우선순위/비용)과 주 경로 선택 정책 */
+    st.sched = sched_parse(sched_name);
+    for (int i = 0; i < npath_specs && st.sched >= 0; i++) {
+        if (role_add(&st, path_specs[i]) != 0) {
+            LOGF("[ERR] bad --path %s (IP[:PRIO[:COST]])", path_specs[i]);
+            picoquic_free(q);
+            return -1;
+        }
+    }
+    if (st.sched < 0) {
+        LOGF("[ERR] unknown --sched %s (priority|minrtt|wrr|cost)", sched_name);
+        picoquic_free(q);
+        return -1;
+    }
+    roles_finish(&st);
+    st.est_half_life_ms = est_half_life_ms > 0 ? est_half_life_ms : EST_HALF_LIFE_MS_DEFAULT;
+    st.hb_idle_us = heartbeat_ms > 0 ? (uint64_t)(heartbeat_ms * 1000.0) : 0;
     st.last_switch_ts   = 0;
-    pthread_mutex_init(&st.cam_mtx, NULL);
+    mb_init(&st.cam_mb);
+    st.pipe.n_enc = enc_workers;
 
     /* 로컬 주소 정보 저장 (Path Probing 시 사용) */
     if (!store_local_ip(local_alt_ip, 0, &st.local_alt)) {
@@ -464,8 +622,16 @@ int main(int argc, char** argv){
 
     /* 5. 콜백 등록 및 클라이언트 시작 */
     picoquic_set_callback(cnx, client_cb, &st);
+    ptab_enable(cnx);
+
+    /* 시작 경쟁: 설정된 인터페이스마다 초기 경로를 고정한 연결로 핸드셰이크 (후보 2개 이상일 때만) */
+    if (race) race_add_configured(&st);
+    int nrace = race ? race_start(q, &st, cnx, server_ip, "hq", client_cb, race_stagger_ms, picoquic_current_time()) : 0;
+    if (nrace > 0) {
+        LOGF("[MAIN] handshake race: %d interfaces, stagger=%.0fms", nrace, race_stagger_ms);
+    }
 
-    if (picoquic_start_client_cnx(cnx) != 0) {
+    if (nrace < 0 || (nrace == 0 && picoquic_start_client_cnx(cnx) != 0)) {
         LOGF("[ERR] start_client_cnx failed");
         picoquic_free(q);
         return -1;
@@ -473,42 +639,72 @@ int main(int argc, char** argv){
 
 
     /* 6. 카메라 및 캡처 스레드 시작 */
-    st.cam = camera_create();
+    st.cam = camera_open_codec(source, codec, gop, bitrate_kbps);
     if (!st.cam) {
-        LOGF("[ERR] camera_create failed");
+        LOGF("[ERR] frame source open failed (%s)", source ? source : "camera");
         picoquic_free(q);
         return -1;
     }
+    LOGF("[MAIN] camera backend=%s encoder=%s", camera_backend_name(st.cam),
+         camera_needs_encode(st.cam) ? camera_encoder_name() : "none(passthrough)");
+
+    abr_init(&st.abr, abr_target_ms, camera_needs_encode(st.cam));
+    admit_init(&st.admit, queue_budget_ms);
+    st.stream_per_frame = !strcmp(stream_mode, "frame");
+    st.deadline_us = deadline_ms > 0 ? (uint64_t)(deadline_ms * 1000.0) : 0;
+    st.stripe = stripe != 0;
+    st.red_pct = red_pct > 0 ? red_pct : 0;
+    LOGF("[MAIN] abr target=%.0fms (%s)", abr_target_ms,
+         abr_target_ms <= 0 ? "off" : camera_needs_encode(st.cam) ? "quality/scale/fps" : "fps only");
+    LOGF("[MAIN] send queue budget=%.0fms%s", queue_budget_ms, queue_budget_ms <= 0 ? " (off)" : "");
+    LOGF("[MAIN] stream mode=%s", st.stream_per_frame ? "frame (uni stream + FIN per frame)" : "path");
+    LOGF("[MAIN] frame deadline=%.0fms%s", deadline_ms, deadline_ms <= 0 ? " (off)" : "");
+    LOGF("[MAIN] intra-frame striping=%s", st.stripe ? "on" : "off");
+    LOGF("[MAIN] redundancy budget=%.0f%%%s", st.red_pct, st.red_pct <= 0 ? " (off)" : "");
+    LOGF("[MAIN] path scheduler=%s roles=%d (estimator half-life %.0fms)",
+         k_sched_names[st.sched], st.nroles, st.est_half_life_ms);
+    LOGF("[MAIN] heartbeat idle=%.0fms%s", heartbeat_ms, st.hb_idle_us ? "" : " (off)");
+    for (int i = 0; i < st.nroles; i++) {
+        struct in_addr ia = { .s_addr = st.roles[i].ip_be };
+        LOGF("[MAIN]   %-6s %s prio=%d cost=%.1f%s", st.roles[i].name, inet_ntoa(ia),
+             st.roles[i].prio, st.roles[i].cost, st.roles[i].probe ? " (probe)" : "");
+    }
+
+    /* 인터페이스 감시 시작 (netlink를 못 쓰면 기존 주기 probe만으로 동작) */
+    int nm_mode = !strcmp(netmon_opt, "auto") ? 2 : atoi(netmon_opt) != 0;
+    if (netmon_start(&st.netmon, nm_mode) != 0) {
+        LOGF("[WRN] netlink interface monitor unavailable, falling back to periodic probing");
+    }
+    LOGF("[MAIN] interface monitor=%s", st.netmon.mode == 2 ? "auto" : st.netmon.mode ? "on" : "off");
 
     if (pthread_create(&st.cam_thread, NULL, camera_thread_main, &st) == 0) {
         st.cam_thread_started = 1;
     }
 
 
-    /* 7. 메인 소켓 바인딩 (Wi-Fi NIC 강제 고정) */
+    /* 7. 인터페이스별 소켓 바인딩 (Wi-Fi 소켓이 첫 소켓 = 초기 경로) */
     LOGF("[MAIN] binding main socket to Wi-Fi NIC...");
 
     int sock_wlan = make_bound_socket(local_usb_ip, 55002);
+    int sock_alt  = st.has_local_alt ? make_bound_socket(local_alt_ip, 55001) : -1;
 
-    if (sock_wlan < 0) {
+    /* Wi-Fi가 없어도 다른 소켓이 있으면 진행 (시작 경쟁·인터페이스 감시가 나중에 Wi-Fi를 붙임) */
+    if ((sock_wlan < 0 && sock_alt < 0) || mloop_init(&st.mloop, use_gso != 0) != 0) {
         LOGF("[ERR] make_bound_socket failed");
         return -1;
     }
+    if (sock_wlan >= 0) mloop_add(&st.mloop, sock_wlan);
+    else LOGF("[WRN] Wi-Fi NIC bind failed, continuing on the other interface");
+    if (sock_alt >= 0) mloop_add(&st.mloop, sock_alt);
 
 
-    /* 8. 패킷 루프 파라미터 설정 */
-    picoquic_packet_loop_param_t lp;
-    memset(&lp, 0, sizeof(lp));
-
-    lp.local_af = AF_INET;
-    lp.extra_socket_required = 1;
-    lp.do_not_use_gso = 1;
-
+    /* 8. 패킷 루프: 경로의 로컬 주소로 소켓을 골라 보냄 (picoquic_packet_loop_v2 대신) */
+    LOGF("[MAIN] packet loop sockets: recvmmsg/sendmmsg x%d, gso=%s", MLOOP_BATCH, st.mloop.gso ? "on" : "off");
     LOGF("[MAIN] entering packet loop...");
 
 
     /* 9. 패킷 루프 실행 (picoquic 구동) */
-    int ret = picoquic_packet_loop_v2(q, &lp, loop_cb, &st);
+    int ret = mloop_run(q, &st.mloop, loop_cb, &st);
 
     LOGF("[MAIN] packet loop exit: ret=%d", ret);
 
@@ -518,14 +714,13 @@ int main(int argc, char** argv){
         st.cam_stop = 1;
         pthread_join(st.cam_thread, NULL);
     }
-
-    pthread_mutex_destroy(&st.cam_mtx);
+    netmon_stop(&st.netmon);
 
     if (st.cam) camera_destroy(st.cam);
-    if (st.cam_buf) free(st.cam_buf);
-    if (st.cap_buf) free(st.cap_buf);
+    mb_free(&st.cam_mb);
+    txf_free_all(&st);
 
-    if (sock_wlan > 0) close(sock_wlan);
+    mloop_close(&st.mloop);
     picoquic_free(q);
 
     LOGF("[MAIN] freed all, exit=%d", ret);
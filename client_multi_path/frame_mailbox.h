@@ -0,0 +1,167 @@
+#ifndef FRAME_MAILBOX_H
+#define FRAME_MAILBOX_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+/* ============================================================
+ * [1] 최신 프레임 우편함 (Lock-free Triple Buffer)
+ * ============================================================ */
+
+/*
+ * 캡처 스레드(생산자 1개)와 네트워크 루프(소비자 1개) 사이에서 "가장 최근 프레임"만 전달합니다.
+ *   - 슬롯 3개: 생산자 전용(back) / 교환용(mid) / 소비자 전용(front)
+ *   - 생산자는 back에 다 쓴 뒤 mid와 원자적으로 교환 → 절대 대기하지 않음
+ *   - 소비자는 새 프레임이 있을 때만 front와 mid를 교환 → 다음 교환 전까지 front는 안정적 (복사 불필요)
+ *   - 소비되지 않은 채 새 프레임으로 덮인 횟수는 overwritten에 집계
+ */
+
+#define MB_SLOTS     3
+#define MB_IDX_MASK  0x3u
+#define MB_FRESH     0x4u     /* mid 슬롯에 아직 소비되지 않은 프레임이 있음 */
+
+/**
+ * @brief 우편함 슬롯 하나 (소유자만 접근)
+ */
+typedef struct {
+    uint8_t* buf;
+    size_t   cap;
+    size_t   len;
+    uint64_t seq;             /* 발행 순번 (1부터) */
+    uint64_t ts_us;           /* 캡처 시각 (CLOCK_MONOTONIC, 0이면 미기록) */
+    int      key;             /* 단독 디코딩 가능 여부 (JPEG은 항상 1) */
+} mb_slot_t;
+
+typedef struct {
+    mb_slot_t slot[MB_SLOTS];
+    _Atomic unsigned mid;     /* 교환용 슬롯 인덱스 | MB_FRESH */
+    unsigned back;            /* 생산자 전용 */
+    unsigned front;           /* 소비자 전용 */
+
+    uint64_t next_seq;        /* 생산자 전용 */
+    _Atomic uint64_t published;     /* 발행된 프레임 수 */
+    _Atomic uint64_t overwritten;   /* 소비 전에 덮인(버려진) 프레임 수 */
+} frame_mailbox_t;
+
+
+/* ============================================================
+ * [2] 초기화 / 해제
+ * ============================================================ */
+
+static inline void mb_init(frame_mailbox_t* mb){
+    for (int i = 0; i < MB_SLOTS; i++) {
+        mb->slot[i].buf = NULL;
+        mb->slot[i].cap = mb->slot[i].len = 0;
+        mb->slot[i].seq = 0;
+        mb->slot[i].ts_us = 0;
+        mb->slot[i].key = 1;
+    }
+    mb->back  = 0;
+    atomic_init(&mb->mid, 1u);
+    mb->front = 2;
+    mb->next_seq = 0;
+    atomic_init(&mb->published, 0);
+    atomic_init(&mb->overwritten, 0);
+}
+
+static inline void mb_free(frame_mailbox_t* mb){
+    for (int i = 0; i < MB_SLOTS; i++) {
+        free(mb->slot[i].buf);
+        mb->slot[i].buf = NULL;
+        mb->slot[i].cap = 0;
+    }
+}
+
+
+/* ============================================================
+ * [3] 생산자 (캡처 스레드)
+ * ============================================================ */
+
+/**
+ * @brief 생산자가 채울 슬롯을 돌려줍니다. 용량이 need보다 작으면 확장합니다.
+ * @return 쓰기용 슬롯, 메모리 부족 시 NULL
+ */
+static inline mb_slot_t* mb_write_slot(frame_mailbox_t* mb, size_t need){
+    mb_slot_t* s = &mb->slot[mb->back];
+    if (s->cap < need) {
+        uint8_t* tmp = (uint8_t*)realloc(s->buf, need);
+        if (!tmp) return NULL;
+        s->buf = tmp;
+        s->cap = need;
+    }
+    return s;
+}
+
+/**
+ * @brief 다 쓴 슬롯을 발행합니다. (대기 없음)
+ */
+static inline void mb_publish(frame_mailbox_t* mb, size_t len){
+    mb_slot_t* s = &mb->slot[mb->back];
+    s->len = len;
+    s->seq = ++mb->next_seq;
+
+    unsigned prev = atomic_exchange_explicit(&mb->mid, mb->back | MB_FRESH, memory_order_acq_rel);
+    mb->back = prev & MB_IDX_MASK;
+
+    atomic_fetch_add_explicit(&mb->published, 1, memory_order_relaxed);
+    if (prev & MB_FRESH) atomic_fetch_add_explicit(&mb->overwritten, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief 생산자의 버퍼를 back 슬롯과 맞바꿔 발행합니다. (복사 없는 전달)
+ * 호출 후 *buf / *cap에는 이전 back 슬롯의 버퍼가 돌아오므로 다음 프레임에 재사용하면 됩니다.
+ */
+static inline void mb_publish_swap(frame_mailbox_t* mb, uint8_t** buf, size_t* cap,
+                                   size_t len, uint64_t ts_us, int key){
+    mb_slot_t* s = &mb->slot[mb->back];
+    uint8_t* b = s->buf;
+    size_t   c = s->cap;
+    s->buf = *buf;
+    s->cap = *cap;
+    s->ts_us = ts_us;
+    s->key = key;
+    *buf = b;
+    *cap = c;
+    mb_publish(mb, len);
+}
+
+
+/* ============================================================
+ * [4] 소비자 (네트워크 루프)
+ * ============================================================ */
+
+/**
+ * @brief 새 프레임이 있으면 소비자 슬롯으로 가져옵니다.
+ * 반환된 슬롯은 다음 mb_acquire 호출 전까지 생산자가 건드리지 않습니다.
+ * @return 새 프레임 슬롯, 새 프레임이 없으면 NULL
+ */
+static inline const mb_slot_t* mb_acquire(frame_mailbox_t* mb){
+    if (!(atomic_load_explicit(&mb->mid, memory_order_relaxed) & MB_FRESH)) return NULL;
+
+    unsigned prev = atomic_exchange_explicit(&mb->mid, mb->front, memory_order_acq_rel);
+    mb->front = prev & MB_IDX_MASK;
+    return &mb->slot[mb->front];
+}
+
+/**
+ * @brief 소비자 슬롯의 버퍼를 호출자 버퍼와 맞바꿔 가져옵니다. (mb_acquire 직후, 복사 없는 인수)
+ * 송신 쪽이 다음 mb_acquire 이후까지 프레임을 붙잡아야 할 때 씁니다. 슬롯에는 호출자의 빈 버퍼가 남고,
+ * 생산자는 발행 시 그 버퍼를 다시 맞바꿔 가져가므로 버퍼는 할당 없이 순환합니다.
+ */
+static inline void mb_take_front(frame_mailbox_t* mb, uint8_t** buf, size_t* cap){
+    mb_slot_t* s = &mb->slot[mb->front];
+    uint8_t* b = s->buf;
+    size_t   c = s->cap;
+    s->buf = *buf;
+    s->cap = *cap;
+    s->len = 0;
+    *buf = b;
+    *cap = c;
+}
+
+static inline uint64_t mb_overwritten(frame_mailbox_t* mb){
+    return atomic_load_explicit(&mb->overwritten, memory_order_relaxed);
+}
+
+#endif /* FRAME_MAILBOX_H */
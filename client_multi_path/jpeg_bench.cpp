@@ -0,0 +1,114 @@
+/*
+ * JPEG 인코더 마이크로벤치마크: libjpeg-turbo(재사용 압축기, 호출자 버퍼 직기록) vs cv::imencode
+ *
+ * 빌드:
+ *   g++ -O2 -DHAVE_LIBJPEG_TURBO jpeg_bench.cpp camera.cpp -o jpeg_bench \
+ *       $(pkg-config --cflags --libs opencv4) -ljpeg
+ *   다른 클라이언트 디렉토리에서는 ../client_multi_path/jpeg_bench.cpp를 그 디렉토리의 camera.cpp와 함께 빌드
+ * 실행:
+ *   ./jpeg_bench [이미지 파일|""] [반복 수]
+ *   이미지를 주지 않으면 그라디언트 + 잡음 합성 영상을 사용합니다. (실제 카메라 프레임을 주는 편이 정확)
+ */
+
+#include "camera.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/* ============================================================
+ * [1] 입력 영상
+ * ============================================================ */
+
+static const int k_res[][2] = { { 640, 480 }, { 1280, 720 }, { 1920, 1080 } };
+static const int k_quality[] = { 75, 90, 95 };
+
+/**
+ * @brief 카메라 영상과 비슷한 압축률이 나오도록 부드러운 그라디언트에 약한 잡음을 더한 영상을 만듭니다.
+ */
+static cv::Mat make_test_frame(int w, int h) {
+    cv::Mat img(h, w, CV_8UC3);
+    for (int y = 0; y < h; y++) {
+        cv::Vec3b* row = img.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < w; x++) {
+            row[x] = cv::Vec3b((uchar)(x * 255 / w), (uchar)(y * 255 / h), (uchar)(((x / 64) ^ (y / 64)) & 1 ? 200 : 60));
+        }
+    }
+    cv::Mat noise(h, w, CV_8UC3);
+    cv::randn(noise, cv::Scalar::all(0), cv::Scalar::all(6));
+    img += noise;
+    cv::GaussianBlur(img, img, cv::Size(3, 3), 0);
+    return img;
+}
+
+
+/* ============================================================
+ * [2] 측정
+ * ============================================================ */
+
+/**
+ * @brief 같은 프레임을 iters번 인코딩해 프레임당 중앙값(ms)과 결과 크기를 구합니다.
+ */
+static double bench_one(const cv::Mat& img, int iters, size_t* out_len) {
+    camera_frame_t f = {};
+    f.raw = new cv::Mat(img);
+    std::vector<double> ms;
+    ms.reserve(iters);
+
+    for (int i = 0; i < iters + 3; i++) {
+        f.ok = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        int n = camera_encode(&f);
+        auto t1 = std::chrono::steady_clock::now();
+        if (n <= 0) { camera_frame_release(&f); return -1.0; }
+        *out_len = (size_t)n;
+        if (i >= 3) ms.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());   /* 앞 3회는 워밍업 */
+    }
+    camera_frame_release(&f);
+
+    std::sort(ms.begin(), ms.end());
+    return ms[ms.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    cv::Mat src;
+    if (argc > 1 && argv[1][0]) {
+        src = cv::imread(argv[1], cv::IMREAD_COLOR);
+        if (src.empty()) { fprintf(stderr, "이미지를 읽을 수 없음: %s\n", argv[1]); return 1; }
+    }
+    int iters = argc > 2 ? atoi(argv[2]) : 50;
+    if (iters < 1) iters = 1;
+
+    const char* encoders[] = { "opencv", "libjpeg" };
+
+    printf("%-10s %-14s %4s %10s %8s %9s\n", "res", "encoder", "q", "ms/frame", "fps", "size(KB)");
+    for (const auto& r : k_res) {
+        cv::Mat img;
+        if (src.empty()) img = make_test_frame(r[0], r[1]);
+        else             cv::resize(src, img, cv::Size(r[0], r[1]));
+
+        for (int q : k_quality) {
+            double base = 0.0;
+            for (const char* name : encoders) {
+                if (camera_set_encoder(name) != 0) {
+                    printf("%4dx%-5d %-14s %4d %10s\n", r[0], r[1], name, q, "(미포함)");
+                    continue;
+                }
+                camera_jpeg_params_t p = { q, CAM_JPEG_420, 0, 100 };
+                camera_set_jpeg_params(&p);
+
+                size_t len = 0;
+                double ms = bench_one(img, iters, &len);
+                if (ms < 0) { printf("%4dx%-5d %-14s %4d %10s\n", r[0], r[1], camera_encoder_name(), q, "실패"); continue; }
+
+                printf("%4dx%-5d %-14s %4d %10.2f %8.1f %9.1f", r[0], r[1], camera_encoder_name(), q, ms, 1000.0 / ms, len / 1024.0);
+                if (base > 0) printf("   x%.2f", base / ms);
+                else          base = ms;
+                printf("\n");
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,386 @@
+#ifndef MLOOP_H
+#define MLOOP_H
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+#include "picoquic.h"
+#include "picoquic_internal.h"
+#include "picoquic_packet_loop.h"
+#include "struct_type.h"
+
+#ifndef SOL_UDP
+#  define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#  define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#  define UDP_GRO 104
+#endif
+
+/* ============================================================
+ * [1] 인터페이스별 소켓 관리
+ * ============================================================ */
+
+/*
+ * main은 make_bound_socket으로 NIC마다 소켓을 묶었지만 picoquic_packet_loop_v2는 자기 소켓을 따로 열어,
+ * NIC 고정은 효과가 없고 묶어 둔 소켓은 쓰이지 않았습니다. 이 루프가 인터페이스별 소켓을 직접 소유합니다.
+ *   - 송신: picoquic이 정한 경로 로컬 주소(addr_from)와 IP:포트가 같은 소켓 → IP가 같은 소켓 순으로 고름
+ *           (처음 보는 로컬 주소면 그 주소로 소켓을 새로 묶음, 주소가 없으면 첫 소켓)
+ *   - 수신: epoll로 모든 소켓을 기다리고, 받은 소켓의 바인딩 주소를 addr_to로 넘김
+ *   - recvmmsg / sendmmsg로 시스템 호출당 MLOOP_BATCH개, GSO/GRO면 한 묶음에 최대 64KB
+ */
+
+#define MLOOP_BATCH       16
+#define MLOOP_GSO_MAX     65535       /* GSO/GRO 묶음 최대 크기 */
+#define MLOOP_MAX_WAIT_US 10000       /* 할 일이 없어도 깨어나는 최대 간격 */
+#define MLOOP_RX_ROUNDS   4           /* 한 번 깰 때 소켓당 recvmmsg 최대 횟수 (송신 굶김 방지) */
+
+/**
+ * @brief 루프 상태를 초기화합니다.
+ * @return 0 성공, -1 epoll 생성 실패
+ */
+static inline int mloop_init(mloop_t* m, int gso){
+    memset(m, 0, sizeof(*m));
+    for (int i = 0; i < MAX_PATHS; i++) m->s[i].fd = -1;
+    m->gso  = gso;
+    m->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (m->epfd < 0) { perror("epoll_create1"); return -1; }
+    return 0;
+}
+
+/**
+ * @brief 바인딩된 UDP 소켓을 루프에 넘깁니다. (이후 소켓은 루프가 닫음)
+ * @return 소켓 칸 번호, -1 실패 (소켓은 닫힘)
+ */
+static inline int mloop_add(mloop_t* m, int fd){
+    int sl = -1;
+    for (int i = 0; i < MAX_PATHS; i++) {
+        if (m->s[i].fd < 0) { sl = i; break; }
+    }
+
+    socklen_t alen = sizeof(m->s[0].addr);
+    struct sockaddr_storage a;
+    memset(&a, 0, sizeof(a));
+    if (sl < 0 || getsockname(fd, (struct sockaddr*)&a, &alen) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    if (m->gso) {
+        int one = 1;
+        setsockopt(fd, SOL_UDP, UDP_GRO, &one, sizeof(one));
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = (uint32_t)sl };
+    if (epoll_ctl(m->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("epoll_ctl");
+        close(fd);
+        return -1;
+    }
+    m->s[sl].fd   = fd;
+    m->s[sl].addr = a;
+
+    struct sockaddr_in* la = (struct sockaddr_in*)&a;
+    LOGF("[SOCK] loop slot=%d %s:%d fd=%d", sl, inet_ntoa(la->sin_addr), ntohs(la->sin_port), fd);
+    return sl;
+}
+
+/**
+ * @brief 로컬 주소에 묶인 소켓을 찾고, 없으면 새로 묶어 루프에 넣습니다.
+ * @param ifname NULL이 아니면 SO_BINDTODEVICE로 장치까지 고정
+ * @return 소켓 칸 번호, -1 실패
+ */
+static inline int mloop_open(mloop_t* m, const struct sockaddr_storage* la, const char* ifname){
+    const struct sockaddr_in* a = (const struct sockaddr_in*)la;
+    for (int i = 0; i < MAX_PATHS; i++) {
+        const struct sockaddr_in* b = (const struct sockaddr_in*)&m->s[i].addr;
+        if (m->s[i].fd >= 0 && b->sin_addr.s_addr == a->sin_addr.s_addr && b->sin_port == a->sin_port) return i;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (ifname && ifname[0]) setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, ifname, strlen(ifname));
+    if (bind(fd, (const struct sockaddr*)a, sizeof(*a)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return mloop_add(m, fd);
+}
+
+/**
+ * @brief 사라진 로컬 IP의 소켓을 루프에서 빼고 닫습니다.
+ */
+static inline void mloop_drop_ip(mloop_t* m, uint32_t ip_be){
+    for (int i = 0; i < MAX_PATHS; i++) {
+        if (m->s[i].fd < 0 || ((struct sockaddr_in*)&m->s[i].addr)->sin_addr.s_addr != ip_be) continue;
+        epoll_ctl(m->epfd, EPOLL_CTL_DEL, m->s[i].fd, NULL);
+        close(m->s[i].fd);
+        m->s[i].fd = -1;
+    }
+}
+
+/**
+ * @brief 모든 소켓과 epoll을 닫습니다.
+ */
+static inline void mloop_close(mloop_t* m){
+    for (int i = 0; i < MAX_PATHS; i++) {
+        if (m->s[i].fd >= 0) close(m->s[i].fd);
+        m->s[i].fd = -1;
+    }
+    if (m->epfd >= 0) close(m->epfd);
+    m->epfd = -1;
+}
+
+/**
+ * @brief 경로 로컬 주소로 송신 소켓을 고릅니다.
+ * @return 소켓 칸 번호, -1 보낼 소켓 없음
+ */
+static inline int mloop_route(mloop_t* m, const struct sockaddr_storage* from){
+    const struct sockaddr_in* a = (const struct sockaddr_in*)from;
+    int unset = from->ss_family != AF_INET || a->sin_addr.s_addr == 0;
+    int first = -1, same_ip = -1;
+
+    for (int i = 0; i < MAX_PATHS; i++) {
+        if (m->s[i].fd < 0) continue;
+        if (first < 0) first = i;
+        if (unset) return first;
+
+        const struct sockaddr_in* b = (const struct sockaddr_in*)&m->s[i].addr;
+        if (b->sin_addr.s_addr != a->sin_addr.s_addr) continue;
+        if (b->sin_port == a->sin_port) return i;
+        if (same_ip < 0) same_ip = i;
+    }
+    if (unset) return first;
+
+    /* 처음 보는 로컬 주소 (--path 역할의 probe 등): 그 주소로 소켓을 묶고, 안 되면 IP가 같은 소켓 */
+    int sl = a->sin_port ? mloop_open(m, from, NULL) : -1;
+    return sl >= 0 ? sl : same_ip;
+}
+
+
+/* ============================================================
+ * [2] 묶음 수신 / 송신
+ * ============================================================ */
+
+/**
+ * @brief 소켓 하나에서 recvmmsg로 받은 데이터그램을 picoquic에 넘깁니다. (GRO 묶음은 세그먼트로 나눔)
+ * @return 받은 데이터그램 수, 0 이하 없음
+ */
+static inline int mloop_recv(picoquic_quic_t* q, mloop_t* m, int sl, uint8_t* buf, size_t bsz, uint64_t now){
+    struct mmsghdr msg[MLOOP_BATCH];
+    struct iovec iov[MLOOP_BATCH];
+    struct sockaddr_storage from[MLOOP_BATCH];
+    uint8_t ctl[MLOOP_BATCH][CMSG_SPACE(sizeof(int))];
+
+    memset(msg, 0, sizeof(msg));
+    for (int i = 0; i < MLOOP_BATCH; i++) {
+        iov[i].iov_base = buf + (size_t)i * bsz;
+        iov[i].iov_len  = bsz;
+        msg[i].msg_hdr.msg_name       = &from[i];
+        msg[i].msg_hdr.msg_namelen    = sizeof(from[i]);
+        msg[i].msg_hdr.msg_iov        = &iov[i];
+        msg[i].msg_hdr.msg_iovlen     = 1;
+        msg[i].msg_hdr.msg_control    = ctl[i];
+        msg[i].msg_hdr.msg_controllen = sizeof(ctl[i]);
+    }
+
+    int n = recvmmsg(m->s[sl].fd, msg, MLOOP_BATCH, MSG_DONTWAIT, NULL);
+    if (n <= 0) return n;
+    m->rx_calls++;
+
+    picoquic_cnx_t* last = NULL;
+    for (int i = 0; i < n; i++) {
+        size_t len = msg[i].msg_len;
+        size_t seg = len;
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg[i].msg_hdr); cm; cm = CMSG_NXTHDR(&msg[i].msg_hdr, cm)) {
+            if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+                int g;
+                memcpy(&g, CMSG_DATA(cm), sizeof(g));
+                if (g > 0) seg = (size_t)g;
+            }
+        }
+
+        uint8_t* b = (uint8_t*)iov[i].iov_base;
+        for (size_t off = 0; off < len; off += seg) {
+            size_t l = len - off < seg ? len - off : seg;
+            picoquic_incoming_packet_ex(q, b + off, l, (struct sockaddr*)&from[i],
+                                        (struct sockaddr*)&m->s[sl].addr, 0, 0, &last, now);
+            m->rx_pkts++;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief GSO를 못 쓰는 장치에서 묶음 하나를 세그먼트별로 나눠 보냅니다.
+ */
+static inline void mloop_send_split(mloop_t* m, int fd, const struct msghdr* h, size_t len, size_t seg){
+    const uint8_t* b = (const uint8_t*)h->msg_iov[0].iov_base;
+    for (size_t off = 0; off < len; off += seg) {
+        size_t l = len - off < seg ? len - off : seg;
+        if (sendto(fd, b + off, l, 0, (const struct sockaddr*)h->msg_name, h->msg_namelen) < 0) m->tx_drop++;
+        m->tx_calls++;
+    }
+}
+
+/**
+ * @brief 준비된 데이터그램을 같은 소켓끼리 이어서 sendmmsg로 보냅니다.
+ */
+static inline void mloop_flush(mloop_t* m, struct mmsghdr* msg, const int* slot_of, const size_t* seg_of, int n){
+    for (int i = 0; i < n;) {
+        int j = i;
+        while (j < n && slot_of[j] == slot_of[i]) j++;
+
+        int fd = m->s[slot_of[i]].fd;
+        for (int k = i; k < j;) {
+            int r = sendmmsg(fd, msg + k, (unsigned)(j - k), 0);
+            m->tx_calls++;
+            if (r > 0) { k += r; continue; }
+
+            /* 장치가 GSO를 거부하면(EIO) 끄고 이번 묶음은 나눠 보냄 */
+            if (errno == EIO && seg_of[k] > 0) {
+                m->gso = 0;
+                LOGF("[SOCK] UDP GSO rejected by device, sending per packet");
+                mloop_send_split(m, fd, &msg[k].msg_hdr, msg[k].msg_hdr.msg_iov[0].iov_len, seg_of[k]);
+                k++;
+                continue;
+            }
+            m->tx_drop += (uint64_t)(j - k);   /* EAGAIN 등: UDP라 버리고 QUIC 복구에 맡김 */
+            break;
+        }
+        i = j;
+    }
+}
+
+/**
+ * @brief picoquic이 보낼 패킷을 모두 만들어 경로의 로컬 주소에 맞는 소켓으로 보냅니다.
+ * @return picoquic_prepare_next_packet_ex 결과
+ */
+static inline int mloop_send(picoquic_quic_t* q, mloop_t* m, uint8_t* buf, size_t bsz, uint64_t now){
+    struct mmsghdr msg[MLOOP_BATCH];
+    struct iovec iov[MLOOP_BATCH];
+    struct sockaddr_storage to[MLOOP_BATCH];
+    uint8_t ctl[MLOOP_BATCH][CMSG_SPACE(sizeof(uint16_t))];
+    int slot_of[MLOOP_BATCH];
+    size_t seg_of[MLOOP_BATCH];
+
+    picoquic_cnx_t* last = NULL;
+    int n = 0, ret = 0;
+    memset(msg, 0, sizeof(msg));
+
+    for (;;) {
+        struct sockaddr_storage from;
+        picoquic_connection_id_t log_cid;
+        size_t len = 0, seg = 0;
+        int if_index = 0;
+        uint8_t* b = buf + (size_t)n * bsz;
+
+        ret = picoquic_prepare_next_packet_ex(q, now, b, m->gso ? bsz : PICOQUIC_MAX_PACKET_SIZE, &len,
+                                              &to[n], &from, &if_index, &log_cid, &last, m->gso ? &seg : NULL);
+        if (ret != 0 || len == 0) break;
+
+        int sl = mloop_route(m, &from);
+        if (sl < 0) { m->no_route++; continue; }
+
+        memset(&msg[n], 0, sizeof(msg[n]));
+        iov[n].iov_base = b;
+        iov[n].iov_len  = len;
+        msg[n].msg_hdr.msg_name    = &to[n];
+        msg[n].msg_hdr.msg_namelen = to[n].ss_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+        msg[n].msg_hdr.msg_iov     = &iov[n];
+        msg[n].msg_hdr.msg_iovlen  = 1;
+
+        seg_of[n] = 0;
+        if (seg > 0 && seg < len) {
+            struct cmsghdr* cm;
+            msg[n].msg_hdr.msg_control    = ctl[n];
+            msg[n].msg_hdr.msg_controllen = sizeof(ctl[n]);
+            cm = CMSG_FIRSTHDR(&msg[n].msg_hdr);
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type  = UDP_SEGMENT;
+            cm->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+            uint16_t s16 = (uint16_t)seg;
+            memcpy(CMSG_DATA(cm), &s16, sizeof(s16));
+            seg_of[n] = seg;
+            m->gso_sends++;
+            m->tx_pkts += (len + seg - 1) / seg;
+        } else {
+            m->tx_pkts++;
+        }
+        slot_of[n++] = sl;
+
+        if (n == MLOOP_BATCH) {
+            mloop_flush(m, msg, slot_of, seg_of, n);
+            n = 0;
+        }
+    }
+    if (n > 0) mloop_flush(m, msg, slot_of, seg_of, n);
+    return ret;
+}
+
+
+/* ============================================================
+ * [3] 패킷 루프
+ * ============================================================ */
+
+/**
+ * @brief picoquic_packet_loop_v2 대신 쓰는 멀티 소켓 패킷 루프입니다.
+ * loop_cb는 기존과 같이 ready / after_receive / after_send 시점에 불리며, 0이 아닌 값을 돌려주면 끝납니다.
+ * @return 0 정상 종료 (PICOQUIC_NO_ERROR_TERMINATE_PACKET_LOOP 포함), 그 외 오류
+ */
+static inline int mloop_run(picoquic_quic_t* q, mloop_t* m, picoquic_packet_loop_cb_fn cb, void* ctx){
+    size_t bsz = m->gso ? MLOOP_GSO_MAX : PICOQUIC_MAX_PACKET_SIZE;
+    uint8_t* rxb = (uint8_t*)malloc(bsz * MLOOP_BATCH);
+    uint8_t* txb = (uint8_t*)malloc(bsz * MLOOP_BATCH);
+    if (!rxb || !txb) {
+        free(rxb);
+        free(txb);
+        return -1;
+    }
+
+    int ret = cb(q, picoquic_packet_loop_ready, ctx, NULL);
+    struct epoll_event ev[MAX_PATHS];
+
+    while (ret == 0) {
+        uint64_t now   = picoquic_current_time();
+        int64_t  delay = picoquic_get_next_wake_delay(q, now, MLOOP_MAX_WAIT_US);
+        int n = epoll_wait(m->epfd, ev, MAX_PATHS, delay > 0 ? (int)((delay + 999) / 1000) : 0);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            ret = -1;
+            break;
+        }
+
+        now = picoquic_current_time();
+        int got = 0;
+        for (int i = 0; i < n; i++) {
+            int sl = (int)ev[i].data.u32;
+            for (int r = 0; r < MLOOP_RX_ROUNDS && m->s[sl].fd >= 0; r++) {
+                int k = mloop_recv(q, m, sl, rxb, bsz, now);
+                if (k > 0) got += k;
+                if (k < MLOOP_BATCH) break;
+            }
+        }
+        if (got > 0) {
+            ret = cb(q, picoquic_packet_loop_after_receive, ctx, NULL);
+            if (ret != 0) break;
+        }
+
+        ret = mloop_send(q, m, txb, bsz, picoquic_current_time());
+        if (ret == 0) ret = cb(q, picoquic_packet_loop_after_send, ctx, NULL);
+    }
+
+    free(rxb);
+    free(txb);
+    return ret == PICOQUIC_NO_ERROR_TERMINATE_PACKET_LOOP ? 0 : ret;
+}
+
+#endif
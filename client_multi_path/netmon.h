@@ -0,0 +1,281 @@
+#ifndef NETMON_H
+#define NETMON_H
+
+#include <stdint.h>
+#include <string.h>
+#include <poll.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include "picoquic.h"
+#include "picoquic_internal.h"
+#include "struct_type.h"
+#include "path_est.h"
+#include "path_sched.h"
+#include "mloop.h"
+
+/* ============================================================
+ * [1] RTNETLINK 감시 스레드
+ * ============================================================ */
+
+/*
+ * 로컬 인터페이스는 시작할 때 argv IP로 고정되고, 새 경로는 주기적인 재probe로만 찾았습니다.
+ * 감시 스레드가 NETLINK_ROUTE(RTMGRP_LINK | RTMGRP_IPV4_IFADDR)를 듣고 IPv4 주소/링크 변화를
+ * 단일 생산자 링으로 loop_cb에 넘깁니다. picoquic 호출은 모두 네트워크 스레드(loop_cb)에서만 합니다.
+ * 감시 스레드는 주소별 up/down 상태를 기억해 실제로 바뀔 때만 이벤트를 넘깁니다.
+ * (RTM_NEWLINK는 플래그가 바뀔 때마다 오며, 시작 시 주소 덤프는 상태만 채움 — auto 모드는 덤프 주소도 넘겨 채택)
+ *   - 주소 생김 / 링크 올라옴 (Wi-Fi 재연결) → 경로가 있으면 바로 챌린지(하트비트로 등록), 없으면 바로 probe_new_path
+ *     설정된 ALT/USB 역할을 여기서 probe했으면 핸드셰이크 후 지연 probe(didB/didC)는 건너뜀
+ *   - 주소 사라짐 / 링크 내려감 → 그 로컬 IP의 경로를 바로 abandon (다른 경로가 남아 있을 때만)
+ *   - --netmon auto: 설정에 없는 인터페이스의 주소도 가장 낮은 우선순위(비용 1) 역할로 채택
+ * 주소가 생기면 패킷 루프(mloop.h)에 netlink가 알려준 이름으로 SO_BINDTODEVICE 소켓을 묶고, 사라지면 닫습니다.
+ */
+
+#define NETMON_POLL_MS 200      /* 종료 플래그 확인 주기 */
+
+/**
+ * @brief 이벤트를 링에 넣습니다. (감시 스레드 전용, 가득 차면 버림)
+ */
+static inline void netmon_push(netmon_t* m, const netev_t* ev){
+    uint32_t h = atomic_load_explicit(&m->head, memory_order_relaxed);
+    uint32_t t = atomic_load_explicit(&m->tail, memory_order_acquire);
+    if (h - t >= NETEV_RING) { m->dropped++; return; }
+    m->ring[h & (NETEV_RING - 1)] = *ev;
+    atomic_store_explicit(&m->head, h + 1, memory_order_release);
+}
+
+/**
+ * @brief 이벤트를 링에서 꺼냅니다. (loop_cb 전용)
+ * @return 1 꺼냄, 0 비었음
+ */
+static inline int netmon_pop(netmon_t* m, netev_t* out){
+    uint32_t t = atomic_load_explicit(&m->tail, memory_order_relaxed);
+    uint32_t h = atomic_load_explicit(&m->head, memory_order_acquire);
+    if (t == h) return 0;
+    *out = m->ring[t & (NETEV_RING - 1)];
+    atomic_store_explicit(&m->tail, t + 1, memory_order_release);
+    return 1;
+}
+
+/* 감시 스레드가 아는 IPv4 주소와 마지막으로 넘긴 상태 (링크 변화 때 그 인터페이스의 주소들로 이벤트를 만듦) */
+typedef struct { int ifindex; uint32_t ip_be; int up; } netmon_addr_t;
+
+static void netmon_emit(netmon_t* m, int ifindex, uint32_t ip_be, int up){
+    netev_t ev = { .ip_be = ip_be, .up = up, .ifindex = ifindex };
+    if (!if_indextoname((unsigned)ifindex, ev.ifname)) ev.ifname[0] = 0;
+    netmon_push(m, &ev);
+}
+
+/**
+ * @brief 주소 표를 갱신하고, 주소의 상태가 실제로 바뀌었을 때만 이벤트를 넣습니다.
+ * @param emit 0이면 표만 갱신 (시작 시 덤프)
+ */
+static void netmon_on_addr(netmon_t* m, netmon_addr_t* tab, int ifindex, uint32_t ip_be, int up, int emit){
+    int slot = -1, fr = -1;
+    for (int i = 0; i < MAX_PATHS; i++) {
+        if (tab[i].ip_be == ip_be && tab[i].ifindex == ifindex) slot = i;
+        if (fr < 0 && tab[i].ip_be == 0) fr = i;
+    }
+
+    if (up) {
+        if (slot >= 0 || fr < 0) return;          /* 이미 아는 주소 (RTM_NEWADDR 갱신 알림) */
+        tab[fr] = (netmon_addr_t){ ifindex, ip_be, 1 };
+    } else {
+        if (slot < 0) return;
+        int was_up = tab[slot].up;
+        tab[slot].ip_be = 0;
+        if (!was_up) return;                      /* 링크가 내려갈 때 이미 down을 넘김 */
+    }
+    if (emit) netmon_emit(m, ifindex, ip_be, up);
+}
+
+/**
+ * @brief netlink 메시지 묶음을 해석합니다. (RTM_NEWADDR/DELADDR, RTM_NEWLINK/DELLINK)
+ */
+static void netmon_parse(netmon_t* m, netmon_addr_t* tab, const uint8_t* buf, int len){
+    for (const struct nlmsghdr* nh = (const struct nlmsghdr*)buf; NLMSG_OK(nh, (unsigned)len); nh = NLMSG_NEXT(nh, len)) {
+        if (nh->nlmsg_type == NLMSG_DONE || nh->nlmsg_type == NLMSG_ERROR) break;
+        int dump = (nh->nlmsg_flags & NLM_F_MULTI) != 0;   /* 시작 시 RTM_GETADDR 덤프 응답 */
+
+        if (nh->nlmsg_type == RTM_NEWADDR || nh->nlmsg_type == RTM_DELADDR) {
+            const struct ifaddrmsg* ifa = (const struct ifaddrmsg*)NLMSG_DATA(nh);
+            if (ifa->ifa_family != AF_INET) continue;
+
+            int rlen = (int)IFA_PAYLOAD(nh);
+            uint32_t ip_be = 0;
+            for (const struct rtattr* rta = IFA_RTA(ifa); RTA_OK(rta, rlen); rta = RTA_NEXT(rta, rlen)) {
+                if (rta->rta_type == IFA_LOCAL || (rta->rta_type == IFA_ADDRESS && !ip_be)) {
+                    memcpy(&ip_be, RTA_DATA(rta), 4);
+                }
+            }
+            if (!ip_be || (ntohl(ip_be) >> 24) == 127) continue;
+            netmon_on_addr(m, tab, (int)ifa->ifa_index, ip_be, nh->nlmsg_type == RTM_NEWADDR, !dump || m->mode == 2);
+        }
+        else if (nh->nlmsg_type == RTM_NEWLINK || nh->nlmsg_type == RTM_DELLINK) {
+            const struct ifinfomsg* ifi = (const struct ifinfomsg*)NLMSG_DATA(nh);
+            if (ifi->ifi_flags & IFF_LOOPBACK) continue;
+
+            int up = nh->nlmsg_type == RTM_NEWLINK && (ifi->ifi_flags & IFF_RUNNING);
+            for (int i = 0; i < MAX_PATHS; i++) {
+                if (tab[i].ip_be && tab[i].ifindex == ifi->ifi_index && tab[i].up != up) {
+                    tab[i].up = up;
+                    netmon_emit(m, ifi->ifi_index, tab[i].ip_be, up);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief 감시 스레드 본체: 처음에 주소 목록을 받아 두고, 이후 변화만 넘깁니다.
+ */
+static void* netmon_thread_main(void* arg){
+    netmon_t* m = (netmon_t*)arg;
+    netmon_addr_t tab[MAX_PATHS];
+    memset(tab, 0, sizeof(tab));
+
+    struct { struct nlmsghdr nh; struct ifaddrmsg ifa; } req;
+    memset(&req, 0, sizeof(req));
+    req.nh.nlmsg_len   = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+    req.nh.nlmsg_type  = RTM_GETADDR;
+    req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.ifa.ifa_family = AF_INET;
+    send(m->fd, &req, req.nh.nlmsg_len, 0);
+
+    uint8_t buf[8192];
+    struct pollfd pfd = { .fd = m->fd, .events = POLLIN };
+    while (!m->stop) {
+        if (poll(&pfd, 1, NETMON_POLL_MS) <= 0) continue;
+        int n = (int)recv(m->fd, buf, sizeof(buf), 0);
+        if (n <= 0) continue;
+        netmon_parse(m, tab, buf, n);
+    }
+    return NULL;
+}
+
+/**
+ * @brief 감시를 시작합니다. (mode 0이면 아무것도 하지 않음)
+ * @return 0 성공(또는 끔), -1 netlink 소켓/스레드 실패
+ */
+static inline int netmon_start(netmon_t* m, int mode){
+    m->mode = mode;
+    if (mode == 0) return 0;
+
+    m->fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (m->fd < 0) { perror("netlink"); m->mode = 0; return -1; }
+
+    struct sockaddr_nl sa = { .nl_family = AF_NETLINK, .nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR };
+    if (bind(m->fd, (struct sockaddr*)&sa, sizeof(sa)) < 0 ||
+        pthread_create(&m->thread, NULL, netmon_thread_main, m) != 0) {
+        perror("netlink bind");
+        close(m->fd);
+        m->fd = -1;
+        m->mode = 0;
+        return -1;
+    }
+    m->started = 1;
+    return 0;
+}
+
+/**
+ * @brief 감시 스레드를 멈추고 소켓을 닫습니다.
+ */
+static inline void netmon_stop(netmon_t* m){
+    if (m->started) {
+        m->stop = 1;
+        pthread_join(m->thread, NULL);
+        m->started = 0;
+    }
+    if (m->mode && m->fd >= 0) close(m->fd);
+}
+
+
+/* ============================================================
+ * [2] 주소 이벤트 처리 (loop_cb, 네트워크 스레드)
+ * ============================================================ */
+
+/**
+ * @brief 역할의 probe용 로컬 주소를 만듭니다. (기존 ALT/USB 주소는 main에서 정한 포트 그대로)
+ */
+static inline void netmon_role_addr(const tx_t* st, const path_role_t* r, int ri, struct sockaddr_storage* out){
+    if (r->ip_be == st->ip_usb_be && st->has_local_alt) { *out = st->local_alt; return; }
+    if (r->ip_be == st->ip_wlan_be && st->has_local_usb) { *out = st->local_usb; return; }
+
+    struct sockaddr_in* la = (struct sockaddr_in*)out;
+    memset(out, 0, sizeof(*out));
+    la->sin_family      = AF_INET;
+    la->sin_port        = htons((uint16_t)(SCHED_PROBE_PORT + ri));
+    la->sin_addr.s_addr = r->ip_be;
+}
+
+/**
+ * @brief 감시 스레드가 넘긴 주소 이벤트를 처리합니다. (loop_cb에서 핸드셰이크 이후 매번 호출)
+ */
+static inline void netmon_poll(picoquic_cnx_t* c, tx_t* st, uint64_t now){
+    netmon_t* m = &st->netmon;
+    netev_t ev;
+
+    while (m->mode && netmon_pop(m, &ev)) {
+        m->events++;
+
+        int ri = -1;
+        for (int i = 0; i < st->nroles; i++) {
+            if (st->roles[i].ip_be == ev.ip_be) { ri = i; break; }
+        }
+
+        /* auto: 처음 보는 인터페이스는 가장 낮은 우선순위 역할로 채택 */
+        if (ri < 0 && ev.up && m->mode == 2 && st->nroles < MAX_PATHS) {
+            path_role_t* r = &st->roles[st->nroles];
+            memset(r, 0, sizeof(*r));
+            r->ip_be = ev.ip_be;
+            r->prio  = st->nroles;
+            r->cost  = 1.0;
+            r->probe = 1;
+            snprintf(r->name, sizeof(r->name), "%s", ev.ifname[0] ? ev.ifname : "auto");
+            ri = st->nroles++;
+        }
+        if (ri < 0) continue;
+        path_role_t* r = &st->roles[ri];
+
+        int idx = -1;
+        for (int j = 0; j < c->nb_paths; j++) {
+            picoquic_path_t* p = c->path[j];
+            if (p && p->first_tuple &&
+                ((struct sockaddr_in*)&p->first_tuple->local_addr)->sin_addr.s_addr == ev.ip_be) { idx = j; break; }
+        }
+
+        struct in_addr ia = { .s_addr = ev.ip_be };
+        if (ev.up) {
+            struct sockaddr_storage la;
+            netmon_role_addr(st, r, ri, &la);
+            mloop_open(&st->mloop, &la, ev.ifname);   /* netlink가 알려준 장치 이름으로 소켓 고정 */
+
+            if (idx >= 0) {
+                hb_challenge(c, st, idx, now);
+            } else {
+                picoquic_probe_new_path(c, (struct sockaddr*)&st->peerA, (struct sockaddr*)&la, now);
+            }
+            /* 설정된 ALT/USB 역할이면 핸드셰이크 후 지연 probe를 다시 하지 않도록 표시 */
+            const struct sockaddr_in* la4 = (const struct sockaddr_in*)&la;
+            if (st->has_local_alt && la4->sin_addr.s_addr == ((const struct sockaddr_in*)&st->local_alt)->sin_addr.s_addr) st->didB = 1;
+            if (st->has_local_usb && la4->sin_addr.s_addr == ((const struct sockaddr_in*)&st->local_usb)->sin_addr.s_addr) st->didC = 1;
+            r->last_probe = now;
+            m->probes++;
+            LOGF("[NETMON] %s %s up -> %s", ev.ifname, inet_ntoa(ia), idx >= 0 ? "challenge" : "probe");
+        } else {
+            mloop_drop_ip(&st->mloop, ev.ip_be);
+
+            /* 마지막 경로는 abandon하지 않음 (연결이 끊김) */
+            if (idx >= 0 && c->nb_paths > 1) {
+                picoquic_abandon_path(c, c->path[idx]->unique_path_id, 0, "interface down", now);
+                if (idx == st->last_primary_idx) st->last_switch_ts = 0;
+                st->path_gen++;
+                m->abandons++;
+            }
+            LOGF("[NETMON] %s %s down%s", ev.ifname, inet_ntoa(ia), idx >= 0 && c->nb_paths > 1 ? " -> abandon" : "");
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef PATH_EST_H
+#define PATH_EST_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "picoquic.h"
+#include "picoquic_internal.h"
+#include "struct_type.h"
+
+/* ============================================================
+ * [1] 경로별 품질 추정기
+ * ============================================================ */
+
+/*
+ * compute_metric_safe의 함수 내부 static EWMA(unique_path_id % 16)는 경로끼리 칸을 나눠 쓸 수 있고,
+ * 손실률은 연결 시작부터의 누적(total_bytes_lost / delivered)이라 지금의 손실에 몇 시간씩 늦게 반응했습니다.
+ * 업로더(tx_t)가 경로 인덱스별 추정기를 갖고, 표본마다 O(1)로 갱신합니다.
+ *   - 감쇠 w = 0.5^(dt / 반감기): 표본 간격이 들쭉날쭉해도 같은 시간 창
+ *   - RTT 평균/분산: 지수 가중 평균과 분산 (rtt_sample, 없으면 smoothed_rtt)
+ *   - 손실률: 창 안의 손실 바이트 / (손실 + 전달 바이트), 누적 카운터의 증분만 더함
+ *   - goodput: 표본 간격당 delivered 증분
+ *   - stale: 보낸 데이터가 있는데 max(4·RTT, 500ms) 동안 전달 진척이 없음
+ * 경로 객체가 바뀌면(unique_path_id 변화, 인덱스 재사용) 처음부터 다시 잽니다.
+ */
+
+#define EST_HALF_LIFE_MS_DEFAULT 500.0
+#define EST_SAMPLE_US            20000ULL   /* 최소 표본 간격 */
+#define EST_STALE_MIN_US         500000ULL
+
+/**
+ * @brief 경로 하나의 표본을 추정기에 반영합니다.
+ */
+static inline void est_sample(path_est_t* e, const picoquic_path_t* p, double half_life_ms, uint64_t now){
+    if (!e->valid || e->upid != p->unique_path_id) {
+        memset(e, 0, sizeof(*e));
+        e->upid           = p->unique_path_id;
+        e->valid          = 1;
+        e->last_sample    = now;
+        e->last_progress  = now;
+        e->prev_lost      = p->total_bytes_lost;
+        e->prev_delivered = p->delivered;
+        e->rtt_ms         = p->smoothed_rtt / 1000.0;
+        return;
+    }
+
+    if (now - e->last_sample < EST_SAMPLE_US) return;
+    double dt = (double)(now - e->last_sample);
+    double w  = pow(0.5, dt / (half_life_ms * 1000.0));
+    double a  = 1.0 - w;
+
+    uint64_t rs = p->rtt_sample > 0 ? p->rtt_sample : p->smoothed_rtt;
+    if (rs > 0) {
+        double r = rs / 1000.0;
+        if (e->rtt_ms <= 0) {
+            e->rtt_ms = r;
+        } else {
+            double d = r - e->rtt_ms;
+            e->rtt_ms  += a * d;
+            e->rtt_var  = w * (e->rtt_var + a * d * d);
+        }
+    }
+
+    uint64_t dl = p->total_bytes_lost > e->prev_lost      ? p->total_bytes_lost - e->prev_lost : 0;
+    uint64_t dd = p->delivered        > e->prev_delivered ? p->delivered - e->prev_delivered   : 0;
+    e->lost_B  = w * e->lost_B  + (double)dl;
+    e->deliv_B = w * e->deliv_B + (double)dd;
+    e->loss_pct = (e->lost_B + e->deliv_B > 0) ? e->lost_B * 100.0 / (e->lost_B + e->deliv_B) : 0.0;
+    e->goodput_Bps = w * e->goodput_Bps + a * ((double)dd * 1e6 / dt);
+
+    if (dd > 0) e->last_progress = now;
+    uint64_t stale_us = (uint64_t)(4.0 * e->rtt_ms * 1000.0);
+    if (stale_us < EST_STALE_MIN_US) stale_us = EST_STALE_MIN_US;
+    e->stale = p->bytes_in_transit > 0 && now - e->last_progress > stale_us;
+
+    e->prev_lost      = p->total_bytes_lost;
+    e->prev_delivered = p->delivered;
+    e->last_sample    = now;
+}
+
+/**
+ * @brief 검증된 모든 경로의 추정기를 갱신합니다. (loop_cb에서 매번 호출, 표본 간격 미만이면 건너뜀)
+ */
+static inline int hb_inflight(const tx_t* st, picoquic_cnx_t* c, int idx);
+
+static inline void est_update(picoquic_cnx_t* c, tx_t* st, uint64_t now){
+    double hl = st->est_half_life_ms > 0 ? st->est_half_life_ms : EST_HALF_LIFE_MS_DEFAULT;
+    for (int i = 0; i < c->nb_paths && i < MAX_PATHS; i++) {
+        picoquic_path_t* p = c->path[i];
+        if (!p || !p->first_tuple) continue;
+        if (!p->first_tuple->challenge_verified && !hb_inflight(st, c, i)) continue;
+        est_sample(&st->est[i], p, hl, now);
+    }
+}
+
+/**
+ * @brief 경로 인덱스의 추정값을 돌려줍니다.
+ * @return 이 경로 객체의 추정값, 아직 없으면 NULL
+ */
+static inline const path_est_t* est_of(const tx_t* st, picoquic_cnx_t* c, int idx){
+    if (idx < 0 || idx >= c->nb_paths || idx >= MAX_PATHS || !c->path[idx]) return NULL;
+    const path_est_t* e = &st->est[idx];
+    return (e->valid && e->upid == c->path[idx]->unique_path_id) ? e : NULL;
+}
+
+
+/* ============================================================
+ * [2] 하트비트 생존 감지
+ * ============================================================ */
+
+/*
+ * Wi-Fi가 죽은 것은 challenge_verified가 풀리거나 2초 넘게 조용해야 알았고, 핫스팟은 1초 타이머로만 봤습니다.
+ * 경로마다 응답 기한(RTT 기준)을 두고, 기한 안에 아무 패킷도 오지 않으면 놓친 것으로 셉니다.
+ *   - 응답 기한 = srtt + max(4·rttvar, 10ms)           (PATH_RESPONSE는 ACK 지연 없이 바로 옴)
+ *   - 데이터를 보내는 중인 경로는 ACK 지연(25ms)을 더한 기한 안에 ACK가 와야 함
+ *   - 유휴 경로는 max(hb_idle, 2·기한)마다 하트비트(PATH_CHALLENGE)를 보냄 (RTT가 긴 경로일수록 드물게)
+ *   - 기한을 놓치면 바로 하트비트를 다시 보내고, HB_MISS_LIMIT번 연속 놓치면 suspect
+ * picoquic_set_path_challenge는 응답이 올 때까지 challenge_verified를 풀어 둡니다.
+ * 하트비트 응답을 기다리는 경로(hb_inflight)는 미검증이어도 계속 보고, 메트릭 무효화·재검증 킥 없이
+ * 송신(path_sane_for_send)과 후보 목록(build_unique_verified_paths)에서도 검증된 경로로 취급합니다.
+ * suspect 경로는 BAD 등급·후보 제외이며, 주 경로면 체류 시간 없이 다음 선택에서 옮깁니다.
+ * RTT 20ms 경로라면 약 100ms 안에 판정됩니다. 패킷이 다시 오면 바로 풀립니다.
+ */
+
+#ifndef HB_IDLE_MS_DEFAULT
+#  define HB_IDLE_MS_DEFAULT 100.0
+#endif
+#define HB_MIN_SLACK_US   10000ULL
+#define HB_ACK_DELAY_US   25000ULL
+#define HB_MAX_DEADLINE_US 1000000ULL
+#define HB_MISS_LIMIT     2
+
+/**
+ * @brief 경로의 하트비트 응답 기한을 계산합니다. (RTT 기준)
+ */
+static inline uint64_t hb_deadline(const picoquic_path_t* p){
+    uint64_t slack = 4 * p->rtt_variant;
+    if (slack < HB_MIN_SLACK_US) slack = HB_MIN_SLACK_US;
+    uint64_t d = p->smoothed_rtt + slack;
+    return d < HB_MAX_DEADLINE_US ? d : HB_MAX_DEADLINE_US;
+}
+
+/**
+ * @brief 경로 idx에 하트비트를 보내고 응답(아무 패킷)을 기다리는 중인지 봅니다.
+ */
+static inline int hb_inflight(const tx_t* st, picoquic_cnx_t* c, int idx){
+    return idx >= 0 && idx < c->nb_paths && path_hb_inflight(st, c->path[idx], idx);
+}
+
+/**
+ * @brief 경로 idx에 하트비트(PATH_CHALLENGE)를 보내고 응답 대기로 표시합니다.
+ * (다른 모듈이 검증된 경로에 챌린지를 보낼 때도 이것을 써야 응답 전까지 경로가 미검증으로 취급되지 않음)
+ */
+static inline void hb_challenge(picoquic_cnx_t* c, tx_t* st, int idx, uint64_t now){
+    picoquic_set_path_challenge(c, idx, now);
+    if (idx < MAX_PATHS) st->est[idx].ping_ts = now;
+    st->hb_pings++;
+}
+
+/**
+ * @brief 검증된 경로(또는 하트비트 응답 대기 중인 경로)마다 수신 여부를 보고 하트비트를 보내거나 suspect를 판정합니다.
+ * (loop_cb에서 매번 호출)
+ */
+static inline void hb_update(picoquic_cnx_t* c, tx_t* st, uint64_t now){
+    if (st->hb_idle_us == 0) return;
+
+    for (int i = 0; i < c->nb_paths && i < MAX_PATHS; i++) {
+        picoquic_path_t* p = c->path[i];
+        path_est_t* e = &st->est[i];
+        if (!p || !p->first_tuple) continue;
+        if (!e->valid || e->upid != p->unique_path_id) continue;
+        if (!p->first_tuple->challenge_verified && e->ping_ts <= e->last_rx) continue;
+
+        /* 패킷이 왔으면 정상 */
+        if (p->last_packet_received_at != e->last_rx) {
+            e->last_rx = p->last_packet_received_at;
+            e->misses  = 0;
+            if (e->suspect) {
+                e->suspect = 0;
+                st->path_gen++;
+                LOGF("[HB] path[%d] alive again", i);
+            }
+            continue;
+        }
+
+        uint64_t d = hb_deadline(p);
+        int awaiting = e->ping_ts > e->last_rx;
+        int missed;
+
+        if (awaiting) {
+            missed = now - e->ping_ts > d;
+        } else if (p->bytes_in_transit > 0) {
+            missed = now - e->last_rx > d + HB_ACK_DELAY_US;
+        } else {
+            uint64_t idle = st->hb_idle_us > 2 * d ? st->hb_idle_us : 2 * d;
+            if (now - e->last_rx > idle) hb_challenge(c, st, i, now);
+            continue;
+        }
+        if (!missed) continue;
+
+        e->misses++;
+        hb_challenge(c, st, i, now);
+
+        if (e->misses >= HB_MISS_LIMIT && !e->suspect) {
+            e->suspect = 1;
+            st->hb_suspects++;
+            st->path_gen++;
+            if (i == st->last_primary_idx) st->last_switch_ts = 0;
+            LOGF("[HB] path[%d] suspect: no reply for %.0fms (deadline %.0fms)%s",
+                 i, (now - e->last_rx) / 1000.0, d / 1000.0, i == st->last_primary_idx ? " (primary)" : "");
+        }
+    }
+}
+
+/**
+ * @brief 하트비트가 경로를 죽은 것으로 의심하는지 돌려줍니다.
+ */
+static inline int est_suspect(const tx_t* st, picoquic_cnx_t* c, int idx){
+    const path_est_t* e = est_of(st, c, idx);
+    return e && e->suspect;
+}
+
+#endif
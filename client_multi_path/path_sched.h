@@ -0,0 +1,329 @@
+#ifndef PATH_SCHED_H
+#define PATH_SCHED_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "picoquic.h"
+#include "picoquic_internal.h"
+#include "struct_type.h"
+#include "quic_helpers.h"
+#include "path_algo.h"
+#include "abr.h"
+
+/* ============================================================
+ * [1] 경로 역할 설정
+ * ============================================================ */
+
+/*
+ * fsm_pick은 WLAN/USB 두 역할만 알기 때문에 세 번째 인터페이스(두 번째 모뎀, 유선 등)는 쓰이지 않았습니다.
+ * 스케줄러는 경로를 로컬 IP로 역할(path_role_t)에 연결하고, 역할의 우선순위·비용으로 주 경로를 고릅니다.
+ *   --path IP[:PRIO[:COST]]   역할 추가 (여러 번, 순서대로 우선순위 기본값 0, 1, 2 ...)
+ * --path를 주지 않으면 기존 위치 인자의 두 IP가 WLAN(우선 0, 비용 0)과 USB(우선 1, 비용 1)가 됩니다.
+ * 기존 두 IP가 아닌 역할은 스케줄러가 직접 probe해서 경로를 엽니다.
+ */
+
+enum { SCHED_PRIORITY = 0, SCHED_MINRTT, SCHED_WRR, SCHED_COST, SCHED_COUNT };
+
+static const char* const k_sched_names[SCHED_COUNT] = { "priority", "minrtt", "wrr", "cost" };
+
+#define SCHED_DWELL_FAILOVER_US 200000ULL   /* fsm_pick과 같은 체류 시간 */
+#define SCHED_DWELL_FAILBACK_US 400000ULL
+#define SCHED_RTT_MARGIN_MS     20.0
+#define SCHED_PROBE_US          2000000ULL  /* 추가 인터페이스 probe 재시도 간격 */
+#define SCHED_PROBE_PORT        55003       /* 추가 인터페이스 로컬 포트 (역할마다 +1) */
+
+/**
+ * @brief 정책 이름을 SCHED_* 값으로 바꿉니다.
+ * @return 정책 값, 모르는 이름이면 -1
+ */
+static inline int sched_parse(const char* name){
+    for (int i = 0; i < SCHED_COUNT; i++) {
+        if (!strcmp(name, k_sched_names[i])) return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief "IP[:PRIO[:COST]]" 설정 한 개를 역할로 추가합니다.
+ * @return 0 성공, -1 형식 오류 또는 역할 수 초과
+ */
+static inline int role_add(tx_t* st, const char* spec){
+    if (st->nroles >= MAX_PATHS) return -1;
+
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    path_role_t* r = &st->roles[st->nroles];
+    memset(r, 0, sizeof(*r));
+    r->prio = st->nroles;
+
+    char* save = NULL;
+    char* ip = strtok_r(buf, ":", &save);
+    char* pr = strtok_r(NULL, ":", &save);
+    char* co = strtok_r(NULL, ":", &save);
+    if (!ip || inet_addr(ip) == INADDR_NONE) return -1;
+
+    r->ip_be = inet_addr(ip);
+    if (pr) r->prio = atoi(pr);
+    if (co) r->cost = atof(co);
+    snprintf(r->name, sizeof(r->name), "path%d", st->nroles);
+    st->nroles++;
+    return 0;
+}
+
+/**
+ * @brief 역할 설정을 마무리합니다. (--path가 없으면 기존 WLAN/USB 두 역할)
+ * 기존 두 IP에 해당하는 역할은 이름을 붙이고, 나머지는 스케줄러가 probe하도록 표시합니다.
+ */
+static inline void roles_finish(tx_t* st){
+    if (st->nroles == 0) {
+        st->roles[0] = (path_role_t){ .ip_be = st->ip_wlan_be, .prio = 0, .cost = 0 };
+        st->roles[1] = (path_role_t){ .ip_be = st->ip_usb_be,  .prio = 1, .cost = 1 };
+        st->nroles = (st->ip_usb_be != st->ip_wlan_be) ? 2 : 1;
+    }
+
+    for (int i = 0; i < st->nroles; i++) {
+        path_role_t* r = &st->roles[i];
+        if (r->ip_be == st->ip_wlan_be)     snprintf(r->name, sizeof(r->name), "WLAN");
+        else if (r->ip_be == st->ip_usb_be) snprintf(r->name, sizeof(r->name), "USB");
+        else r->probe = 1;
+    }
+}
+
+/**
+ * @brief 로컬 IP에 해당하는 역할을 찾습니다.
+ * @return 역할 포인터, 설정에 없는 인터페이스면 NULL
+ */
+static inline const path_role_t* role_of(const tx_t* st, uint32_t ip_be){
+    for (int i = 0; i < st->nroles; i++) {
+        if (st->roles[i].ip_be == ip_be) return &st->roles[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief 기존 두 IP가 아닌 역할의 경로를 열고, 검증이 풀리면 챌린지를 다시 보냅니다.
+ */
+static inline void sched_probe_roles(picoquic_cnx_t* c, tx_t* st, uint64_t now){
+    for (int i = 0; i < st->nroles; i++) {
+        path_role_t* r = &st->roles[i];
+        if (!r->probe || now - r->last_probe < SCHED_PROBE_US) continue;
+
+        int idx = -1;
+        for (int j = 0; j < c->nb_paths; j++) {
+            picoquic_path_t* p = c->path[j];
+            if (!p || !p->first_tuple) continue;
+            if (((struct sockaddr_in*)&p->first_tuple->local_addr)->sin_addr.s_addr == r->ip_be) { idx = j; break; }
+        }
+
+        if (idx < 0) {
+            struct sockaddr_in la = {0};
+            la.sin_family      = AF_INET;
+            la.sin_port        = htons((uint16_t)(SCHED_PROBE_PORT + i));
+            la.sin_addr.s_addr = r->ip_be;
+            LOGF("[PROBE] probing %s...", r->name);
+            picoquic_probe_new_path(c, (struct sockaddr*)&st->peerA, (struct sockaddr*)&la, now);
+        } else if (!c->path[idx]->first_tuple->challenge_verified && !hb_inflight(st, c, idx)) {
+            picoquic_set_path_challenge(c, idx, now);
+        }
+        r->last_probe = now;
+    }
+}
+
+
+/* ============================================================
+ * [2] 선택 정책
+ * ============================================================ */
+
+/*
+ * 정책은 후보 배열(sched_in_t)과 현재 주 경로 위치를 받아 새 주 경로 위치를 돌려줍니다.
+ * 후보 메트릭은 경로별 추정기(path_est.h)의 반감기 창 값입니다.
+ *   priority : 우선순위가 높은 경로를 쓰다가 열화되면 다음 순위로 페일오버, 회복되면 페일백 (기존 동작)
+ *   minrtt   : 쓸 만한(BAD가 아닌) 경로 중 RTT가 가장 짧은 경로 (마진 20ms)
+ *   wrr      : 추정 용량에 비례한 가중 라운드 로빈 (프레임 단위로 경로를 번갈아 사용)
+ *   cost     : 가능한 한 무료(비용이 낮은) 링크, 품질 등급이 떨어질 때만 비싼 링크
+ */
+
+typedef struct {
+    int           idx;          /* 경로 인덱스 */
+    int           prio;
+    double        cost;
+    double        rate;         /* 추정 용량 (B/s) */
+    path_metric_t M;
+    const char*   name;
+} sched_in_t;
+
+typedef int (*sched_fn_t)(tx_t* st, const sched_in_t* in, int n, int cur, uint64_t dt);
+
+/** @brief 조건에 맞는 후보 중 우선순위가 가장 높은 것 (없으면 -1) */
+static inline int sched_best_prio(const sched_in_t* in, int n, int max_grade, int below_prio){
+    int b = -1;
+    for (int i = 0; i < n; i++) {
+        if (in[i].M.grade > max_grade || in[i].prio >= below_prio) continue;
+        if (b < 0 || in[i].prio < in[b].prio) b = i;
+    }
+    return b;
+}
+
+/**
+ * @brief priority: fsm_pick 규칙을 N개 경로로 일반화한 페일오버/페일백
+ */
+static int sched_priority(tx_t* st, const sched_in_t* in, int n, int cur, uint64_t dt){
+    (void)st;
+    if (cur < 0) {
+        int b = sched_best_prio(in, n, 1, INT32_MAX);
+        return b >= 0 ? b : sched_best_prio(in, n, 2, INT32_MAX);
+    }
+
+    const sched_in_t* C = &in[cur];
+    int higher = sched_best_prio(in, n, 2, C->prio);
+
+    /* 더 높은 순위가 있으면 페일백 검사 (체류 400ms) */
+    if (higher >= 0) {
+        if (dt < SCHED_DWELL_FAILBACK_US) return cur;
+
+        int b = sched_best_prio(in, n, 1, C->prio);
+        if (b >= 0) return b;
+
+        for (int i = 0; i < n; i++) {
+            if (in[i].prio < C->prio && in[i].M.grade == C->M.grade &&
+                C->M.rtt_ms - in[i].M.rtt_ms > SCHED_RTT_MARGIN_MS + 10.0) return i;
+        }
+        if (C->M.grade < 2) return cur;
+    } else if (dt < SCHED_DWELL_FAILOVER_US) {
+        return cur;
+    }
+
+    /* 페일오버: BAD면 쓸 만한 경로, WARN이면 GOOD 경로, 같은 등급이면 RTT 이득이 확실한 경로 */
+    int b = -1;
+    if (C->M.grade == 2)      b = sched_best_prio(in, n, 1, INT32_MAX);
+    else if (C->M.grade == 1) b = sched_best_prio(in, n, 0, INT32_MAX);
+    if (b >= 0 || C->M.grade == 2) return b >= 0 ? b : cur;   /* 모두 BAD면 전환 이득 없음 */
+
+    for (int i = 0; i < n; i++) {
+        if (i != cur && in[i].M.grade == C->M.grade &&
+            C->M.rtt_ms - in[i].M.rtt_ms > SCHED_RTT_MARGIN_MS) return i;
+    }
+    return cur;
+}
+
+/**
+ * @brief minrtt: BAD가 아닌 경로 중 RTT 최소 (전환은 마진 이상 이득이고 체류 시간이 지났을 때만)
+ */
+static int sched_minrtt(tx_t* st, const sched_in_t* in, int n, int cur, uint64_t dt){
+    (void)st;
+    int b = -1;
+    for (int g = 1; g <= 2 && b < 0; g++) {
+        for (int i = 0; i < n; i++) {
+            if (in[i].M.grade > g) continue;
+            if (b < 0 || in[i].M.rtt_ms < in[b].M.rtt_ms) b = i;
+        }
+    }
+    if (cur < 0 || b == cur) return b;
+    if (in[cur].M.grade == 2 && in[b].M.grade < 2) return b;
+    if (dt < SCHED_DWELL_FAILOVER_US) return cur;
+    return (in[cur].M.rtt_ms - in[b].M.rtt_ms > SCHED_RTT_MARGIN_MS) ? b : cur;
+}
+
+/**
+ * @brief wrr: 쓸 만한 경로마다 용량만큼 크레딧을 쌓고 가장 많이 쌓인 경로로 보낸 뒤 전체 합만큼 차감
+ * (smooth weighted round-robin, 용량 비율대로 프레임이 고르게 섞임)
+ */
+static int sched_wrr(tx_t* st, const sched_in_t* in, int n, int cur, uint64_t dt){
+    (void)cur; (void)dt;
+    double sum = 0;
+    int b = -1;
+    for (int i = 0; i < n; i++) {
+        if (in[i].M.grade == 2) { st->wrr_credit[in[i].idx] = 0; continue; }
+        double w = in[i].rate > 0 ? in[i].rate : 1.0;
+        st->wrr_credit[in[i].idx] += w;
+        sum += w;
+        if (b < 0 || st->wrr_credit[in[i].idx] > st->wrr_credit[in[b].idx]) b = i;
+    }
+    if (b < 0) return sched_best_prio(in, n, 2, INT32_MAX);
+
+    st->wrr_credit[in[b].idx] -= sum;
+    return b;
+}
+
+/**
+ * @brief cost: 가장 좋은 등급 안에서 비용이 가장 낮은 경로 (같으면 우선순위, RTT 순)
+ * 더 비싼 링크로는 체류 200ms 뒤에, 더 싼 링크로의 복귀는 400ms 뒤에 옮겨 깜빡임을 막습니다.
+ */
+static int sched_cost(tx_t* st, const sched_in_t* in, int n, int cur, uint64_t dt){
+    (void)st;
+    int b = -1;
+    for (int g = 0; g <= 2 && b < 0; g++) {
+        for (int i = 0; i < n; i++) {
+            if (in[i].M.grade != g) continue;
+            if (b < 0 || in[i].cost < in[b].cost ||
+                (in[i].cost == in[b].cost && (in[i].prio < in[b].prio ||
+                 (in[i].prio == in[b].prio && in[i].M.rtt_ms < in[b].M.rtt_ms)))) b = i;
+        }
+    }
+    if (cur < 0 || b == cur) return b;
+    if (in[cur].M.grade == 2) return b;
+
+    uint64_t dwell = in[b].cost < in[cur].cost ? SCHED_DWELL_FAILBACK_US : SCHED_DWELL_FAILOVER_US;
+    return dt < dwell ? cur : b;
+}
+
+static const sched_fn_t k_sched_fns[SCHED_COUNT] = { sched_priority, sched_minrtt, sched_wrr, sched_cost };
+
+
+/* ============================================================
+ * [3] 공개 함수 인터페이스
+ * ============================================================ */
+
+/**
+ * @brief 설정된 정책으로 주 경로를 고릅니다. (pick_primary_idx 대체)
+ * priority 정책에 역할이 기존 WLAN/USB 두 개뿐이면 이 빌드의 fsm_pick을 그대로 씁니다.
+ * @return 주 경로 인덱스, 후보가 없으면 직전 주 경로
+ */
+static inline int sched_pick(picoquic_cnx_t* c, tx_t* st, pathsel_t* sel, int sc, uint64_t now){
+    if (sc <= 0) return -1;
+
+    if (st->sched == SCHED_PRIORITY && st->nroles <= 2 &&
+        st->roles[0].ip_be == st->ip_wlan_be &&
+        (st->nroles < 2 || st->roles[1].ip_be == st->ip_usb_be)) {
+        int before = st->last_primary_idx;
+        int k = pick_primary_idx(c, sel, sc, st->ip_wlan_be, st->ip_usb_be,
+                                 &st->last_primary_idx, now, &st->last_switch_ts, st);
+        if (st->last_primary_idx != before) st->sched_switches++;
+        return k;
+    }
+
+    sched_in_t in[MAX_PATHS];
+    int n = 0, cur = -1;
+    for (int i = 0; i < sc && n < MAX_PATHS; i++) {
+        const path_role_t* r = role_of(st, sel[i].ip_be);
+        in[n].idx  = sel[i].idx;
+        in[n].prio = r ? r->prio : INT32_MAX - 1;     /* 설정에 없는 인터페이스는 맨 뒤 */
+        in[n].cost = r ? r->cost : 0.0;
+        in[n].rate = abr_path_capacity(sel[i].p);
+        in[n].M    = compute_metric_safe(sel[i].p, est_of(st, c, sel[i].idx));
+        in[n].name = r ? r->name : "?";
+        if (in[n].idx == st->last_primary_idx) cur = n;
+        n++;
+    }
+
+    int b = k_sched_fns[st->sched](st, in, n, cur, now - st->last_switch_ts);
+    if (b < 0) return st->last_primary_idx;
+
+    if (in[b].idx != st->last_primary_idx) {
+        st->last_primary_idx = in[b].idx;
+        st->sched_switches++;
+        /* wrr는 프레임마다 경로를 바꾸므로 전환 시각(체류·중복 전송 기준)을 갱신하지 않음 */
+        if (st->sched != SCHED_WRR) {
+            st->last_switch_ts = now;
+            LOGF("[PICK] %s -> primary=%d (%s grade=%d rtt=%.1fms)", k_sched_names[st->sched],
+                 in[b].idx, in[b].name, in[b].M.grade, in[b].M.rtt_ms);
+        }
+    }
+    return in[b].idx;
+}
+
+#endif
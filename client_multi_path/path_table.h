@@ -0,0 +1,175 @@
+#ifndef PATH_TABLE_H
+#define PATH_TABLE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "picoquic.h"
+#include "picoquic_internal.h"
+#include "struct_type.h"
+
+/* ============================================================
+ * [1] 경로 이벤트 테이블
+ * ============================================================ */
+
+/*
+ * loop_cb는 매번 c->path[]를 여러 번 훑으며 challenge_verified와 로컬 IP를 비교했고,
+ * Wi-Fi 끊김은 1~2초 주기 폴링으로만 알아챘습니다. picoquic 경로 콜백을 켜면
+ *   path_available / path_suspended / path_deleted / path_quality_changed (stream_id = unique_path_id)
+ * 가 상태가 바뀌는 순간 오므로, 이벤트 때만 테이블을 고치고 세대(path_gen)를 올립니다.
+ *   - 주 경로가 suspended/deleted 되면 체류 시간을 무시하고 다음 선택에서 바로 전환 (last_switch_ts = 0)
+ *   - 프레임마다의 조회는 테이블(MAX_PATHS칸)만 보며, c->path[] 재탐색은 이벤트 때만
+ * quality_changed 임계값은 RTT PT_QUALITY_RTT_US, pacing PT_QUALITY_RATE_BPS 변화입니다.
+ */
+
+enum { PATH_ST_NONE = 0, PATH_ST_AVAILABLE, PATH_ST_SUSPENDED, PATH_ST_DELETED };
+
+#ifndef PT_QUALITY_RTT_US
+#  define PT_QUALITY_RTT_US   10000ULL     /* RTT가 10ms 넘게 바뀌면 알림 */
+#endif
+#ifndef PT_QUALITY_RATE_BPS
+#  define PT_QUALITY_RATE_BPS 125000ULL    /* pacing rate가 1Mbps 넘게 바뀌면 알림 */
+#endif
+
+/**
+ * @brief 연결에 경로 콜백과 품질 변화 알림을 켭니다. (연결을 만들 때마다 호출)
+ */
+static inline void ptab_enable(picoquic_cnx_t* c){
+    picoquic_enable_path_callbacks(c, 1);
+    picoquic_subscribe_to_quality_update(c, PT_QUALITY_RATE_BPS, PT_QUALITY_RTT_US);
+}
+
+/**
+ * @brief 테이블을 비웁니다. (재연결 시)
+ */
+static inline void ptab_reset(tx_t* st){
+    memset(st->ptab, 0, sizeof(st->ptab));
+    st->path_gen++;
+}
+
+/**
+ * @brief unique_path_id의 칸을 찾고, 없으면 빈 칸(또는 삭제된 칸)을 씁니다.
+ */
+static inline path_slot_t* ptab_slot(tx_t* st, uint64_t upid){
+    path_slot_t* fr = NULL;
+    for (int i = 0; i < MAX_PATHS; i++) {
+        path_slot_t* s = &st->ptab[i];
+        if (s->state != PATH_ST_NONE && s->upid == upid) return s;
+        if (!fr && (s->state == PATH_ST_NONE || s->state == PATH_ST_DELETED)) fr = s;
+    }
+    if (fr) {
+        memset(fr, 0, sizeof(*fr));
+        fr->upid = upid;
+        fr->idx  = -1;
+    }
+    return fr;
+}
+
+/**
+ * @brief 칸의 현재 경로 인덱스를 돌려줍니다. (인덱스가 밀렸으면 다시 찾음)
+ * @return 경로 인덱스, 경로가 없으면 -1
+ */
+static inline int ptab_path_idx(picoquic_cnx_t* c, path_slot_t* s){
+    if (s->idx >= 0 && s->idx < c->nb_paths && c->path[s->idx] &&
+        c->path[s->idx]->unique_path_id == s->upid) return s->idx;
+
+    s->idx = -1;
+    for (int i = 0; i < c->nb_paths; i++) {
+        if (c->path[i] && c->path[i]->unique_path_id == s->upid) { s->idx = i; break; }
+    }
+    return s->idx;
+}
+
+/**
+ * @brief 칸에 경로 인덱스와 로컬 IP, 품질 값을 채웁니다.
+ */
+static inline void ptab_fill(picoquic_cnx_t* c, path_slot_t* s){
+    int i = ptab_path_idx(c, s);
+    if (i >= 0 && c->path[i]->first_tuple) {
+        s->ip_be = ((struct sockaddr_in*)&c->path[i]->first_tuple->local_addr)->sin_addr.s_addr;
+    }
+
+    picoquic_path_quality_t q;
+    if (picoquic_get_path_quality(c, s->upid, &q) == 0) {
+        s->rtt_us     = q.smoothed_rtt;
+        s->pacing_Bps = q.pacing_rate;
+    }
+}
+
+/**
+ * @brief 핸드셰이크 완료 시 이미 있는 경로(0번 경로 등)를 테이블에 올립니다.
+ * 초기 경로는 path_available 이벤트가 오지 않으므로 한 번 훑습니다.
+ */
+static inline void ptab_seed(picoquic_cnx_t* c, tx_t* st, uint64_t now){
+    for (int i = 0; i < c->nb_paths; i++) {
+        picoquic_path_t* p = c->path[i];
+        if (!p || !p->first_tuple || !p->first_tuple->challenge_verified) continue;
+
+        path_slot_t* s = ptab_slot(st, p->unique_path_id);
+        if (!s) break;
+        s->state = PATH_ST_AVAILABLE;
+        s->since = now;
+        s->idx   = i;
+        ptab_fill(c, s);
+    }
+    st->path_gen++;
+}
+
+/**
+ * @brief 경로 콜백 이벤트를 테이블에 반영합니다.
+ * @return 1 경로 이벤트였음, 0 다른 이벤트
+ */
+static inline int ptab_on_event(picoquic_cnx_t* c, tx_t* st, picoquic_call_back_event_t ev, uint64_t upid){
+    int state;
+    switch (ev) {
+        case picoquic_callback_path_available:       state = PATH_ST_AVAILABLE; break;
+        case picoquic_callback_path_suspended:       state = PATH_ST_SUSPENDED; break;
+        case picoquic_callback_path_deleted:         state = PATH_ST_DELETED;   break;
+        case picoquic_callback_path_quality_changed: state = -1;                break;
+        default: return 0;
+    }
+
+    uint64_t now = picoquic_current_time();
+    path_slot_t* s = ptab_slot(st, upid);
+    st->path_events++;
+    if (!s) return 1;
+
+    /* 주 경로가 빠지면 다음 선택에서 체류 시간 없이 바로 전환 */
+    int prim = (st->last_primary_idx >= 0 && st->last_primary_idx < c->nb_paths &&
+                c->path[st->last_primary_idx] && c->path[st->last_primary_idx]->unique_path_id == upid);
+
+    if (state < 0) {
+        if (s->state == PATH_ST_NONE) s->state = PATH_ST_AVAILABLE;
+        ptab_fill(c, s);
+    } else {
+        if (state != PATH_ST_DELETED) ptab_fill(c, s);
+        if (s->state != state) {
+            struct in_addr ia = { .s_addr = s->ip_be };
+            LOGF("[PATH] upid=%" PRIu64 " %s %s%s", upid, inet_ntoa(ia),
+                 state == PATH_ST_AVAILABLE ? "available" : state == PATH_ST_SUSPENDED ? "suspended" : "deleted",
+                 prim ? " (primary)" : "");
+            s->state = state;
+            s->since = now;
+        }
+        if (state != PATH_ST_AVAILABLE && prim) st->last_switch_ts = 0;
+    }
+    st->path_gen++;
+    return 1;
+}
+
+/**
+ * @brief 로컬 IP의 경로 상태를 테이블에서 찾습니다. (c->path[]를 훑지 않음)
+ * @return 칸 포인터 (사용 가능한 칸 우선), 없으면 NULL
+ */
+static inline path_slot_t* ptab_by_ip(tx_t* st, uint32_t ip_be){
+    path_slot_t* any = NULL;
+    for (int i = 0; i < MAX_PATHS; i++) {
+        path_slot_t* s = &st->ptab[i];
+        if (s->state == PATH_ST_NONE || s->state == PATH_ST_DELETED || s->ip_be != ip_be) continue;
+        if (s->state == PATH_ST_AVAILABLE) return s;
+        if (!any) any = s;
+    }
+    return any;
+}
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef RACE_H
+#define RACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "picoquic.h"
+#include "picoquic_internal.h"
+#include "picoquic_utils.h"
+#include "struct_type.h"
+#include "path_sched.h"
+#include "path_table.h"
+
+/* ============================================================
+ * [1] 시작 시 인터페이스별 핸드셰이크 경쟁
+ * ============================================================ */
+
+/*
+ * 핸드셰이크는 주 소켓(Wi-Fi) 하나로만 했고, 다른 경로는 핸드셰이크가 끝난 뒤에야 probe했습니다.
+ * 부팅 때 Wi-Fi가 없으면 핸드셰이크 재전송 타이머만 돌다가 시작이 멈췄습니다.
+ * --race 1이면 설정된 인터페이스마다 초기 경로의 로컬 주소를 고정한 연결을 만들어 핸드셰이크를 경쟁시킵니다.
+ *   - 후보 순서: Wi-Fi(local_usb) → 핫스팟(local_alt) → --path 추가 역할, 시차 --race-stagger-ms (0: 동시에)
+ *   - 처음 almost_ready/ready가 온 후보를 st->cnx로 쓰고 원래 콜백으로 넘김 (그 전의 후보 이벤트는 버림)
+ *   - 진 후보는 닫아서 정리하고, 그 인터페이스는 이긴 연결에서 바로 probe해 경로로 붙임
+ * 어느 링크가 살아 있든 첫 프레임까지의 시간은 가장 빠른 링크의 핸드셰이크 시간이 됩니다.
+ */
+
+/**
+ * @brief 두 로컬 주소의 IP:포트가 같은지 봅니다.
+ */
+static inline int race_same_addr(const struct sockaddr_storage* x, const struct sockaddr_storage* y){
+    const struct sockaddr_in* a = (const struct sockaddr_in*)x;
+    const struct sockaddr_in* b = (const struct sockaddr_in*)y;
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+/**
+ * @brief 후보 로컬 주소를 더합니다. (IP:포트가 같으면 무시)
+ */
+static inline void race_add(race_t* r, const struct sockaddr_storage* la){
+    if (r->n >= MAX_PATHS || ((const struct sockaddr_in*)la)->sin_addr.s_addr == 0) return;
+    for (int i = 0; i < r->n; i++) {
+        if (race_same_addr(&r->local[i], la)) return;
+    }
+    r->local[r->n++] = *la;
+}
+
+/**
+ * @brief 설정된 인터페이스를 후보로 넣습니다. (Wi-Fi → 핫스팟 → 스케줄러가 probe하는 추가 역할)
+ */
+static inline void race_add_configured(tx_t* st){
+    if (st->has_local_usb) race_add(&st->race, &st->local_usb);
+    if (st->has_local_alt) race_add(&st->race, &st->local_alt);
+
+    for (int i = 0; i < st->nroles; i++) {
+        if (!st->roles[i].probe) continue;
+        struct sockaddr_storage ss;
+        struct sockaddr_in* la = (struct sockaddr_in*)&ss;
+        memset(&ss, 0, sizeof(ss));
+        la->sin_family      = AF_INET;
+        la->sin_port        = htons((uint16_t)(SCHED_PROBE_PORT + i));
+        la->sin_addr.s_addr = st->roles[i].ip_be;
+        race_add(&st->race, &ss);
+    }
+}
+
+/**
+ * @brief 경쟁 중 후보 연결의 콜백입니다. 처음 핸드셰이크가 끝난 후보를 이긴 연결로 정합니다.
+ */
+static int race_cb(picoquic_cnx_t* cnx, uint64_t stream_id, uint8_t* bytes, size_t length,
+                   picoquic_call_back_event_t ev, void* ctx, void* stream_ctx){
+    tx_t* st = (tx_t*)ctx;
+    race_t* r = &st->race;
+
+    if (r->winner < 0 && (ev == picoquic_callback_almost_ready || ev == picoquic_callback_ready)) {
+        for (int i = 0; i < r->n; i++) {
+            if (r->cnx[i] != cnx) continue;
+            r->winner = i;
+            st->cnx   = cnx;
+            picoquic_set_callback(cnx, r->app_cb, st);
+
+            const struct sockaddr_in* la = (const struct sockaddr_in*)&r->local[i];
+            LOGF("[RACE] %s:%d won in %.0fms (%d candidates)", inet_ntoa(la->sin_addr), ntohs(la->sin_port),
+                 (picoquic_current_time() - r->t0) / 1000.0, r->n);
+            return r->app_cb(cnx, stream_id, bytes, length, ev, ctx, stream_ctx);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 후보 연결을 만들고 경쟁을 시작합니다. 첫 후보는 이미 만든 연결(first)을 씁니다.
+ * 후보 주소는 미리 race_add로 넣어 두며, 2개 미만이면 경쟁하지 않습니다.
+ * @return 후보 수, 0 경쟁 안 함 (호출자가 first를 그대로 시작), -1 첫 후보 시작 실패
+ */
+static inline int race_start(picoquic_quic_t* q, tx_t* st, picoquic_cnx_t* first, const char* sni, const char* alpn,
+                             picoquic_stream_data_cb_fn app_cb, double stagger_ms, uint64_t now){
+    race_t* r = &st->race;
+    if (r->n < 2) {
+        r->n = 0;
+        return 0;
+    }
+
+    r->winner = -1;
+    r->probed = 0;
+    r->t0     = now;
+    r->app_cb = app_cb;
+
+    uint64_t stagger = stagger_ms > 0 ? (uint64_t)(stagger_ms * 1000.0) : 0;
+    for (int i = 0; i < r->n; i++) {
+        picoquic_cnx_t* c = i == 0 ? first : picoquic_create_cnx(q, picoquic_null_connection_id, picoquic_null_connection_id,
+                                                                  (struct sockaddr*)&st->peerA, now, 0, sni, alpn, 1);
+        r->cnx[i]      = c;
+        r->started[i]  = 0;
+        r->start_at[i] = now + stagger * (uint64_t)i;
+        if (!c) continue;
+
+        /* 초기 경로의 로컬 주소를 고정 → 패킷 루프가 그 인터페이스 소켓으로 보냄 */
+        picoquic_store_addr(&c->path[0]->first_tuple->local_addr, (struct sockaddr*)&r->local[i]);
+        picoquic_set_callback(c, race_cb, st);
+        ptab_enable(c);
+        picoquic_enable_keep_alive(c, 1);
+    }
+
+    st->cnx = first;
+    if (picoquic_start_client_cnx(first) != 0) return -1;
+    r->started[0] = 1;
+    return r->n;
+}
+
+/**
+ * @brief 남은 후보 연결을 모두 지웁니다. (재연결 시, st->cnx가 후보면 NULL로 바꿈)
+ */
+static inline void race_reset(tx_t* st){
+    race_t* r = &st->race;
+    for (int i = 0; i < r->n; i++) {
+        if (!r->cnx[i]) continue;
+        if (r->cnx[i] == st->cnx) st->cnx = NULL;
+        picoquic_delete_cnx(r->cnx[i]);
+        r->cnx[i] = NULL;
+    }
+    r->n = 0;
+}
+
+/**
+ * @brief 경쟁을 진행합니다: 시차가 된 후보 시작, 진 후보 닫기·정리, 진 인터페이스를 이긴 연결의 경로로 probe.
+ * (loop_cb 맨 앞에서 호출)
+ * @return 1 아직 경쟁 중 (loop_cb는 전송 로직을 건너뜀), 0 끝남
+ */
+static inline int race_poll(tx_t* st, uint64_t now){
+    race_t* r = &st->race;
+    int alive = 0, pending = 0;
+
+    for (int i = 0; i < r->n; i++) {
+        picoquic_cnx_t* c = r->cnx[i];
+        if (!c || i == r->winner) continue;
+
+        if (r->winner < 0) {
+            if (!r->started[i] && now >= r->start_at[i]) {
+                r->started[i] = 1;
+                if (picoquic_start_client_cnx(c) != 0) {
+                    picoquic_delete_cnx(c);
+                    r->cnx[i] = NULL;
+                    continue;
+                }
+            }
+            if (!r->started[i] || picoquic_get_cnx_state(c) < picoquic_state_disconnecting) alive++;
+            continue;
+        }
+
+        /* 진 후보: 시작 전이면 바로 지우고, 시작했으면 닫은 뒤 끊기면 지움 */
+        if (!r->started[i] || picoquic_get_cnx_state(c) == picoquic_state_disconnected) {
+            picoquic_delete_cnx(c);
+            r->cnx[i] = NULL;
+            continue;
+        }
+        if (picoquic_get_cnx_state(c) < picoquic_state_disconnecting) picoquic_close(c, 0);
+        pending++;
+    }
+
+    if (r->winner < 0) {
+        if (alive > 0) return 1;
+
+        /* 모든 후보 실패: 첫 후보를 st->cnx로 남겨 기존 처리(재연결 등)에 맡김 */
+        LOGF("[RACE] all %d candidates failed", r->n);
+        for (int i = 0; i < r->n; i++) {
+            if (r->cnx[i] && r->cnx[i] != st->cnx) picoquic_delete_cnx(r->cnx[i]);
+            r->cnx[i] = NULL;
+        }
+        r->n = 0;
+        return 0;
+    }
+
+    /* 진 인터페이스는 핸드셰이크가 확정되면 이긴 연결에서 바로 경로로 붙임 (기존 200/400ms 지연 probe 대신) */
+    if (!r->probed && picoquic_get_cnx_state(st->cnx) == picoquic_state_ready) {
+        for (int i = 0; i < r->n; i++) {
+            /* 이긴 후보의 인터페이스는 이미 초기 경로이므로 지연 probe도 하지 않음 */
+            if (st->has_local_alt && race_same_addr(&r->local[i], &st->local_alt)) st->didB = 1;
+            if (st->has_local_usb && race_same_addr(&r->local[i], &st->local_usb)) st->didC = 1;
+            if (i == r->winner) continue;
+            picoquic_probe_new_path(st->cnx, (struct sockaddr*)&st->peerA, (struct sockaddr*)&r->local[i], now);
+        }
+        r->probed = 1;
+    }
+
+    if (pending == 0 && r->probed) r->n = 0;
+    return 0;
+}
+
+#endif
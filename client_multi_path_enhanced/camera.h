@@ -1,6 +1,9 @@
 #ifndef CAMERA_H
 #define CAMERA_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -16,6 +19,16 @@ typedef void* camera_handle_t;   // ← 이것 그대로 사용
  */
 camera_handle_t camera_create();
 
+/**
+ * @brief 지정한 프레임 소스를 열고 핸들을 반환합니다. (camera_create와 같은 핸들)
+ * @param spec "종류[:인자][,키=값...]" 형식. NULL이면 camera_create와 동일합니다.
+ *   - camera[:/dev/videoN] : V4L2 MJPEG 직송, 실패 시 OpenCV 폴백 (v4l2 / opencv로 강제 가능)
+ *   - synthetic,size=B,fps=N,jitter=P,seed=S : 크기 B(±P%)의 합성 JPEG을 초당 N장 생성
+ *   - replay:DIR|FILE.seg[,fps=N][,loop=0|1] : frame_*.jpg 디렉토리(기록 시각대로) 또는 .seg 재생
+ * @return 성공 시 핸들, 실패 시 NULL을 반환합니다.
+ */
+camera_handle_t camera_open(const char* spec);
+
 /**
  * @brief camera_create로 생성된 카메라 객체를 소멸시키고 리소스를 해제합니다.
  * @param handle 소멸시킬 카메라의 핸들
@@ -31,6 +44,117 @@ void camera_destroy(camera_handle_t handle);
  */
 int camera_capture_jpeg(camera_handle_t handle, unsigned char* buffer, int buf_size);
 
+/**
+ * @brief 파이프라인(캡처 → 인코딩 분리)에서 사용하는 프레임 단위입니다.
+ * buf/cap은 호출자가 소유하며 camera_grab/camera_encode가 필요 시 realloc합니다.
+ */
+typedef struct {
+    unsigned char* buf;     /* 인코딩된 JPEG 데이터 (H.264 모드에서는 Annex-B AU) */
+    size_t   cap;           /* buf 용량 */
+    size_t   len;           /* JPEG 길이 (인코딩 전에는 0) */
+    uint64_t seq;           /* 파이프라인 순번 */
+    uint64_t t_cap_us;      /* 캡처 완료 시각 (CLOCK_MONOTONIC, us) */
+    uint64_t t_enc_us;      /* 인코딩 완료 시각 */
+    int      ok;            /* 인코딩 성공 여부 */
+    int      key;           /* 단독 디코딩 가능 여부 (JPEG은 항상 1, H.264는 IDR일 때만 1) */
+    void*    raw;           /* 소스 전용 원본 프레임 (인코딩 필요한 소스만) */
+} camera_frame_t;
+
+/**
+ * @brief 다음 프레임을 가져옵니다. 이미 압축된 소스(V4L2/합성/재생)는 buf에 바로 채우고,
+ *        OpenCV 소스는 디코딩된 원본만 raw에 담아 인코딩을 camera_encode로 미룹니다.
+ * @return 성공 시 0, 실패 시 음수
+ */
+int camera_grab(camera_handle_t handle, camera_frame_t* f);
+
+/**
+ * @brief raw 프레임을 JPEG으로 인코딩해 buf에 씁니다. 프레임별로 독립적이므로 여러 스레드에서 동시 호출 가능합니다.
+ * @return JPEG 길이, 실패 시 음수
+ */
+int camera_encode(camera_frame_t* f);
+
+/**
+ * @brief 프레임이 가진 버퍼와 원본을 해제합니다.
+ */
+void camera_frame_release(camera_frame_t* f);
+
+/**
+ * @brief 소스가 별도 인코딩 단계를 필요로 하는지 반환합니다. (OpenCV: 1, 나머지: 0)
+ */
+int camera_needs_encode(camera_handle_t handle);
+
+/**
+ * @brief JPEG 인코딩 파라미터입니다. (인코딩이 필요한 OpenCV 소스에만 적용)
+ */
+enum { CAM_JPEG_444 = 0, CAM_JPEG_422 = 1, CAM_JPEG_420 = 2, CAM_JPEG_GRAY = 3 };
+
+typedef struct {
+    int quality;        /* 1~100 */
+    int subsamp;        /* CAM_JPEG_444 / 422 / 420 / GRAY */
+    int restart_rows;   /* 재시작 마커 간격 (MCU 행 수, 0이면 없음) */
+    int scale_pct;      /* 인코딩 전 해상도 축소 비율 (10~100 %, 0이면 100) */
+} camera_jpeg_params_t;
+
+/**
+ * @brief 인코딩 파라미터를 바꿉니다. 모든 인코딩 워커에 다음 프레임부터 적용됩니다. (스레드 안전)
+ */
+void camera_set_jpeg_params(const camera_jpeg_params_t* p);
+
+/**
+ * @brief 현재 인코딩 파라미터를 가져옵니다.
+ */
+void camera_get_jpeg_params(camera_jpeg_params_t* p);
+
+/**
+ * @brief JPEG 인코더를 고릅니다. ("libjpeg" | "opencv")
+ * @return 성공 시 0, 이 빌드에서 쓸 수 없는 인코더면 -1
+ */
+int camera_set_encoder(const char* name);
+
+/**
+ * @brief 사용 중인 인코더 이름을 반환합니다. ("libjpeg-turbo", "opencv" 또는 H.264 모드의 "x264")
+ */
+const char* camera_encoder_name(void);
+
+/**
+ * @brief 인코딩 코덱입니다. H.264는 앞 프레임을 참조하므로 인코딩 워커 1개에서 순서대로만 인코딩해야 합니다.
+ */
+enum { CAM_CODEC_JPEG = 0, CAM_CODEC_H264 = 1 };
+
+typedef struct {
+    int gop;            /* 키프레임 간격 (프레임 수) */
+    int bitrate_kbps;   /* 목표 비트레이트 (ABR 품질 단계에 비례해 낮춰 적용) */
+} camera_h264_params_t;
+
+/**
+ * @brief 코덱을 고릅니다. ("jpeg" | "h264") 인코딩이 필요한 OpenCV 소스에만 적용됩니다.
+ * @return 성공 시 0, 이 빌드에서 쓸 수 없으면(HAVE_X264 없음) -1
+ */
+int camera_set_codec(const char* name);
+
+/**
+ * @brief 현재 코덱을 반환합니다. (CAM_CODEC_JPEG / CAM_CODEC_H264)
+ */
+int camera_codec(void);
+
+/**
+ * @brief H.264 파라미터를 바꿉니다. 0인 필드는 유지합니다. GOP 변경은 인코더를 다시 엽니다.
+ */
+void camera_set_h264_params(const camera_h264_params_t* p);
+void camera_get_h264_params(camera_h264_params_t* p);
+
+/**
+ * @brief 다음 인코딩 프레임을 IDR로 강제합니다. (전송에서 AU가 빠져 참조가 끊겼을 때)
+ */
+void camera_request_keyframe(void);
+
+/**
+ * @brief 사용 중인 프레임 소스 이름을 반환합니다.
+ * @param handle 카메라 핸들
+ * @return "v4l2-mjpeg", "opencv", "synthetic", "replay" 중 하나
+ */
+const char* camera_backend_name(camera_handle_t handle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -6,70 +6,305 @@
 #include "quic_helpers.h"
 #include "path_algo.h"
 
+/* ============================================================
+ * [1] 인코딩 워커 단계
+ * ============================================================ */
+
+/**
+ * @brief raw_q에서 프레임을 꺼내 JPEG으로 인코딩한 뒤 enc_q로 넘깁니다.
+ * 워커끼리는 프레임 단위로 독립적이므로 완료 순서가 뒤바뀔 수 있습니다. (재정렬은 sequencer 담당)
+ */
+static void* pipe_encoder_main(void* arg)
+{
+    cam_pipe_t* p = (cam_pipe_t*)arg;
+    unsigned spins = 0;
+
+    while (!p->stop) {
+        camera_frame_t* f = (camera_frame_t*)pq_pop(&p->raw_q);
+        if (!f) { pipe_idle(&spins); continue; }
+        spins = 0;
+
+        uint64_t t0 = pipe_now_us();
+        if (camera_encode(f) <= 0) pipe_add(&p->stats.enc_fail, 1);
+        f->t_enc_us = pipe_now_us();
+        pipe_add(&p->stats.enc_frames, 1);
+        pipe_add(&p->stats.enc_us, f->t_enc_us - t0);
+
+        /* enc_q 용량 = 프레임 수이므로 실패하지 않지만, 방어적으로 재시도 */
+        while (pq_push(&p->enc_q, f) != 0 && !p->stop) sched_yield();
+    }
+    return NULL;
+}
+
+
+/* ============================================================
+ * [2] 재정렬(sequencer) 단계
+ * ============================================================ */
+
+/**
+ * @brief 1초마다 단계별 처리량과 평균 소요 시간, 병목 단계를 기록합니다.
+ */
+static void pipe_log_stats(cam_pipe_t* p, pipe_stats_t* prev, uint64_t dt_us)
+{
+    pipe_stats_t* s = &p->stats;
+    uint64_t cf = atomic_load(&s->cap_frames),  cu = atomic_load(&s->cap_us),  cd = atomic_load(&s->cap_drops);
+    uint64_t ef = atomic_load(&s->enc_frames),  eu = atomic_load(&s->enc_us),  ex = atomic_load(&s->enc_fail);
+    uint64_t sf = atomic_load(&s->seq_frames),  su = atomic_load(&s->seq_wait_us);
+    uint64_t nf = atomic_load(&s->net_frames),  nu = atomic_load(&s->net_lat_us);
+
+    uint64_t d_cf = cf - atomic_load(&prev->cap_frames), d_cu = cu - atomic_load(&prev->cap_us);
+    uint64_t d_ef = ef - atomic_load(&prev->enc_frames), d_eu = eu - atomic_load(&prev->enc_us);
+    uint64_t d_sf = sf - atomic_load(&prev->seq_frames), d_su = su - atomic_load(&prev->seq_wait_us);
+    uint64_t d_nf = nf - atomic_load(&prev->net_frames), d_nu = nu - atomic_load(&prev->net_lat_us);
+
+    double sec   = dt_us / 1e6;
+    double cap_ms = d_cf ? d_cu / 1e3 / d_cf : 0.0;
+    double enc_ms = d_ef ? d_eu / 1e3 / d_ef : 0.0;
+    double seq_ms = d_sf ? d_su / 1e3 / d_sf : 0.0;
+    double net_ms = d_nf ? d_nu / 1e3 / d_nf : 0.0;
+
+    /* 병목: 워커 수로 나눈 프레임당 점유 시간이 가장 긴 단계 (네트워크는 캡처→전송 지연에서 앞 단계를 뺀 값) */
+    double enc_eff = enc_ms / (p->n_enc > 0 ? p->n_enc : 1);
+    double net_eff = net_ms - cap_ms - enc_ms - seq_ms;
+    const char* neck = "capture";
+    double worst = cap_ms;
+    if (enc_eff > worst) { worst = enc_eff; neck = "encode"; }
+    if (net_eff > worst) { worst = net_eff; neck = "network"; }
+
+    LOGF("[PIPE] cap=%.1ffps/%.2fms enc=%.1ffps/%.2fms x%d seq_wait=%.2fms net=%.1ffps cap->send=%.2fms "
+         "bottleneck=%s drops(cap=%" PRIu64 " enc_fail=%" PRIu64 ") q(raw=%zu enc=%zu)",
+         d_cf / sec, cap_ms, d_ef / sec, enc_ms, p->n_enc, seq_ms, d_nf / sec, net_ms,
+         neck, cd, ex, pq_depth(&p->raw_q), pq_depth(&p->enc_q));
+
+    atomic_store(&prev->cap_frames, cf);  atomic_store(&prev->cap_us, cu);
+    atomic_store(&prev->enc_frames, ef);  atomic_store(&prev->enc_us, eu);
+    atomic_store(&prev->seq_frames, sf);  atomic_store(&prev->seq_wait_us, su);
+    atomic_store(&prev->net_frames, nf);  atomic_store(&prev->net_lat_us, nu);
+}
+
+/**
+ * @brief 인코딩이 끝난 프레임을 캡처 순번대로 모아 최신 프레임 우편함(cam_mb)에 발행합니다.
+ * 동시에 떠 있는 프레임은 PIPE_FRAMES개 이하이므로 seq % PIPE_FRAMES 슬롯이 겹치지 않습니다.
+ */
+static void* pipe_sequencer_main(void* arg)
+{
+    tx_t* st = (tx_t*)arg;
+    cam_pipe_t* p = &st->pipe;
+    camera_frame_t* pending[PIPE_FRAMES] = { 0 };
+    uint64_t next = 1;
+    unsigned spins = 0;
+
+    pipe_stats_t prev;
+    memset(&prev, 0, sizeof(prev));
+    uint64_t last_log = pipe_now_us();
+
+    while (!p->stop) {
+        camera_frame_t* f = (camera_frame_t*)pq_pop(&p->enc_q);
+        int got = (f != NULL);
+        if (got) {
+            spins = 0;
+            pending[f->seq % PIPE_FRAMES] = f;
+        }
+
+        /* 순번이 이어지는 동안 발행 */
+        while ((f = pending[next % PIPE_FRAMES]) != NULL && f->seq == next) {
+            pending[next % PIPE_FRAMES] = NULL;
+            next++;
+
+            if (f->ok) {
+                pipe_add(&p->stats.seq_frames, 1);
+                pipe_add(&p->stats.seq_wait_us, pipe_now_us() - f->t_enc_us);
+                /* 프레임 버퍼와 우편함 back 슬롯 버퍼를 맞바꿈 (복사 없음) */
+                mb_publish_swap(&st->cam_mb, &f->buf, &f->cap, f->len, f->t_cap_us, f->key);
+            }
+            f->len = 0;
+            f->ok  = 0;
+            pq_push(&p->free_q, f);
+        }
+
+        uint64_t now = pipe_now_us();
+        if (now - last_log >= PIPE_LOG_US) {
+            pipe_log_stats(p, &prev, now - last_log);
+            last_log = now;
+        }
+
+        if (!got) pipe_idle(&spins);
+    }
+    return NULL;
+}
+
+
+/* ============================================================
+ * [3] 캡처 단계 (파이프라인 기동/종료 포함)
+ * ============================================================ */
+
+/**
+ * @brief 인코딩 워커 수를 정합니다. 0이면 자동: 인코딩이 필요한 소스는 (코어 수 - 1, 최대 3), 압축 소스는 1
+ * H.264는 앞 프레임을 참조하므로 항상 1 (병렬성은 x264 내부 슬라이스 스레드가 담당)
+ */
+static int pipe_pick_workers(tx_t* st)
+{
+    int n = st->pipe.n_enc;
+    if (camera_needs_encode(st->cam) && camera_codec() == CAM_CODEC_H264) {
+        if (n > 1) LOGF("[CAM] h264: enc-workers %d -> 1 (inter-frame codec)", n);
+        return 1;
+    }
+    if (n <= 0) {
+        if (camera_needs_encode(st->cam)) {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            n = cpus > 1 ? (int)cpus - 1 : 1;
+            if (n > 3) n = 3;
+        } else {
+            n = 1;
+        }
+    }
+    if (n > PIPE_ENC_MAX) n = PIPE_ENC_MAX;
+    return n;
+}
+
 /**
  * @brief 카메라 캡처를 담당하는 백그라운드 스레드의 메인 함수입니다.
- * * 이 스레드는 독립적으로 실행되며, 카메라로부터 MJPEG/JPEG 프레임을 읽어와
- * tx_t 구조체의 공유 버퍼(cam_buf)에 저장합니다.
+ * * 이 스레드가 파이프라인의 캡처 단계이며, 인코딩 워커와 재정렬 스레드를 띄우고 정리합니다.
+ * 캡처 단계는 프레임을 가져와 순번만 붙이고 곧바로 raw_q에 넘기므로 인코딩 시간에 묶이지 않습니다.
  */
 static void* camera_thread_main(void* arg)
 {
     tx_t* st = (tx_t*)arg;
-    
+    cam_pipe_t* p = &st->pipe;
+    camera_frame_t scratch;
+    memset(&scratch, 0, sizeof(scratch));
+
     LOGF("[CAM] thread started");
 
-    /* st->cam_stop 플래그가 1이 될 때까지 무한 루프 수행 */
-    while (!st->cam_stop) {
+    /* 0. 카메라 객체가 아직 생성되지 않았다면 대기 */
+    while (!st->cam && !st->cam_stop) usleep(10000);
+    if (st->cam_stop) return NULL;
 
-        /* 0. 카메라 객체가 아직 생성되지 않았다면 잠시 대기 */
-        if (!st->cam) {
-            usleep(10000);  // 10ms 대기
-            continue;
-        }
+    /* 1. 프레임 풀과 큐 준비, 하위 단계 스레드 기동 */
+    pq_init(&p->free_q);
+    pq_init(&p->raw_q);
+    pq_init(&p->enc_q);
+    memset(p->frames, 0, sizeof(p->frames));
+    for (int i = 0; i < PIPE_FRAMES; i++) pq_push(&p->free_q, &p->frames[i]);
 
-        /* 1. 캡처용 공유 버퍼 용량 확보 */
-        /* 초기 상태이거나 버퍼가 너무 작으면 최소 1MB(1u << 20)로 확장합니다. */
-        if (st->cam_cap < (1u << 20)) {
+    p->stop  = 0;
+    p->n_enc = pipe_pick_workers(st);
+    int n_started = 0;
+    for (int i = 0; i < p->n_enc; i++) {
+        if (pthread_create(&p->enc_th[i], NULL, pipe_encoder_main, p) != 0) break;
+        n_started++;
+    }
+    int seq_started = (n_started > 0 && pthread_create(&p->seq_th, NULL, pipe_sequencer_main, st) == 0);
+    if (!seq_started) {
+        LOGF("[CAM] pipeline thread start failed");
+        st->cam_stop = 1;
+    }
+    p->n_enc = n_started;
+    LOGF("[CAM] pipeline: capture -> encode x%d -> sequencer -> mailbox", p->n_enc);
 
-            uint8_t* tmp = (uint8_t*)realloc(st->cam_buf, 1u << 20);
+    /* 2. 캡처 루프: st->cam_stop 플래그가 1이 될 때까지 */
+    uint64_t seq = 0;
+    while (!st->cam_stop) {
 
-            if (!tmp) {
-                LOGF("[CAM] realloc failed");
-                usleep(10000);
-                continue;
-            }
+        /* 빈 프레임이 없으면(하위 단계가 밀림) 카메라를 비우기 위해 임시 프레임에 받아 버림 */
+        camera_frame_t* f = (camera_frame_t*)pq_pop(&p->free_q);
+        int dropping = (f == NULL);
+        if (dropping) f = &scratch;
 
-            st->cam_buf = tmp;
-            st->cam_cap = 1u << 20;
+        uint64_t t0 = pipe_now_us();
+        int r = camera_grab(st->cam, f);
+
+        /* 캡처 실패 시 프레임 반환 후 다음 루프로 */
+        if (r != 0) {
+            if (!dropping) pq_push(&p->free_q, f);
+            continue;
         }
 
-        /* 2. 실제 카메라 프레임 캡처 (블로킹 모드) */
-        /* camera_capture_jpeg 함수를 통해 JPEG 데이터를 cam_buf에 직접 씁니다. */
-        int n = camera_capture_jpeg(st->cam, st->cam_buf, (int)st->cam_cap);
-        
-        /* 캡처 실패 또는 비정상적인 크기일 경우 스킵 */
-        if (n <= 0 || (size_t)n > st->cam_cap) {
-            // 실패 시 CPU 점유율 방지를 위해 짧게 휴식할 수 있으나, 
-            // 여기서는 원본 로직에 따라 즉시 다음 루프로 진입합니다.
+        f->t_cap_us = pipe_now_us();
+        pipe_add(&p->stats.cap_frames, 1);
+        pipe_add(&p->stats.cap_us, f->t_cap_us - t0);
+
+        if (dropping) {
+            pipe_add(&p->stats.cap_drops, 1);
             continue;
         }
 
-        /* 3. 공유 자원 업데이트를 위한 뮤텍스 락(Lock) */
-        /* 메인 루프(loop_cb)가 최신 프레임을 인지할 수 있도록 메타데이터만 보호합니다. */
-        pthread_mutex_lock(&st->cam_mtx);
-        
-        st->cam_len = n;      // 캡처된 데이터의 실제 길이 업데이트
-        st->cam_seq++;        // 프레임 시퀀스 번호 증가 (새 데이터가 왔음을 알림)
-        
-        pthread_mutex_unlock(&st->cam_mtx);
-        
-        /* * 이 시점에서 loop_cb(메인 루프)는 st->cam_seq의 변화를 감지하고
-         * 이 cam_buf의 내용을 자신의 전송 버퍼로 복사하여 전송하게 됩니다.
-         */
+        /* 3. 순번을 붙여 인코딩 단계로 (raw_q 용량 = 프레임 수이므로 실패하지 않음) */
+        f->seq = ++seq;
+        while (pq_push(&p->raw_q, f) != 0 && !st->cam_stop) sched_yield();
     }
 
+    /* 4. 하위 단계 종료 후 프레임 자원 해제 */
+    p->stop = 1;
+    for (int i = 0; i < n_started; i++) pthread_join(p->enc_th[i], NULL);
+    if (seq_started) pthread_join(p->seq_th, NULL);
+    for (int i = 0; i < PIPE_FRAMES; i++) camera_frame_release(&p->frames[i]);
+    camera_frame_release(&scratch);
+
     LOGF("[CAM] thread exit");
-    
+
     return NULL;
 }
 
-#endif
\ No newline at end of file
+
+/* ============================================================
+ * [4] 인터 프레임 코덱 전송 게이트 (H.264)
+ * ============================================================ */
+
+/**
+ * @brief 코덱을 설정하고 프레임 소스를 엽니다. (main에서 camera_open 대신 호출)
+ * H.264는 raw 프레임이 필요하므로 소스를 지정하지 않았으면 OpenCV 캡처로 열고,
+ * 이미 압축된 소스(MJPEG 직송/합성/재생)이면 JPEG 직송으로 되돌립니다.
+ * @param codec "jpeg" | "h264" (NULL이면 CAM_CODEC 환경 변수 또는 jpeg)
+ */
+static camera_handle_t camera_open_codec(const char* source, const char* codec, int gop, int bitrate_kbps)
+{
+    if (codec && camera_set_codec(codec) != 0) {
+        LOGF("[WRN] codec %s not available in this build (HAVE_X264), using jpeg", codec);
+    }
+    camera_h264_params_t hp = { gop, bitrate_kbps };
+    camera_set_h264_params(&hp);
+
+    if (camera_codec() == CAM_CODEC_H264 && !source) source = "opencv";
+
+    camera_handle_t cam = camera_open(source);
+    if (!cam || camera_codec() != CAM_CODEC_H264) return cam;
+
+    if (!camera_needs_encode(cam)) {
+        LOGF("[WRN] h264 needs a raw source, %s is already compressed: using jpeg passthrough", camera_backend_name(cam));
+        camera_set_codec("jpeg");
+    } else {
+        camera_get_h264_params(&hp);
+        LOGF("[MAIN] codec=h264 gop=%d bitrate=%dkbps", hp.gop, hp.bitrate_kbps);
+    }
+    return cam;
+}
+
+/**
+ * @brief 우편함에서 꺼낸 프레임을 보내도 되는지 판단합니다. (loop_cb에서 전송 직전에 호출)
+ * 직전 전송 이후 프레임이 하나라도 빠졌으면(우편함 덮어쓰기, ABR 건너뜀, 전송 실패) 참조가 끊긴 것이므로
+ * IDR을 요청하고, 키프레임이 올 때까지 P 프레임은 버립니다. JPEG 프레임은 항상 통과합니다.
+ * @return 보내면 1, 버리면 0
+ */
+static inline int au_gate(tx_t* st, const mb_slot_t* fr)
+{
+    if (fr->key) {
+        st->au_need_key = 0;
+        return 1;
+    }
+    if (!st->au_need_key && fr->seq == st->au_last_seq + 1) return 1;
+
+    if (!st->au_need_key) {
+        LOGF("[CAM] h264: AU gap (seq %" PRIu64 " after %" PRIu64 "), waiting for IDR", fr->seq, st->au_last_seq);
+    }
+    /* 요청한 IDR도 덮여 빠질 수 있으므로, 파이프라인 깊이만큼 기다려도 안 오면 다시 요청 */
+    if (st->au_need_key == 0 || st->au_need_key > PIPE_FRAMES) {
+        camera_request_keyframe();
+        st->au_need_key = 0;
+    }
+    st->au_need_key++;
+    st->au_gated++;
+    return 0;
+}
+
+#endif
@@ -5,6 +5,13 @@
 #include "quic_helpers.h"
 #include "path_algo.h"
 #include "camera_task.h"
+#include "abr.h"
+#include "stripe.h"
+#include "path_sched.h"
+#include "path_table.h"
+#include "mloop.h"
+#include "netmon.h"
+#include "race.h"
 
 /* ============================================================
  * [1] 연결 상태 및 콜백 이벤트 처리
@@ -25,6 +32,7 @@ static void on_cb_event(picoquic_call_back_event_t ev, tx_t* st, picoquic_cnx_t*
             st->ready_ts_us = picoquic_current_time();
             st->hs_done_ts = picoquic_current_time();
             LOGF("[CB] handshake complete → ready");
+            ptab_seed(cnx, st, picoquic_current_time());
             break;
 
         case picoquic_callback_close:
@@ -48,9 +56,18 @@ static int client_cb(
     picoquic_call_back_event_t ev, void* ctx,
     void* stream_ctx
 ){
-    (void)stream_id; (void)bytes; (void)length; (void)stream_ctx;
-    
     tx_t* st = (tx_t*)ctx;
+
+    /* JIT 송신: picoquic이 패킷을 만들 때 active 스트림 데이터를 요청 */
+    if (st && ev == picoquic_callback_prepare_to_send) {
+        return jit_prepare_to_send(cnx, st, stream_id, bytes, length, stream_ctx);
+    }
+
+    /* 경로 이벤트: 경로 테이블만 갱신 (stream_id = unique_path_id) */
+    if (st && ptab_on_event(cnx, st, ev, stream_id)) {
+        return 0;
+    }
+
     if (st) {
         on_cb_event(ev, st, cnx);
     }
@@ -78,6 +95,10 @@ static int loop_cb(
     /* 0. 기본 상태 확인 */
     if (!st || !c) return 0;
 
+    /* 시작 경쟁 중에는 후보 연결만 돌리고, 이긴 연결을 st->cnx로 씀 */
+    if (st->race.n && race_poll(st, now)) return 0;
+    c = st->cnx;
+
     picoquic_state_enum cs = picoquic_get_cnx_state(c);
 
     if (cs >= picoquic_state_disconnecting && !st->closing) {
@@ -101,34 +122,17 @@ static int loop_cb(
     /* 2. 0번 경로(Path 0) 생존성 보장 */
     ensure_path0_alive(c);
 
-    /* 3. 와이파이 생존 확인 및 복구 */
-    int wlan_alive = 0;
-    for (int i = 0; i < c->nb_paths; i++) {
-        picoquic_path_t* p = c->path[i];
-        if (p && p->first_tuple && p->first_tuple->challenge_verified) {
-            struct sockaddr_in* la = (struct sockaddr_in*)&p->first_tuple->local_addr;
-            if (la->sin_addr.s_addr == st->ip_wlan_be) {
-                wlan_alive = 1;
-                break;
-            }
-        }
-    }
+    /* 3. 와이파이 생존 확인 및 복구 (경로 이벤트 테이블 조회, 끊김 이벤트가 오면 폴링 주기를 기다리지 않음) */
+    path_slot_t* ws = ptab_by_ip(st, st->ip_wlan_be);
+    int wlan_alive = ws && ws->state == PATH_ST_AVAILABLE;
 
     static uint64_t last_probe_ts = 0;
-    if (!wlan_alive && (now - last_probe_ts > 2000000)) {
+    static int wlan_was_alive = 0;
+    if (!wlan_alive && (wlan_was_alive || now - last_probe_ts > 2000000)) {
         LOGF("==========================================================");
         LOGF("[DIAG] Wi-Fi Down. Checking existing paths...");
 
-        int wlan_path_idx = -1;
-        for (int i = 0; i < c->nb_paths; i++) {
-            if (c->path[i] && c->path[i]->first_tuple) {
-                struct sockaddr_in* la = (struct sockaddr_in*)&c->path[i]->first_tuple->local_addr;
-                if (la->sin_addr.s_addr == st->ip_wlan_be) {
-                    wlan_path_idx = i;
-                    break;
-                }
-            }
-        }
+        int wlan_path_idx = ws ? ptab_path_idx(c, ws) : -1;
 
         if (wlan_path_idx != -1) {
             LOGF("[DIAG] Wi-Fi path exists (ID:%d). Re-probing...", wlan_path_idx);
@@ -144,32 +148,21 @@ static int loop_cb(
         last_probe_ts = now;
         LOGF("==========================================================");
     }
+    wlan_was_alive = wlan_alive;
 
     /* 4. 핫스팟 프로빙 검사 확대*/
         if (st->has_local_alt) {
             
-            int alt_path_idx = -1;
-            int is_verified = 0;
-
-            /* 현재 핫스팟 경로(Path)가 존재하는지 찾기 */
-            for (int i = 0; i < c->nb_paths; i++) {
-                picoquic_path_t* p = c->path[i];
-                if (p && p->first_tuple) {
-                    struct sockaddr_in* la = (struct sockaddr_in*)&p->first_tuple->local_addr;
-                    /* 내 로컬 IP가 핫스팟 IP와 일치하는가? */
-                    if (la->sin_addr.s_addr == st->ip_usb_be) { 
-                        alt_path_idx = i;
-                        if (p->first_tuple->challenge_verified) {
-                            is_verified = 1;
-                        }
-                        break; /* 찾았으면 중단 (첫 번째 경로 사용) */
-                    }
-                }
-            }
+            /* 현재 핫스팟 경로(Path)가 존재하는지 경로 이벤트 테이블에서 찾기 */
+            path_slot_t* as = ptab_by_ip(st, st->ip_usb_be);
+            int alt_path_idx = as ? ptab_path_idx(c, as) : -1;
+            int is_verified  = alt_path_idx >= 0 && as->state == PATH_ST_AVAILABLE;
 
-            /* 1초마다 상태 확인 */
+            /* 1초마다 상태 확인 (suspended/deleted 이벤트로 테이블이 바뀌면 바로) */
             static uint64_t last_alt_probe = 0;
-            if (now - last_alt_probe > 1000000) {
+            static uint64_t alt_seen_gen = 0;
+            if (now - last_alt_probe > 1000000 || (!is_verified && st->path_gen != alt_seen_gen)) {
+                alt_seen_gen = st->path_gen;
                 
                 /* CASE A: 아예 경로가 없다면 -> 생성 시도 (최초 1회 or 재생성) */
                 if (alt_path_idx == -1) {
@@ -200,6 +193,12 @@ static int loop_cb(
             }
         }
 
+    /* 인터페이스 감시 이벤트: 새 주소는 바로 probe, 사라진 주소의 경로는 바로 abandon */
+    netmon_poll(c, st, now);
+
+    /* 설정된 추가 인터페이스(--path)도 경로를 열고 검증을 유지 */
+    sched_probe_roles(c, st, now);
+
     /* 5. Keep-alive */
     if (now - st->last_keepalive_us > ONE_SEC_US) {
         static const uint8_t ka = 0;
@@ -210,21 +209,23 @@ static int loop_cb(
         st->last_keepalive_us = now;
     }
 
-    /* 6. 카메라 전송 */
+    /* 전달 기한이 지난 프레임은 재전송하지 않고 버림 (프레임별 스트림은 reset) */
+    jit_expire(c, st);
+
+    /* 6. 카메라 전송 (lock-free 우편함에서 최신 프레임을 복사 없이 획득) */
     int cam_len = 0;
-    pthread_mutex_lock(&st->cam_mtx);
-    if (st->cam_seq != st->last_sent_seq && st->cam_len > 0) {
-        if (st->cap_cap < (size_t)st->cam_len) {
-            uint8_t* tmp = realloc(st->cap_buf, st->cam_len);
-            if (tmp) { st->cap_buf = tmp; st->cap_cap = st->cam_len; }
-        }
-        if (st->cap_buf) {
-            memcpy(st->cap_buf, st->cam_buf, st->cam_len);
-            cam_len = st->cam_len;
-            st->last_sent_seq = st->cam_seq;
-        }
+    const mb_slot_t* fr = mb_acquire(&st->cam_mb);
+    if (fr && fr->len > 0) {
+        cam_len = (int)fr->len;
+        st->last_sent_seq = fr->seq;
+
+        /* H.264: 참조가 끊긴 AU는 다음 IDR까지 보내지 않음 (JPEG은 항상 통과) */
+        if (!au_gate(st, fr)) cam_len = 0;
     }
-    pthread_mutex_unlock(&st->cam_mtx);
+
+    /* 경로별 품질 추정기 갱신 (표본 간격 20ms, 경로당 O(1)) + 하트비트 생존 감지 */
+    est_update(c, st, now);
+    hb_update(c, st, now);
 
     if (cam_len > 0) {
         pathsel_t sel[MAX_PATHS];
@@ -257,8 +258,7 @@ static int loop_cb(
         }
 
         if (sc > 0) {
-            int k = pick_primary_idx(c, sel, sc, st->ip_wlan_be, st->ip_usb_be, 
-                                &st->last_primary_idx, now, &st->last_switch_ts);
+            int k = sched_pick(c, st, sel, sc, now);
             
             /* ================================================================
              * [CRITICAL FIX] 세그멘테이션 오류 방지 (Null Pointer Check)
@@ -268,19 +268,55 @@ static int loop_cb(
                 
                 picoquic_path_t* sel_p = c->path[k];
 
-                /* 1. 검증 안 된 경로면 챌린지 발송 (심폐소생술) */
-                if (!sel_p->first_tuple->challenge_verified) {
+                /* 1. 검증 안 된 경로면 챌린지 발송 (심폐소생술, 하트비트 응답 대기 중이면 이미 나가 있음) */
+                if (!sel_p->first_tuple->challenge_verified && !hb_inflight(st, c, k)) {
                      picoquic_set_path_challenge(c, k, now);
                 }
 
-                /* 2. 전송 */
-                size_t hlen = varint_enc(cam_len, st->lenb);
-                int ret = send_on_path_safe(c, st, k, st->lenb, hlen, st->cap_buf, cam_len);
-                
+                /* 2. ABR: 품질/해상도/프레임률 단계 조정, 프레임률 제한에 걸리면 이번 프레임은 건너뜀 */
+                if (!abr_on_frame(&st->abr, sel_p, k, (size_t)cam_len, now)) {
+                    picoquic_set_app_wake_time(c, now + 5000);
+                    return 0;
+                }
+
+                /* 송신 큐 허용: 경로 스트림에 이미 예산 이상 밀려 있으면 새 프레임을 쌓지 않고 건너뜀 (다음 차례엔 최신 프레임) */
+                if (!admit_frame(&st->admit, c, st->sid_per_path[k], k, jit_ahead_bytes(st, k), (size_t)cam_len, now)) {
+                    picoquic_set_app_wake_time(c, now + 5000);
+                    return 0;
+                }
+
+                /* 3. 전송: 우편함 슬롯 버퍼를 복사 없이 넘겨받아 경로 스트림에 대기 (prepare_to_send에서 직렬화) */
+                tx_frame_t* tf = txf_take(st, fr);
+                if (!tf) {
+                    picoquic_set_app_wake_time(c, now + 5000);
+                    return 0;
+                }
+                /* 송신 가능한 경로 목록 (주 경로 먼저): 중복 전송과 스트라이핑에 사용 */
+                int cand[MAX_PATHS], cc = 0, np = 0, k2 = -1;
+                stripe_chunk_t plan[MAX_PATHS];
+                if (st->stripe || st->red_pct > 0) {
+                    if (path_sane_for_send(c, st, k)) cand[cc++] = k;
+                    for (int i = 0; i < c->nb_paths && cc < MAX_PATHS; i++) {
+                        if (i != k && path_sane_for_send(c, st, i) && !est_suspect(st, c, i)) cand[cc++] = i;
+                    }
+                }
+                /* 경로 전환 중이거나 주 경로가 불확실하면 두 경로로 중복 전송, 아니면 스트라이핑 */
+                if (cc > 1) k2 = red_pick(c, st, k, cand, cc, tf, now);
+                if (k2 < 0 && st->stripe && cc > 1) np = stripe_plan(c, st, cand, cc, tf->len, plan);
+
+                int ret = (k2 >= 0) ? red_send(c, st, tf, k, k2)
+                        : (np > 1)  ? stripe_send(c, st, tf, plan, np)
+                        : send_frame_jit(c, st, k, tf);
+                txf_release(tf);
+
                 if (ret != 0) {
                     // 전송 실패 시 로그 (디버깅용)
                     // LOGF("[WRN] Send failed on path %d (ret=%d)", k, ret);
                 }
+                else {
+                    /* 캡처 → 전송 지연은 jit_prepare_to_send에서 마지막 바이트를 직렬화할 때 계측 */
+                    st->au_last_seq = fr->seq;
+                }
 
             } else {
                 /* 유효하지 않은 경로가 선택됨 -> 전송 포기하고 다음 턴을 기약 */
@@ -306,10 +342,59 @@ int main(int argc, char** argv){
     const char* local_usb_ip  = "192.168.0.170";      // Wi-Fi (wlan0 등)
     int port = 4433;
 
-    if (argc > 1 && argv[1][0]) server_ip     = argv[1];
-    if (argc > 2 && argv[2][0]) local_alt_ip  = argv[2];
-    if (argc > 3 && argv[3][0]) port          = atoi(argv[3]);
-    if (argc > 4 && argv[4][0]) local_usb_ip  = argv[4];
+    /* --옵션은 먼저 분리하고, 나머지는 기존 위치 인자로 해석 */
+    const char* source = NULL;    /* 프레임 소스 (NULL: 카메라) */
+    int enc_workers = 0;          /* 인코딩 워커 수 (0: 자동) */
+    double abr_target_ms = ABR_TARGET_MS_DEFAULT;   /* 프레임 전달 목표 시간 (0: ABR 끔) */
+    double queue_budget_ms = ADMIT_BUDGET_MS_DEFAULT;   /* 송신 큐 대기 허용 시간 (0: 끔) */
+    const char* codec = NULL;     /* jpeg | h264 (NULL: CAM_CODEC 환경 변수) */
+    int gop = 0;                  /* H.264 키프레임 간격 (0: 기본 60) */
+    int bitrate_kbps = 0;         /* H.264 목표 비트레이트 (0: 기본 2000) */
+    const char* stream_mode = "path";   /* path: 경로별 장수 스트림 | frame: 프레임별 스트림 + FIN */
+    double deadline_ms = FRAME_DEADLINE_MS_DEFAULT;   /* 프레임 전달 기한 (0: 끔) */
+    int stripe = 0;               /* 1: 프레임을 검증된 경로들로 나눠 보냄 */
+    double red_pct = 0;           /* 중복 전송 추가 대역 예산 (%, 0: 끔) */
+    const char* sched_name = "priority";   /* 주 경로 선택 정책: priority | minrtt | wrr | cost */
+    const char* path_specs[MAX_PATHS];     /* --path IP[:PRIO[:COST]] (경로 역할) */
+    int npath_specs = 0;
+    double est_half_life_ms = EST_HALF_LIFE_MS_DEFAULT;   /* 경로 추정기 반감기 */
+    double heartbeat_ms = HB_IDLE_MS_DEFAULT;             /* 유휴 경로 하트비트 간격 (0: 끔) */
+    int use_gso = 1;              /* 1: 패킷 루프에서 UDP GSO/GRO 사용 */
+    int race = 0;                 /* 1: 시작 시 설정된 인터페이스마다 핸드셰이크 경쟁 */
+    double race_stagger_ms = 0;   /* 경쟁 후보 사이 시작 시차 (0: 동시에) */
+    const char* netmon_opt = "1";         /* 인터페이스 감시: 0 | 1 (설정된 IP) | auto (새 인터페이스도 채택) */
+    char* pos[8];
+    int npos = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--source") && i + 1 < argc) source = argv[++i];
+        else if (!strcmp(argv[i], "--enc-workers") && i + 1 < argc) enc_workers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--abr-target-ms") && i + 1 < argc) abr_target_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--queue-budget-ms") && i + 1 < argc) queue_budget_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--codec") && i + 1 < argc) codec = argv[++i];
+        else if (!strcmp(argv[i], "--gop") && i + 1 < argc) gop = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bitrate") && i + 1 < argc) bitrate_kbps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--stream-mode") && i + 1 < argc) stream_mode = argv[++i];
+        else if (!strcmp(argv[i], "--frame-deadline-ms") && i + 1 < argc) deadline_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--stripe") && i + 1 < argc) stripe = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--redundancy-pct") && i + 1 < argc) red_pct = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--sched") && i + 1 < argc) sched_name = argv[++i];
+        else if (!strcmp(argv[i], "--est-half-life-ms") && i + 1 < argc) est_half_life_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--heartbeat-ms") && i + 1 < argc) heartbeat_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--netmon") && i + 1 < argc) netmon_opt = argv[++i];
+        else if (!strcmp(argv[i], "--gso") && i + 1 < argc) use_gso = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--race") && i + 1 < argc) race = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--race-stagger-ms") && i + 1 < argc) race_stagger_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--path") && i + 1 < argc) {
+            if (npath_specs < MAX_PATHS) path_specs[npath_specs++] = argv[i + 1];
+            i++;
+        }
+        else if (npos < 8) pos[npos++] = argv[i];
+    }
+
+    if (npos > 0 && pos[0][0]) server_ip     = pos[0];
+    if (npos > 1 && pos[1][0]) local_alt_ip  = pos[1];
+    if (npos > 2 && pos[2][0]) port          = atoi(pos[2]);
+    if (npos > 3 && pos[3][0]) local_usb_ip  = pos[3];
 
     LOGF("[MAIN] args: server=%s port=%d alt=%s usb=%s",
          server_ip, port, local_alt_ip, local_usb_ip);
@@ -380,8 +465,27 @@ int main(int argc, char** argv){
     st.ip_wlan_be = inet_addr(local_usb_ip); 
     st.ip_usb_be  = inet_addr(local_alt_ip); 
     st.last_primary_idx = -1;
+
+    /* 경로 역할(우선순위/비용)과 주 경로 선택 정책 */
+    st.sched = sched_parse(sched_name);
+    for (int i = 0; i < npath_specs && st.sched >= 0; i++) {
+        if (role_add(&st, path_specs[i]) != 0) {
+            LOGF("[ERR] bad --path %s (IP[:PRIO[:COST]])", path_specs[i]);
+            picoquic_free(q);
+            return -1;
+        }
+    }
+    if (st.sched < 0) {
+        LOGF("[ERR] unknown --sched %s (priority|minrtt|wrr|cost)", sched_name);
+        picoquic_free(q);
+        return -1;
+    }
+    roles_finish(&st);
+    st.est_half_life_ms = est_half_life_ms > 0 ? est_half_life_ms : EST_HALF_LIFE_MS_DEFAULT;
+    st.hb_idle_us = heartbeat_ms > 0 ? (uint64_t)(heartbeat_ms * 1000.0) : 0;
     st.last_switch_ts   = 0;
-    pthread_mutex_init(&st.cam_mtx, NULL);
+    mb_init(&st.cam_mb);
+    st.pipe.n_enc = enc_workers;
 
     int alt_port = 51021;
     int usb_port = 55002;
@@ -399,8 +503,16 @@ int main(int argc, char** argv){
 
     /* 5. 콜백 등록 및 클라이언트 시작 */
     picoquic_set_callback(cnx, client_cb, &st);
+    ptab_enable(cnx);
+
+    /* 시작 경쟁: 설정된 인터페이스마다 초기 경로를 고정한 연결로 핸드셰이크 (후보 2개 이상일 때만) */
+    if (race) race_add_configured(&st);
+    int nrace = race ? race_start(q, &st, cnx, server_ip, "hq", client_cb, race_stagger_ms, picoquic_current_time()) : 0;
+    if (nrace > 0) {
+        LOGF("[MAIN] handshake race: %d interfaces, stagger=%.0fms", nrace, race_stagger_ms);
+    }
 
-    if (picoquic_start_client_cnx(cnx) != 0) {
+    if (nrace < 0 || (nrace == 0 && picoquic_start_client_cnx(cnx) != 0)) {
         LOGF("[ERR] start_client_cnx failed");
         picoquic_free(q);
         return -1;
@@ -408,12 +520,43 @@ int main(int argc, char** argv){
 
 
     /* 6. 카메라 및 캡처 스레드 시작 */
-    st.cam = camera_create();
+    st.cam = camera_open_codec(source, codec, gop, bitrate_kbps);
     if (!st.cam) {
-        LOGF("[ERR] camera_create failed");
+        LOGF("[ERR] frame source open failed (%s)", source ? source : "camera");
         picoquic_free(q);
         return -1;
     }
+    LOGF("[MAIN] camera backend=%s encoder=%s", camera_backend_name(st.cam),
+         camera_needs_encode(st.cam) ? camera_encoder_name() : "none(passthrough)");
+
+    abr_init(&st.abr, abr_target_ms, camera_needs_encode(st.cam));
+    admit_init(&st.admit, queue_budget_ms);
+    st.stream_per_frame = !strcmp(stream_mode, "frame");
+    st.deadline_us = deadline_ms > 0 ? (uint64_t)(deadline_ms * 1000.0) : 0;
+    st.stripe = stripe != 0;
+    st.red_pct = red_pct > 0 ? red_pct : 0;
+    LOGF("[MAIN] abr target=%.0fms (%s)", abr_target_ms,
+         abr_target_ms <= 0 ? "off" : camera_needs_encode(st.cam) ? "quality/scale/fps" : "fps only");
+    LOGF("[MAIN] send queue budget=%.0fms%s", queue_budget_ms, queue_budget_ms <= 0 ? " (off)" : "");
+    LOGF("[MAIN] stream mode=%s", st.stream_per_frame ? "frame (uni stream + FIN per frame)" : "path");
+    LOGF("[MAIN] frame deadline=%.0fms%s", deadline_ms, deadline_ms <= 0 ? " (off)" : "");
+    LOGF("[MAIN] intra-frame striping=%s", st.stripe ? "on" : "off");
+    LOGF("[MAIN] redundancy budget=%.0f%%%s", st.red_pct, st.red_pct <= 0 ? " (off)" : "");
+    LOGF("[MAIN] path scheduler=%s roles=%d (estimator half-life %.0fms)",
+         k_sched_names[st.sched], st.nroles, st.est_half_life_ms);
+    LOGF("[MAIN] heartbeat idle=%.0fms%s", heartbeat_ms, st.hb_idle_us ? "" : " (off)");
+    for (int i = 0; i < st.nroles; i++) {
+        struct in_addr ia = { .s_addr = st.roles[i].ip_be };
+        LOGF("[MAIN]   %-6s %s prio=%d cost=%.1f%s", st.roles[i].name, inet_ntoa(ia),
+             st.roles[i].prio, st.roles[i].cost, st.roles[i].probe ? " (probe)" : "");
+    }
+
+    /* 인터페이스 감시 시작 (netlink를 못 쓰면 기존 주기 probe만으로 동작) */
+    int nm_mode = !strcmp(netmon_opt, "auto") ? 2 : atoi(netmon_opt) != 0;
+    if (netmon_start(&st.netmon, nm_mode) != 0) {
+        LOGF("[WRN] netlink interface monitor unavailable, falling back to periodic probing");
+    }
+    LOGF("[MAIN] interface monitor=%s", st.netmon.mode == 2 ? "auto" : st.netmon.mode ? "on" : "off");
 
     if (pthread_create(&st.cam_thread, NULL, camera_thread_main, &st) == 0) {
         st.cam_thread_started = 1;
@@ -450,13 +593,11 @@ int main(int argc, char** argv){
     }
 
 
-    /* 8. 패킷 루프 파라미터 설정 */
-    picoquic_packet_loop_param_t lp;
-    memset(&lp, 0, sizeof(lp));
-
-    lp.local_af = AF_INET;
-    lp.extra_socket_required = 1;
-    lp.do_not_use_gso = 1;
+    /* 8. 인터페이스별 소켓 패킷 루프 (경로의 로컬 주소로 소켓을 고름, 첫 소켓은 초기 경로용) */
+    if (mloop_init(&st.mloop, use_gso != 0) != 0) return -1;
+    if (sock_wlan >= 0) mloop_add(&st.mloop, sock_wlan);
+    if (sock_alt >= 0) mloop_add(&st.mloop, sock_alt);
+    LOGF("[MAIN] packet loop sockets: recvmmsg/sendmmsg x%d, gso=%s", MLOOP_BATCH, st.mloop.gso ? "on" : "off");
 
     LOGF("[MAIN] entering packet loop...");
 
@@ -478,6 +619,7 @@ int main(int argc, char** argv){
             LOGF("[MAIN] Reconnecting sequence started...");
 
             /* [핵심 수정 1] 기존 연결이 남아있다면 확실하게 메모리 해제 (좀비 방지) */
+            race_reset(&st);                                     // 시작 경쟁 후보가 남아 있으면 함께 정리
             if (st.cnx != NULL) {
                 picoquic_delete_cnx(st.cnx);
                 st.cnx = NULL;
@@ -487,6 +629,9 @@ int main(int argc, char** argv){
             /* 이 부분이 없으면 이전 스트림 ID를 재사용하려다 죽습니다. */
             memset(st.sid_per_path, 0, sizeof(st.sid_per_path)); // 스트림 ID 초기화
             memset(st.b, 0, sizeof(st.b));                       // 바인딩 정보 초기화
+            jit_reset(&st);                                      // 이전 연결에 대기 중이던 JIT 프레임 해제
+            ptab_reset(&st);                                     // 경로 테이블과 추정기도 새 연결 기준으로
+            memset(st.est, 0, sizeof(st.est));
             st.is_ready = 0;
             st.didB = 0;
             st.didC = 0;
@@ -504,8 +649,14 @@ int main(int argc, char** argv){
 
             if (st.cnx) {
                 picoquic_set_callback(st.cnx, client_cb, &st);
+                ptab_enable(st.cnx);
                 picoquic_enable_keep_alive(st.cnx, 1);
-                picoquic_start_client_cnx(st.cnx);
+
+                /* 재연결도 시작 경쟁으로: 그때 살아 있는 링크가 바로 이김 */
+                if (race) race_add_configured(&st);
+                if (!race || race_start(q, &st, st.cnx, server_ip, "hq", client_cb, race_stagger_ms, picoquic_current_time()) == 0) {
+                    picoquic_start_client_cnx(st.cnx);
+                }
                 LOGF("[MAIN] New connection object created.");
             } else {
                 LOGF("[ERR] Failed to create connection, retrying in 2s...");
@@ -515,7 +666,7 @@ int main(int argc, char** argv){
         }
 
         /* 3. 패킷 루프 실행 */
-        ret = picoquic_packet_loop_v2(q, &lp, loop_cb, &st);
+        ret = mloop_run(q, &st.mloop, loop_cb, &st);
 
         /* 4. 루프가 종료되었을 때 (연결 유실 등) */
         if (st.closing) break;
@@ -532,14 +683,13 @@ int main(int argc, char** argv){
         st.cam_stop = 1;
         pthread_join(st.cam_thread, NULL);
     }
-
-    pthread_mutex_destroy(&st.cam_mtx);
+    netmon_stop(&st.netmon);
 
     if (st.cam) camera_destroy(st.cam);
-    if (st.cam_buf) free(st.cam_buf);
-    if (st.cap_buf) free(st.cap_buf);
+    mb_free(&st.cam_mb);
+    txf_free_all(&st);
 
-    if (sock_wlan > 0) close(sock_wlan);
+    mloop_close(&st.mloop);
     picoquic_free(q);
 
     LOGF("[MAIN] freed all, exit=%d", ret);
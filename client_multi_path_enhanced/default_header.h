@@ -1,6 +1,11 @@
 #ifndef DEFAULT_HEADER_H
 #define DEFAULT_HEADER_H
 
+/* recvmmsg/sendmmsg 같은 GNU 확장 (시스템 헤더보다 먼저 정의) */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 /* [시스템 표준 헤더] */
 #include <stdio.h>
 #include <stdlib.h>
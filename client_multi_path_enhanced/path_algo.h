@@ -5,6 +5,7 @@
 #include "struct_type.h"
 #include "net_tools.h"
 #include "quic_helpers.h"
+#include "path_est.h"
 #include <math.h>
 
 /* ============================================================
@@ -13,8 +14,9 @@
 
 /**
  * @brief 특정 경로의 품질 메트릭(RTT, Loss)을 계산하고 등급을 판정합니다.
+ * @param e 경로별 추정기 (NULL이면 picoquic 현재값)
  */
-static inline path_metric_t compute_metric_safe(picoquic_path_t* p) {
+static inline path_metric_t compute_metric_safe(picoquic_path_t* p, const path_est_t* e) {
     path_metric_t M = {0};
     
     /* 1. 객체가 아예 없으면 어쩔 수 없이 사망 */
@@ -30,7 +32,7 @@ static inline path_metric_t compute_metric_safe(picoquic_path_t* p) {
      * - 5초(5,000,000us) 동안은 Grade 1(WARN) 상태로 유지하며 FSM이 자연스럽게 넘어가도록 합니다.
      * - 이렇게 해야 "2 -> 1 -> 2"로 널뛰기하는 현상이 사라집니다.
      */
-    if (!p->first_tuple->challenge_verified) {
+    if (!p->first_tuple->challenge_verified && !(e && e->ping_ts > e->last_rx)) {   /* 하트비트 응답 대기 중이면 검증된 것으로 봄 */
         
         uint64_t silence_duration = now - p->last_packet_received_at;
 
@@ -47,8 +49,20 @@ static inline path_metric_t compute_metric_safe(picoquic_path_t* p) {
         return M;
     }
 
-    /* 3. 정상 경로 RTT 평가 */
+    /* 3. 정상 경로 RTT 평가 (추정기가 있으면 반감기 창 평균, 손실률·goodput은 참고용으로 채움) */
     double rtt_ms = (p->smoothed_rtt > 0 ? p->smoothed_rtt / 1000.0 : 50.0);
+    if (e) {
+        /* 하트비트 응답이 끊긴 경로는 검증이 풀리기 전에 BAD */
+        if (e->suspect) {
+            M.grade = 2;
+            M.rtt_ms = 10000.0;
+            return M;
+        }
+        if (e->rtt_ms > 0) rtt_ms = e->rtt_ms;
+        M.rtt_var_ms = sqrt(e->rtt_var);
+        M.loss_rate  = e->loss_pct;
+        M.goodput    = e->goodput_Bps * 8.0 / 1e6;
+    }
     M.rtt_ms = rtt_ms;
 
     /* RTT 기준 등급 판정 */
@@ -114,7 +128,8 @@ static inline int pick_primary_idx(
     uint32_t ip_usb_be,
     int* last_primary,
     uint64_t now,
-    uint64_t* last_switch_time
+    uint64_t* last_switch_time,
+    const tx_t* st
 ){
     if (sc <= 0) return -1;
     
@@ -137,8 +152,8 @@ static inline int pick_primary_idx(
     if (!WLAN && !USB) return *last_primary;
 
     /* 2. 각 경로의 메트릭 계산 */
-    path_metric_t Mwlan = WLAN ? compute_metric_safe(WLAN) : (path_metric_t){ .grade = 2 };
-    path_metric_t Musb  = USB  ? compute_metric_safe(USB)  : (path_metric_t){ .grade = 2 };
+    path_metric_t Mwlan = WLAN ? compute_metric_safe(WLAN, st ? est_of(st, c, sel[wlan_idx].idx) : NULL) : (path_metric_t){ .grade = 2 };
+    path_metric_t Musb  = USB  ? compute_metric_safe(USB,  st ? est_of(st, c, sel[usb_idx].idx)  : NULL) : (path_metric_t){ .grade = 2 };
         
     LOGF("[PICK] METRIC WLAN grade=%d", Mwlan.grade);
     LOGF("[PICK] METRIC USB  grade=%d", Musb.grade);
@@ -157,13 +172,13 @@ static inline int pick_primary_idx(
 /**
  * @brief 중복되지 않고 검증 완료된 유효 경로 리스트를 생성합니다.
  */
-static inline void build_unique_verified_paths(picoquic_cnx_t* c, pathsel_t* sel, int* sc_io)
+static inline void build_unique_verified_paths(picoquic_cnx_t* c, const tx_t* st, pathsel_t* sel, int* sc_io)
 {
     int sc = 0;
     for (int i = 0; i < c->nb_paths; i++) {
         picoquic_path_t* p = c->path[i];
         if (!p || !p->first_tuple) continue;
-        if (!path_verified_ptr(p)) continue;
+        if (!path_usable_ptr(st, p, i)) continue;   /* 하트비트 응답 대기 중인 경로도 후보 */
 
         struct sockaddr_in* la = (struct sockaddr_in*)&p->first_tuple->local_addr;
         if (la->sin_family != AF_INET) continue;
@@ -189,18 +204,18 @@ static inline void build_unique_verified_paths(picoquic_cnx_t* c, pathsel_t* sel
 /**
  * @brief 원하는 인덱스가 유효하지 않을 경우 검증된 아무 경로로나 폴백합니다.
  */
-static inline int choose_verified_or_fallback(picoquic_cnx_t* c, int want_idx)
+static inline int choose_verified_or_fallback(picoquic_cnx_t* c, const tx_t* st, int want_idx)
 {
     if (want_idx >= 0 && want_idx < c->nb_paths) {
         picoquic_path_t* p = c->path[want_idx];
-        if (p && p->first_tuple && p->first_tuple->challenge_verified)
+        if (path_usable_ptr(st, p, want_idx))
             return want_idx;
     }
 
     /* 모든 경로를 순회하여 검증된 첫 번째 경로 선택 */
     for (int i = 0; i < c->nb_paths; i++) {
         picoquic_path_t* p = c->path[i];
-        if (p && p->first_tuple && p->first_tuple->challenge_verified)
+        if (path_usable_ptr(st, p, i))
             return i;
     }
     
@@ -161,17 +161,34 @@ static inline int path_verified_ptr(picoquic_path_t* p){
     return (p && p->first_tuple && p->first_tuple->challenge_verified);
 }
 
+/**
+ * @brief 하트비트(PATH_CHALLENGE) 응답을 기다리는 경로인지 봅니다. (path_est.h hb_challenge가 표시)
+ * picoquic_set_path_challenge는 응답 전까지 challenge_verified를 풀어 두므로, 이 동안도 검증된 경로로 취급합니다.
+ */
+static inline int path_hb_inflight(const tx_t* st, const picoquic_path_t* p, int i){
+    if (!st || !p || i < 0 || i >= MAX_PATHS || st->hb_idle_us == 0) return 0;
+    const path_est_t* e = &st->est[i];
+    return e->valid && e->upid == p->unique_path_id && e->ping_ts > e->last_rx;
+}
+
+/**
+ * @brief 검증된 경로이거나 하트비트 챌린지로 검증이 잠시 풀린 경로인지 확인합니다.
+ */
+static inline int path_usable_ptr(const tx_t* st, picoquic_path_t* p, int i){
+    return path_verified_ptr(p) || (p && p->first_tuple && path_hb_inflight(st, p, i));
+}
+
 /**
  * @brief 실제 데이터 송신 전, 경로의 건전성(Sane)을 최종 확인합니다.
  */
-static inline int path_sane_for_send(picoquic_cnx_t* c, int i) {
+static inline int path_sane_for_send(picoquic_cnx_t* c, const tx_t* st, int i) {
     if (!c || i < 0 || i >= (int)c->nb_paths) return 0;
     
     picoquic_path_t* p = c->path[i];
     if (!p || !p->first_tuple) return 0;
     
-    /* 주소 검증 완료 여부 */
-    if (!p->first_tuple->challenge_verified) return 0;
+    /* 주소 검증 완료 여부 (하트비트 응답 대기 중인 경로는 검증된 것으로 봄) */
+    if (!path_usable_ptr(st, p, i)) return 0;
     
     /* 경로가 활성 상태인지 확인 */
     if (p->path_abandon_sent || p->path_abandon_received) return 0;
@@ -232,7 +249,7 @@ static int send_on_path_safe(picoquic_cnx_t* c, tx_t* st, int k,
                              const uint8_t* payload, size_t plen)
 {
     /* 1. 경로 상태 확인 */
-    if (!path_sane_for_send(c, k)) return -1;
+    if (!path_sane_for_send(c, st, k)) return -1;
 
     picoquic_path_t* p = c->path[k];
     uint64_t sid = st->sid_per_path[k];
@@ -339,4 +356,370 @@ static inline const char* cbmode_str(picoquic_packet_loop_cb_enum m){
     }
 }
 
+
+/* ============================================================
+ * [3] JIT 송신 (prepare_to_send 콜백에서 프레임 버퍼 직접 직렬화)
+ * ============================================================ */
+
+/*
+ * picoquic_add_to_stream은 호출마다 스트림 버퍼를 할당해 데이터를 복사해 둡니다. (헤더/페이로드 2회)
+ * 대신 스트림을 active로만 표시하고, picoquic이 패킷을 만들 때 호출하는 prepare_to_send 콜백에서
+ * 남은 공간만큼 프레임 버퍼(tx_frame_t)를 패킷 버퍼로 바로 씁니다.
+ *   - 프레임별 할당/중간 복사 없음 (버퍼는 우편함과 풀 사이를 맞바꿈으로 순환)
+ *   - 아직 한 바이트도 직렬화되지 않은 대기 프레임(next)은 더 새 프레임으로 교체 (latest-frame-wins)
+ *   - 단, 참조 프레임(H.264 P)은 앞 프레임이 빠지면 디코딩할 수 없으므로 키프레임만 교체할 수 있음
+ */
+
+/**
+ * @brief 풀에서 빈 프레임을 찾아 우편함 소비자 슬롯의 버퍼를 복사 없이 넘겨받습니다.
+ * @return 참조 1개를 쥔 프레임, 풀이 비었으면 NULL
+ */
+/*
+ * H.264 AU 레코드는 페이로드 앞에 AU 헤더(FF 'M' 'P' 'A' + varint 우편함 순번)를 붙입니다.
+ * au_gate가 연속 순번의 P 프레임만 내보내므로, 서버는 이 순번으로 중간에 빠진 AU를 알아채고
+ * 다음 키프레임까지 세그먼트 기록을 멈춥니다. (JPEG 레코드는 바뀌지 않음)
+ */
+static const uint8_t k_au_magic[4] = { 0xFF, 'M', 'P', 'A' };
+
+/**
+ * @brief 페이로드가 Annex-B AU이면 AU 헤더를 out에 쓰고 길이를, 아니면 0을 반환합니다.
+ */
+static inline size_t au_hdr_enc(const uint8_t* b, size_t len, uint64_t seq, uint8_t* out){
+    if (len < 4 || b[0] != 0 || b[1] != 0 || !(b[2] == 1 || (b[2] == 0 && b[3] == 1))) return 0;
+    memcpy(out, k_au_magic, 4);
+    return 4 + varint_enc(seq, out + 4);
+}
+
+static inline tx_frame_t* txf_take(tx_t* st, const mb_slot_t* fr){
+    tx_frame_t* tf = NULL;
+    for (int i = 0; i < TXF_POOL && !tf; i++) {
+        if (st->txf[i].refs == 0) tf = &st->txf[i];
+    }
+    if (!tf) return NULL;
+
+    tf->len   = fr->len;
+    tf->seq   = fr->seq;
+    tf->ts_us = fr->ts_us;
+    tf->key   = fr->key;
+    mb_take_front(&st->cam_mb, &tf->buf, &tf->cap);
+
+    uint8_t au[4 + 8];
+    tf->alen  = au_hdr_enc(tf->buf, tf->len, tf->seq, au);
+    tf->hlen  = varint_enc(tf->alen + tf->len, tf->hdr);
+    memcpy(tf->hdr + tf->hlen, au, tf->alen);
+    tf->hlen += tf->alen;
+    tf->refs  = 1;
+    return tf;
+}
+
+#ifndef FRAME_DEADLINE_MS_DEFAULT
+#define FRAME_DEADLINE_MS_DEFAULT 1000.0   /* 캡처 후 이 시간 안에 전달되지 않은 프레임은 버림 */
+#endif
+#define FRAME_EXPIRED_ERR 0x1              /* 기한 초과로 reset한 스트림의 애플리케이션 오류 코드 */
+
+static inline void txf_release(tx_frame_t* tf){
+    if (!tf || tf->refs <= 0) return;
+    if (--tf->refs == 0 && tf->parent) {
+        /* 조각 뷰: 버퍼는 부모 것이므로 부모 참조만 놓음 */
+        txf_release(tf->parent);
+        tf->parent = NULL;
+        tf->buf = NULL;
+    }
+}
+
+/**
+ * @brief 프레임의 [off, off+len) 구간을 가리키는 조각 뷰를 만듭니다. (복사 없음, 헤더는 호출자가 채움)
+ * @return 참조 1개를 쥔 뷰, 뷰 풀이 비었으면 NULL
+ */
+static inline tx_frame_t* txf_view(tx_t* st, tx_frame_t* parent, size_t off, size_t len){
+    tx_frame_t* v = NULL;
+    for (int i = 0; i < TXV_POOL && !v; i++) {
+        if (st->txv[i].refs == 0) v = &st->txv[i];
+    }
+    if (!v) return NULL;
+
+    v->buf    = parent->buf + off;
+    v->cap    = 0;
+    v->len    = len;
+    v->hlen   = 0;
+    v->alen   = 0;
+    v->seq    = parent->seq;
+    v->ts_us  = parent->ts_us;
+    v->key    = parent->key;
+    v->parent = parent;
+    v->refs   = 1;
+    parent->refs++;
+    return v;
+}
+
+static inline void txf_free_all(tx_t* st){
+    for (int i = 0; i < TXF_POOL; i++) {
+        free(st->txf[i].buf);
+        memset(&st->txf[i], 0, sizeof(st->txf[i]));
+    }
+    memset(st->txv, 0, sizeof(st->txv));
+}
+
+/**
+ * @brief 경로별 송신 상태를 비웁니다. (재연결로 스트림이 사라졌을 때)
+ */
+static inline void jit_reset(tx_t* st){
+    for (int i = 0; i < MAX_PATHS; i++) {
+        txf_release(st->jit[i].cur);
+        txf_release(st->jit[i].next);
+    }
+    memset(st->jit, 0, sizeof(st->jit));
+    st->fstr_n = 0;
+}
+
+/**
+ * @brief 전달 확인 대기 목록에서 i번째 스트림을 뺍니다. (오래된 순서 유지)
+ */
+static inline void fstr_remove(tx_t* st, int i){
+    memmove(&st->fstr[i], &st->fstr[i + 1], (size_t)(st->fstr_n - i - 1) * sizeof(st->fstr[0]));
+    st->fstr_n--;
+}
+
+static inline void fstr_remove_sid(tx_t* st, uint64_t sid){
+    for (int i = 0; i < st->fstr_n; i++) {
+        if (st->fstr[i].sid == sid) { fstr_remove(st, i); return; }
+    }
+}
+
+/**
+ * @brief 프레임별 스트림을 전달 기한과 함께 등록합니다. 목록이 가득 차면 가장 오래된 항목은 추적을 포기합니다.
+ */
+static inline void fstr_track(tx_t* st, uint64_t sid, uint64_t ts_us){
+    if (st->deadline_us == 0) return;
+    if (st->fstr_n == FSTREAM_MAX) fstr_remove(st, 0);
+    st->fstr[st->fstr_n].sid = sid;
+    st->fstr[st->fstr_n].deadline_us = ts_us + st->deadline_us;
+    st->fstr_n++;
+}
+
+/**
+ * @brief 대기 스트림에 실린 프레임이 바뀌었을 때 그 스트림의 전달 기한을 새 프레임 기준으로 다시 잡습니다.
+ * (추적 목록에서 밀려난 스트림이면 다시 등록)
+ */
+static inline void fstr_retime(tx_t* st, uint64_t sid, uint64_t ts_us){
+    if (st->deadline_us == 0) return;
+    for (int i = 0; i < st->fstr_n; i++) {
+        if (st->fstr[i].sid == sid) { st->fstr[i].deadline_us = ts_us + st->deadline_us; return; }
+    }
+    fstr_track(st, sid, ts_us);
+}
+
+/**
+ * @brief 경로 k의 스트림에서 새 프레임보다 먼저 나갈 바이트 수 (직렬화 중인 프레임의 나머지)
+ */
+static inline size_t jit_ahead_bytes(const tx_t* st, int k){
+    if (k < 0 || k >= MAX_PATHS) return 0;
+    const jit_stream_t* js = &st->jit[k];
+    return js->cur ? js->cur->hlen + js->cur->len - js->off : 0;
+}
+
+/**
+ * @brief 프레임별 스트림 모드: 경로 k의 대기 프레임(next)을 실을 새 단방향 스트림을 엽니다.
+ * 스트림 ID는 picoquic이 다음 로컬 uni ID를 매기며, 열지 못하면 대기 프레임을 버립니다.
+ */
+static int jit_open_next_stream(picoquic_cnx_t* c, tx_t* st, int k){
+    jit_stream_t* js = &st->jit[k];
+    uint64_t sid = picoquic_get_next_local_stream_id(c, /*unidir=*/1);
+
+    if (!path_ok(c, k) || picoquic_mark_active_stream(c, sid, 1, js) != 0) {
+        txf_release(js->next);
+        js->next = NULL;
+        st->stream_open_fail++;
+        return -2;
+    }
+    picoquic_set_stream_path_affinity(c, sid, c->path[k]->unique_path_id);
+    js->next_sid = sid;
+    st->frame_streams++;
+    fstr_track(st, sid, js->next->ts_us);
+    return 0;
+}
+
+/**
+ * @brief 전달 기한이 지난 프레임을 버립니다. (loop_cb에서 새 프레임을 넘기기 전에 호출)
+ *   - 한 바이트도 안 나간 대기 프레임: 두 모드 모두 그냥 버림
+ *   - 프레임별 스트림: 직렬화 중이거나 전달 확인 전이면 picoquic_reset_stream으로 재전송까지 중단
+ *   - 경로별 스트림에서 이미 나가기 시작한 프레임은 뒤 프레임의 경계가 깨지므로 끝까지 보냄
+ * H.264 모드에서는 참조가 끊기므로 IDR을 요청하고 키프레임까지 P 프레임을 막습니다.
+ */
+static void jit_expire(picoquic_cnx_t* c, tx_t* st){
+    if (st->deadline_us == 0) return;
+    uint64_t now = pipe_now_us();
+    int lost = 0;
+
+    for (int k = 0; k < MAX_PATHS; k++) {
+        jit_stream_t* js = &st->jit[k];
+        if (js->next && now >= js->next->ts_us + st->deadline_us) {
+            if (js->next_sid) {
+                (void)picoquic_reset_stream(c, js->next_sid, FRAME_EXPIRED_ERR);
+                fstr_remove_sid(st, js->next_sid);
+                js->next_sid = 0;
+            }
+            txf_release(js->next);
+            js->next = NULL;
+            st->expired_unsent++;
+            lost = 1;
+        }
+    }
+
+    for (int i = 0; i < st->fstr_n; ) {
+        fstream_t* f = &st->fstr[i];
+        /* 모두 전달 확인되면 picoquic이 스트림을 지움 */
+        if (!picoquic_find_stream(c, f->sid)) { fstr_remove(st, i); continue; }
+        if (now < f->deadline_us) { i++; continue; }
+
+        for (int k = 0; k < MAX_PATHS; k++) {
+            jit_stream_t* js = &st->jit[k];
+            if (js->cur && js->sid == f->sid) {
+                txf_release(js->cur);
+                js->cur = NULL;
+                js->off = 0;
+            }
+            /* 대기 프레임용으로 열어 둔 스트림이면 ID를 비워 아래에서 새 스트림으로 다시 엶 */
+            if (js->next_sid == f->sid) js->next_sid = 0;
+        }
+        (void)picoquic_reset_stream(c, f->sid, FRAME_EXPIRED_ERR);
+        st->expired++;
+        lost = 1;
+        fstr_remove(st, i);
+    }
+
+    /* 직렬화 중이던 프레임을 버린 경로는 기다리던 프레임을 새 스트림으로 */
+    for (int k = 0; st->stream_per_frame && k < MAX_PATHS; k++) {
+        jit_stream_t* js = &st->jit[k];
+        if (!js->cur && js->next && js->next_sid == 0) (void)jit_open_next_stream(c, st, k);
+    }
+
+    if (lost && camera_codec() == CAM_CODEC_H264) {
+        camera_request_keyframe();
+        st->au_need_key = 1;
+    }
+}
+
+/**
+ * @brief 프레임을 경로 k의 스트림에 대기시키고 스트림을 active로 표시합니다. (실제 복사는 prepare_to_send에서)
+ * 프레임별 스트림 모드에서는 직렬화 중인 프레임이 끝난 뒤 대기 프레임용 스트림을 새로 엽니다.
+ * @return 0 성공, -1 경로 이상, -2 affinity/스트림 개설 실패, -3 대기 중인 참조 프레임을 교체할 수 없음
+ */
+static int send_frame_jit(picoquic_cnx_t* c, tx_t* st, int k, tx_frame_t* tf){
+    if (!path_sane_for_send(c, st, k) || k >= MAX_PATHS) return -1;
+
+    picoquic_path_t* p = c->path[k];
+    jit_stream_t* js = &st->jit[k];
+
+    if (!st->stream_per_frame) {
+        uint64_t sid = st->sid_per_path[k];
+        if (sid == 0) {
+            sid = make_client_uni_sid_from_index(k);
+            ensure_stream_for_path(c, st, &sid, k);
+            st->sid_per_path[k] = sid;
+        }
+        if (picoquic_set_stream_path_affinity(c, sid, p->unique_path_id) != 0) {
+            return -2;
+        }
+        js->sid = sid;
+    }
+
+    /* 대기 프레임 교체: 새 프레임이 단독 디코딩 가능할 때만 (JPEG은 항상) */
+    if (js->next) {
+        if (!tf->key) return -3;
+        txf_release(js->next);
+        st->jit_replaced++;
+    }
+    js->next = tf;
+    tf->refs++;
+
+    if (st->stream_per_frame) {
+        /* 이미 열어 둔 대기 스트림이 있으면 프레임과 전달 기한만 바뀜, 직렬화 중인 프레임이 있으면 끝난 뒤에 엶 */
+        if (js->next_sid != 0) {
+            fstr_retime(st, js->next_sid, tf->ts_us);
+            return 0;
+        }
+        if (js->cur) return 0;
+        return jit_open_next_stream(c, st, k);
+    }
+
+    if (!js->active && picoquic_mark_active_stream(c, js->sid, 1, js) == 0) {
+        js->active = 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief picoquic_callback_prepare_to_send 처리: 패킷에 남은 공간만큼 프레임을 직접 씁니다.
+ * 프레임별 스트림 모드에서는 프레임의 마지막 바이트와 함께 FIN을 보내 프레임 경계를 스트림으로 나타냅니다.
+ * @param ctx   picoquic이 넘긴 컨텍스트 (picoquic_provide_stream_data_buffer용)
+ * @param space 이번 패킷에서 이 스트림이 쓸 수 있는 최대 바이트
+ */
+static int jit_prepare_to_send(picoquic_cnx_t* c, tx_t* st, uint64_t sid, void* ctx, size_t space, void* stream_ctx){
+    jit_stream_t* js = (jit_stream_t*)stream_ctx;
+    if (!js) {
+        for (int i = 0; i < MAX_PATHS && !js; i++) {
+            if (sid != 0 && (st->jit[i].sid == sid || st->jit[i].next_sid == sid)) js = &st->jit[i];
+        }
+    }
+    if (!js) {
+        (void)picoquic_provide_stream_data_buffer(ctx, 0, 0, 0);
+        return 0;
+    }
+
+    /* 직렬화 중인 프레임이 없으면 대기 프레임을 꺼냄 (이 시점부터는 교체 불가) */
+    if (!js->cur && js->next && (!st->stream_per_frame || sid == js->next_sid)) {
+        js->cur  = js->next;
+        js->next = NULL;
+        js->off  = 0;
+        if (st->stream_per_frame) {
+            js->sid = sid;
+            js->next_sid = 0;
+        }
+    }
+    if (!js->cur || js->sid != sid) {
+        (void)picoquic_provide_stream_data_buffer(ctx, 0, 0, 0);
+        if (!st->stream_per_frame) js->active = 0;
+        return 0;
+    }
+
+    tx_frame_t* tf = js->cur;
+    size_t total = tf->hlen + tf->len;
+    size_t n = total - js->off;
+    if (n > space) n = space;
+    int last = (js->off + n >= total);
+    int fin  = st->stream_per_frame && last;
+    int more = st->stream_per_frame ? !last : (!last || js->next != NULL);
+
+    uint8_t* dst = picoquic_provide_stream_data_buffer(ctx, n, fin, more);
+    if (!dst) return -1;
+
+    /* 헤더 → 페이로드 순서로 이어서 복사 */
+    size_t done = 0;
+    if (js->off < tf->hlen) {
+        size_t h = tf->hlen - js->off;
+        if (h > n) h = n;
+        memcpy(dst, tf->hdr + js->off, h);
+        done = h;
+    }
+    if (done < n) {
+        memcpy(dst + done, tf->buf + (js->off + done - tf->hlen), n - done);
+    }
+    js->off += n;
+
+    if (last) {
+        pipe_note_sent(&st->pipe, tf->ts_us);   /* 캡처 → 마지막 바이트 직렬화 지연 */
+        txf_release(tf);
+        js->cur = NULL;
+        js->off = 0;
+
+        /* 프레임별 스트림: 이 스트림은 FIN으로 끝, 기다리던 프레임은 새 스트림으로 */
+        if (st->stream_per_frame && js->next && js->next_sid == 0) {
+            (void)jit_open_next_stream(c, st, (int)(js - st->jit));
+        }
+    }
+    if (!more) js->active = 0;
+    return 0;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,243 @@
+#ifndef STRIPE_H
+#define STRIPE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "picoquic.h"
+#include "picoquic_internal.h"
+#include "struct_type.h"
+#include "quic_helpers.h"
+#include "abr.h"
+#include "path_est.h"
+
+/* ============================================================
+ * [1] 분할 계획 (ECF/BLEST 방식 동시 도착)
+ * ============================================================ */
+
+/*
+ * 한 경로만 쓰면 큰 프레임의 전달 시간은 그 경로 용량에 묶입니다. 검증된 경로가 둘 이상이면
+ * 프레임을 조각내어 각 경로로 동시에 보내되, 모든 조각이 같은 시각 T에 도착하도록 나눕니다.
+ *     경로 i가 비는 시각  a_i = srtt_i/2 + (bytes_in_transit_i + 앞선 JIT 바이트_i) / r_i
+ *     조각 크기           x_i = r_i * (T - a_i),   Σ x_i = 프레임 크기
+ *     => T = (L + Σ r_i a_i) / Σ r_i   (a_i >= T인 경로는 빼고 다시 계산)
+ * r_i는 ABR과 같은 경로 용량 추정(abr_path_capacity)이며, 전달 시간은 L / Σ r_i에 가까워집니다.
+ * 너무 작은 조각(STRIPE_MIN_CHUNK 미만)은 헤더·스트림 비용이 더 크므로 만들지 않습니다.
+ *
+ * 조각은 원래 프레이밍(varint 길이 + 레코드) 안에 스트라이프 헤더를 붙여 보냅니다.
+ *     [varint 레코드 길이][FF 'M' 'P' 'S'][varint 프레임 id][varint 전체 길이][varint 오프셋][조각]
+ * JPEG(FF D8)/H.264 AU(FF 'M' 'P' 'A') 레코드와 앞 4바이트로 구분되며, 서버는 (연결, 프레임 id)로 재조립합니다.
+ */
+
+#define STRIPE_MIN_CHUNK 4096
+
+static const uint8_t k_stripe_magic[4] = { 0xFF, 'M', 'P', 'S' };
+
+typedef struct {
+    int    idx;                 /* 경로 인덱스 */
+    size_t off, len;            /* 프레임 안의 구간 */
+} stripe_chunk_t;
+
+/**
+ * @brief 후보 경로들로 L바이트 프레임을 나눕니다.
+ * @param paths 후보 경로 인덱스 (송신할 수 없는 경로는 건너뜀)
+ * @return 조각 수 (1 이하면 나누지 않고 한 경로로 보내는 편이 나음)
+ */
+static int stripe_plan(picoquic_cnx_t* c, const tx_t* st, const int* paths, int np,
+                       size_t L, stripe_chunk_t* out)
+{
+    int    idx[MAX_PATHS];
+    double r[MAX_PATHS], a[MAX_PATHS];
+    int    n = 0;
+
+    for (int t = 0; t < np && n < MAX_PATHS; t++) {
+        if (!path_sane_for_send(c, st, paths[t]) || est_suspect(st, c, paths[t])) continue;
+        picoquic_path_t* p = c->path[paths[t]];
+        double rate = abr_path_capacity(p);
+        if (rate <= 0) continue;
+
+        double q = (double)p->bytes_in_transit + (double)jit_ahead_bytes(st, paths[t]);
+        idx[n] = paths[t];
+        r[n]   = rate;
+        a[n]   = (double)p->smoothed_rtt / 2e6 + q / rate;
+        n++;
+    }
+
+    /* 빨리 비는 경로 순으로 정렬 (삽입 정렬, 경로 수가 적음) */
+    for (int i = 1; i < n; i++) {
+        for (int j = i; j > 0 && a[j] < a[j - 1]; j--) {
+            int ti = idx[j]; idx[j] = idx[j - 1]; idx[j - 1] = ti;
+            double tr = r[j]; r[j] = r[j - 1]; r[j - 1] = tr;
+            double ta = a[j]; a[j] = a[j - 1]; a[j - 1] = ta;
+        }
+    }
+
+    /* 물 채우기: T보다 늦게 비는 경로, 그리고 너무 작은 조각을 받을 경로를 뒤에서부터 뺌 */
+    while (n > 1) {
+        double sr = 0, sra = 0;
+        for (int i = 0; i < n; i++) { sr += r[i]; sra += r[i] * a[i]; }
+        double T = ((double)L + sra) / sr;
+        if (r[n - 1] * (T - a[n - 1]) >= STRIPE_MIN_CHUNK) break;
+        n--;
+    }
+    if (n <= 1) return n;
+
+    double sr = 0, sra = 0;
+    for (int i = 0; i < n; i++) { sr += r[i]; sra += r[i] * a[i]; }
+    double T = ((double)L + sra) / sr;
+
+    size_t off = 0;
+    for (int i = 0; i < n; i++) {
+        size_t x = (i == n - 1) ? L - off : (size_t)(r[i] * (T - a[i]));
+        if (x > L - off) x = L - off;
+        out[i].idx = idx[i];
+        out[i].off = off;
+        out[i].len = x;
+        off += x;
+    }
+    return n;
+}
+
+
+/* ============================================================
+ * [2] 조각 전송
+ * ============================================================ */
+
+/**
+ * @brief 조각 뷰에 varint 레코드 길이 + 스트라이프 헤더를 채웁니다.
+ *
+ * H.264 프레임이면 AU 헤더(tf->alen)를 첫 조각(off 0)의 데이터 앞에 붙이고 전체 길이와 나머지 오프셋을
+ * 그만큼 밀어, 서버에서 다시 맞춘 프레임이 그대로 AU 레코드가 되게 합니다.
+ */
+static inline void stripe_fill_hdr(tx_frame_t* v, const tx_frame_t* tf, size_t off){
+    const uint8_t* au = tf->hdr + tf->hlen - tf->alen;
+    size_t  al = (off == 0) ? tf->alen : 0;
+    uint8_t sh[4 + 8 + 8 + 8];
+    size_t  sl = 0;
+    memcpy(sh, k_stripe_magic, 4); sl = 4;
+    sl += varint_enc(tf->seq, sh + sl);
+    sl += varint_enc(tf->alen + tf->len, sh + sl);
+    sl += varint_enc(off ? tf->alen + off : 0, sh + sl);
+
+    v->hlen = varint_enc(sl + al + v->len, v->hdr);
+    memcpy(v->hdr + v->hlen, sh, sl);
+    v->hlen += sl;
+    memcpy(v->hdr + v->hlen, au, al);
+    v->hlen += al;
+}
+
+/**
+ * @brief 계획대로 프레임 조각을 각 경로 스트림에 대기시킵니다. (복사 없음, JIT 직렬화)
+ * @return 0 모든 조각을 넘김, -1 일부 조각 실패 (서버에서 그 프레임은 완성되지 않음)
+ */
+static int stripe_send(picoquic_cnx_t* c, tx_t* st, tx_frame_t* tf,
+                       const stripe_chunk_t* plan, int n)
+{
+    int fail = 0;
+    for (int i = 0; i < n; i++) {
+        tx_frame_t* v = txf_view(st, tf, plan[i].off, plan[i].len);
+        if (!v) { fail++; continue; }
+
+        stripe_fill_hdr(v, tf, plan[i].off);
+        if (send_frame_jit(c, st, plan[i].idx, v) != 0) fail++;
+        txf_release(v);
+    }
+
+    st->stripe_chunks += (uint64_t)(n - fail);
+    if (fail) {
+        st->stripe_fail++;
+        return -1;
+    }
+    st->stripe_frames++;
+    return 0;
+}
+
+
+/* ============================================================
+ * [3] 이중 경로 중복 전송 (전환 구간 / 불확실한 경로)
+ * ============================================================ */
+
+/*
+ * fsm_pick의 체류 구간(페일오버 200ms, 페일백 400ms) 동안이나 주 경로가 WARN 수준이면,
+ * 열화 중인 경로로 보낸 프레임이 수 초씩 늦게 도착하곤 합니다. 이때는 같은 프레임을 RTT가 가장 짧은
+ * 다른 경로로도 보내 먼저 도착하는 쪽을 씁니다. (H.264 모드에서는 키프레임도 항상 대상)
+ *   - 중복 사본은 스트라이프 레코드(오프셋 0, 조각 = 전체)로 보내며, 서버가 프레임 id로 중복을 걸러 한 번만 저장
+ *   - 추가 대역은 예산(red_pct)으로 제한: 보낸 바이트의 red_pct%씩 적립하고 사본 크기만큼 차감
+ *     (적립 상한은 약 1초 분량이라, 평소에 모아 둔 예산을 전환 구간에 몰아 씀)
+ * WARN 판정은 compute_metric_safe와 같은 기준(RTT 120ms, 손실 3%)을 경로별 추정기(path_est.h)의 창 값으로 봅니다.
+ */
+
+#define RED_HANDOVER_US     400000ULL   /* 전환 후 이 시간 동안은 전환 중으로 봄 (fsm_pick 최대 체류 시간) */
+#define RED_WARN_RTT_MS     120.0
+#define RED_WARN_LOSS_PCT   3.0
+#define RED_CREDIT_FRAMES   30          /* 예산 적립 상한 (프레임 수) */
+
+/**
+ * @brief 경로 품질이 불확실한지 (WARN 이상) 판단합니다.
+ * @param e 경로별 추정기 (NULL이면 picoquic 현재값과 누적 손실률)
+ */
+static inline int red_path_uncertain(const picoquic_path_t* p, const path_est_t* e){
+    if (p->is_pto_required) return 1;
+    if (e) return e->stale || e->rtt_ms > RED_WARN_RTT_MS || e->loss_pct > RED_WARN_LOSS_PCT;
+
+    if (p->smoothed_rtt > (uint64_t)(RED_WARN_RTT_MS * 1000.0)) return 1;
+    uint64_t delivered = p->delivered > 0 ? p->delivered : 1;
+    return (double)p->total_bytes_lost * 100.0 / (double)delivered > RED_WARN_LOSS_PCT;
+}
+
+/**
+ * @brief 이번 프레임을 중복 전송할 두 번째 경로를 고릅니다. (예산 적립도 여기서)
+ * @return 두 번째 경로 인덱스, 중복하지 않으면 -1
+ */
+static int red_pick(picoquic_cnx_t* c, tx_t* st, int k, const int* paths, int np,
+                    const tx_frame_t* tf, uint64_t now)
+{
+    if (st->red_pct <= 0 || !path_sane_for_send(c, st, k)) return -1;
+
+    double len = (double)(tf->hlen + tf->len);
+    st->red_credit_B += len * st->red_pct / 100.0;
+    if (st->red_credit_B > len * RED_CREDIT_FRAMES) st->red_credit_B = len * RED_CREDIT_FRAMES;
+
+    int handover  = now - st->last_switch_ts < RED_HANDOVER_US;
+    int uncertain = red_path_uncertain(c->path[k], est_of(st, c, k));
+    int flagged   = tf->key && camera_codec() == CAM_CODEC_H264;
+    if (!handover && !uncertain && !flagged) return -1;
+
+    int k2 = -1;
+    for (int t = 0; t < np; t++) {
+        int i = paths[t];
+        if (i == k || !path_sane_for_send(c, st, i) || est_suspect(st, c, i)) continue;
+        if (k2 < 0 || c->path[i]->smoothed_rtt < c->path[k2]->smoothed_rtt) k2 = i;
+    }
+    if (k2 < 0) return -1;
+
+    if (st->red_credit_B < len) {
+        st->red_no_budget++;
+        return -1;
+    }
+    st->red_credit_B -= len;
+    return k2;
+}
+
+/**
+ * @brief 같은 프레임을 두 경로에 대기시킵니다. (복사 없음, 두 사본 모두 원본 버퍼를 가리키는 뷰)
+ * @return 0 한 경로 이상에 넘김, -1 둘 다 실패
+ */
+static int red_send(picoquic_cnx_t* c, tx_t* st, tx_frame_t* tf, int k, int k2){
+    int ok = 0;
+    int paths[2] = { k, k2 };
+
+    for (int i = 0; i < 2; i++) {
+        tx_frame_t* v = txf_view(st, tf, 0, tf->len);
+        if (!v) continue;
+
+        stripe_fill_hdr(v, tf, 0);
+        if (send_frame_jit(c, st, paths[i], v) == 0) ok++;
+        txf_release(v);
+    }
+    if (ok == 2) st->red_frames++;
+    return ok ? 0 : -1;
+}
+
+#endif
@@ -5,6 +5,7 @@
 #include "struct_type.h"
 #include "net_tools.h"
 #include "quic_helpers.h"
+#include "path_est.h"
 #include <math.h>
 
 /* ============================================================
@@ -13,44 +14,45 @@
 
 /**
  * @brief 특정 경로의 품질 메트릭(RTT, Loss)을 계산하고 등급을 판정합니다.
+ * @param e 경로별 추정기 (NULL이면 picoquic 현재값과 누적 손실률)
  */
-static inline path_metric_t compute_metric_safe(picoquic_path_t* p)
+static inline path_metric_t compute_metric_safe(picoquic_path_t* p, const path_est_t* e)
 {
     path_metric_t M = {0};
 
-    /* 1. 경로 유효성 검사: 검증 전이거나 무효한 경우 BAD 등급 부여 */
-    if (!p || !p->first_tuple || !p->first_tuple->challenge_verified) {
+    /* 1. 경로 유효성 검사: 검증 전이거나 무효한 경우 BAD 등급 부여 (하트비트 응답 대기 중인 경로는 검증된 것으로 봄) */
+    if (!p || !p->first_tuple || (!p->first_tuple->challenge_verified && !(e && e->ping_ts > e->last_rx))) {
         M.grade = 2; // 검증 전/무효 path는 BAD
         return M;
     }
 
-    /* 2. RTT 계산 및 EWMA(지수 이동 평균) 적용 */
-    /* Smoothed RTT가 없으면 기본값으로 9999ms 설정 */
-    double rtt_ms = (p->smoothed_rtt > 0 ? p->smoothed_rtt / 1000.0 : 9999.0);
-    
-    static double ewma[16] = {0};
-    double a = 0.2; // 보정 계수
-    int pid = (int)(p->unique_path_id % 16);
-
-    /* 지수 이동 평균 계산 (급격한 변화 억제) */
-    if (ewma[pid] < 0.5) 
-        ewma[pid] = rtt_ms;
-    else 
-        ewma[pid] = a * rtt_ms + (1 - a) * ewma[pid];
-
-    M.rtt_ms = ewma[pid];
+    /* 2~3. 추정기가 있으면 반감기 창의 RTT 평균/분산, 손실률, goodput을 그대로 사용 */
+    if (e) {
+        M.rtt_ms     = e->rtt_ms > 0 ? e->rtt_ms : 9999.0;
+        M.rtt_var_ms = sqrt(e->rtt_var);
+        M.loss_rate  = e->loss_pct;
+        M.goodput    = e->goodput_Bps * 8.0 / 1e6;
+
+        /* 보낸 데이터가 오래 전달되지 않거나 하트비트 응답이 끊긴 경로는 RTT/손실 표본이 쌓이기 전에 BAD */
+        if (e->stale || e->suspect) {
+            M.grade = 2;
+            return M;
+        }
+    } else {
+        /* 2. RTT: Smoothed RTT가 없으면 기본값으로 9999ms 설정 */
+        M.rtt_ms = (p->smoothed_rtt > 0 ? p->smoothed_rtt / 1000.0 : 9999.0);
 
-    /* 3. Loss Rate(손실률) 계산 */
-    uint64_t delivered = (p->delivered > 0 ? p->delivered : 1);
-    double loss_pct = 0.0;
+        /* 3. Loss Rate(손실률): 전달된 바이트 대비 손실 바이트 비율 (연결 시작부터 누적) */
+        uint64_t delivered = (p->delivered > 0 ? p->delivered : 1);
+        double loss_pct = 0.0;
 
-    /* 전달된 바이트 대비 손실 바이트 비율 계산 */
-    if (p->total_bytes_lost > 0 && p->total_bytes_lost < delivered)
-        loss_pct = (double)p->total_bytes_lost * 100.0 / (double)delivered;
-    else if (p->total_bytes_lost >= delivered)
-        loss_pct = 50.0; // 비정상 상황 가드
+        if (p->total_bytes_lost > 0 && p->total_bytes_lost < delivered)
+            loss_pct = (double)p->total_bytes_lost * 100.0 / (double)delivered;
+        else if (p->total_bytes_lost >= delivered)
+            loss_pct = 50.0; // 비정상 상황 가드
 
-    M.loss_rate = loss_pct;
+        M.loss_rate = loss_pct;
+    }
 
     /* 4. 메트릭 기반 등급 판정 (0:GOOD, 1:WARN, 2:BAD) */
     if (M.rtt_ms > 250.0 || M.loss_rate > 10.0)      
@@ -167,7 +169,8 @@ static inline int pick_primary_idx(
     uint32_t ip_usb_be,
     int* last_primary,
     uint64_t now,
-    uint64_t* last_switch_time
+    uint64_t* last_switch_time,
+    const tx_t* st
 ){
     if (sc <= 0) return -1;
     
@@ -190,8 +193,8 @@ static inline int pick_primary_idx(
     if (!WLAN && !USB) return *last_primary;
 
     /* 2. 각 경로의 메트릭 계산 */
-    path_metric_t Mwlan = WLAN ? compute_metric_safe(WLAN) : (path_metric_t){ .grade = 2 };
-    path_metric_t Musb  = USB  ? compute_metric_safe(USB)  : (path_metric_t){ .grade = 2 };
+    path_metric_t Mwlan = WLAN ? compute_metric_safe(WLAN, st ? est_of(st, c, sel[wlan_idx].idx) : NULL) : (path_metric_t){ .grade = 2 };
+    path_metric_t Musb  = USB  ? compute_metric_safe(USB,  st ? est_of(st, c, sel[usb_idx].idx)  : NULL) : (path_metric_t){ .grade = 2 };
         
     // LOGF("[PICK] METRIC WLAN grade=%d", Mwlan.grade);
     // LOGF("[PICK] METRIC USB  grade=%d", Musb.grade);
@@ -210,13 +213,13 @@ static inline int pick_primary_idx(
 /**
  * @brief 중복되지 않고 검증 완료된 유효 경로 리스트를 생성합니다.
  */
-static inline void build_unique_verified_paths(picoquic_cnx_t* c, pathsel_t* sel, int* sc_io)
+static inline void build_unique_verified_paths(picoquic_cnx_t* c, const tx_t* st, pathsel_t* sel, int* sc_io)
 {
     int sc = 0;
     for (int i = 0; i < c->nb_paths; i++) {
         picoquic_path_t* p = c->path[i];
         if (!p || !p->first_tuple) continue;
-        if (!path_verified_ptr(p)) continue;
+        if (!path_usable_ptr(st, p, i)) continue;   /* 하트비트 응답 대기 중인 경로도 후보 */
 
         struct sockaddr_in* la = (struct sockaddr_in*)&p->first_tuple->local_addr;
         if (la->sin_family != AF_INET) continue;
@@ -242,18 +245,18 @@ static inline void build_unique_verified_paths(picoquic_cnx_t* c, pathsel_t* sel
 /**
  * @brief 원하는 인덱스가 유효하지 않을 경우 검증된 아무 경로로나 폴백합니다.
  */
-static inline int choose_verified_or_fallback(picoquic_cnx_t* c, int want_idx)
+static inline int choose_verified_or_fallback(picoquic_cnx_t* c, const tx_t* st, int want_idx)
 {
     if (want_idx >= 0 && want_idx < c->nb_paths) {
         picoquic_path_t* p = c->path[want_idx];
-        if (p && p->first_tuple && p->first_tuple->challenge_verified)
+        if (path_usable_ptr(st, p, want_idx))
             return want_idx;
     }
 
     /* 모든 경로를 순회하여 검증된 첫 번째 경로 선택 */
     for (int i = 0; i < c->nb_paths; i++) {
         picoquic_path_t* p = c->path[i];
-        if (p && p->first_tuple && p->first_tuple->challenge_verified)
+        if (path_usable_ptr(st, p, i))
             return i;
     }
     
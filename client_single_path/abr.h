@@ -0,0 +1,286 @@
+#ifndef ABR_H
+#define ABR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "picoquic.h"
+#include "picoquic_internal.h"
+#include "struct_type.h"
+#include "net_tools.h"
+#include "camera.h"
+
+/* ============================================================
+ * [1] 품질 사다리 및 설정
+ * ============================================================ */
+
+/*
+ * 선택된 경로의 전달 능력을 picoquic 상태로 추정해, 한 프레임이 도착하기까지의 예상 시간
+ *     T = srtt/2 + (bytes_in_transit + 프레임 크기) / 용량
+ * 이 목표(target_ms) 아래로, 그리고 프레임 크기 × 프레임률이 용량 아래로 유지되도록
+ * JPEG 품질 → 해상도 → 프레임률 순으로 낮춥니다.
+ *   - 용량 = min(bandwidth_estimate, cwin / srtt)  (값이 없으면 pacing_rate)
+ *   - 내릴 때는 빠르게(초과가 ABR_DOWN_HOLD_US 지속, 2배 초과나 경로 전환 시 감당 가능한 단계로 바로),
+ *     올릴 때는 느리게(여유가 ABR_UP_HOLD_US 지속 + 한 단계 위로도 용량/목표의 ABR_UP_MARGIN 이하)
+ * 품질/해상도는 재인코딩하는 소스(OpenCV)에만 적용되며, 프레임률은 모든 소스에 적용됩니다.
+ * (MJPEG 직송 등 크기를 못 바꾸는 소스는 프레임률로 bytes_in_transit을 줄이는 것만 가능)
+ */
+
+#define ABR_TARGET_MS_DEFAULT  150.0
+#define ABR_DOWN_HOLD_US       200000ULL   /* 목표 초과가 이만큼 이어지면 한 단계 내림 */
+#define ABR_UP_HOLD_US         2000000ULL  /* 여유가 이만큼 이어지면 한 단계 올림 */
+#define ABR_UP_MARGIN          0.7         /* 올릴 단계가 용량/목표의 70% 이내일 때만 올림 */
+#define ABR_DOWN_MARGIN        0.85        /* 한 번에 내릴 때 용량/목표의 85% 이내인 단계까지 */
+#define ABR_EWMA_ALPHA         0.25
+
+/**
+ * @brief 사다리 한 단계: 품질 / 해상도(%) / 최대 프레임률 / 0단계 대비 예상 프레임 크기 비율
+ */
+typedef struct {
+    int    quality;
+    int    scale_pct;
+    int    fps;
+    double size_ratio;
+} abr_rung_t;
+
+static const abr_rung_t k_abr_ladder[] = {
+    { 95, 100, 30, 1.00 },
+    { 85, 100, 30, 0.55 },
+    { 75, 100, 30, 0.40 },
+    { 70,  75, 30, 0.25 },
+    { 60,  75, 20, 0.20 },
+    { 50,  50, 15, 0.09 },
+    { 40,  50, 10, 0.07 },
+    { 35,  33,  5, 0.03 },
+};
+#define ABR_LEVELS ((int)(sizeof(k_abr_ladder) / sizeof(k_abr_ladder[0])))
+
+
+/* ============================================================
+ * [2] 경로 용량 추정 및 단계 적용
+ * ============================================================ */
+
+static inline void abr_init(abr_t* a, double target_ms, int adapt_size){
+    memset(a, 0, sizeof(*a));
+    a->target_ms  = target_ms;
+    a->adapt_size = adapt_size;
+    a->path_idx   = -1;
+}
+
+/**
+ * @brief 단계별 예상 프레임 크기 비율 (크기를 못 바꾸는 소스는 항상 1)
+ */
+static inline double abr_ratio(const abr_t* a, int level){
+    return a->adapt_size ? k_abr_ladder[level].size_ratio : 1.0;
+}
+
+/**
+ * @brief picoquic 경로 상태로 전달 용량(B/s)을 추정합니다. 정보가 없으면 0
+ */
+static inline double abr_path_capacity(const picoquic_path_t* p){
+    if (!p) return 0.0;
+
+    double bw  = (double)p->bandwidth_estimate;
+    double win = (p->smoothed_rtt > 0) ? (double)p->cwin * 1e6 / (double)p->smoothed_rtt : 0.0;
+
+    if (bw > 0 && win > 0) return bw < win ? bw : win;
+    if (bw > 0)  return bw;
+    if (win > 0) return win;
+    return (double)p->pacing_rate;
+}
+
+/**
+ * @brief 주어진 크기의 프레임이 이 경로로 전달되기까지의 예상 시간(ms)
+ */
+static inline double abr_predict_ms(const abr_t* a, const picoquic_path_t* p, double frame_B){
+    if (a->cap_Bps <= 0) return 0.0;
+    double half_rtt = p->smoothed_rtt / 2000.0;
+    return half_rtt + ((double)p->bytes_in_transit + frame_B) * 1000.0 / a->cap_Bps;
+}
+
+/**
+ * @brief 해당 단계가 이 경로에서 지속 가능한지 판단합니다. (쌓인 bytes_in_transit은 빠진다고 보고 정상 상태만 평가)
+ *   - 처리량: 프레임 크기 × 프레임률 <= margin × 용량
+ *   - 지연:   srtt/2 + 프레임 크기 / 용량 <= margin × 목표
+ */
+static inline int abr_fits(const abr_t* a, const picoquic_path_t* p, int level, double base_B, double margin){
+    if (a->cap_Bps <= 0) return 1;
+    double B   = base_B * abr_ratio(a, level);
+    double fps = k_abr_ladder[level].fps;
+    if (a->in_fps > 0 && a->in_fps < fps) fps = a->in_fps;
+
+    if (B * fps > margin * a->cap_Bps) return 0;
+    return p->smoothed_rtt / 2000.0 + B * 1000.0 / a->cap_Bps <= margin * a->target_ms;
+}
+
+/**
+ * @brief 단계를 바꾸고 인코더 파라미터에 반영합니다.
+ */
+static inline void abr_set_level(abr_t* a, int level, uint64_t now){
+    if (level < 0) level = 0;
+    if (level >= ABR_LEVELS) level = ABR_LEVELS - 1;
+    if (level == a->level) return;
+
+    const abr_rung_t* to = &k_abr_ladder[level];
+
+    LOGF("[ABR] path=%d cap=%.2fMbps frame=%.0fKB pred=%.0fms target=%.0fms level %d->%d (q=%d scale=%d%% fps=%d)",
+         a->path_idx, a->cap_Bps * 8 / 1e6, a->frame_B / 1024, a->pred_ms, a->target_ms,
+         a->level, level, to->quality, to->scale_pct, to->fps);
+
+    camera_jpeg_params_t jp;
+    camera_get_jpeg_params(&jp);
+    jp.quality   = to->quality;
+    jp.scale_pct = to->scale_pct;
+    camera_set_jpeg_params(&jp);
+
+    /* 새 단계의 프레임 크기는 비율로 미리 환산 (실측이 들어오면 EWMA로 보정) */
+    if (a->frame_B > 0) a->frame_B *= abr_ratio(a, level) / abr_ratio(a, a->level);
+
+    a->level = level;
+    a->last_change = now;
+    a->over_since = a->under_since = 0;
+    a->changes++;
+}
+
+
+/* ============================================================
+ * [3] 매 프레임 호출
+ * ============================================================ */
+
+/**
+ * @brief 전송 직전에 호출합니다. 선택된 경로로 용량을 갱신하고 단계를 조정합니다.
+ * @param p      이번 프레임을 보낼 경로
+ * @param k      경로 인덱스 (바뀌면 페일오버로 보고 즉시 재평가)
+ * @param len    이번 프레임 크기 (B)
+ * @return 이번 프레임을 보내면 1, 프레임률 제한으로 건너뛰면 0
+ */
+static inline int abr_on_frame(abr_t* a, picoquic_path_t* p, int k, size_t len, uint64_t now){
+    if (a->target_ms <= 0 || !p) return 1;
+
+    /* 1. 용량/입력 프레임률 추정 갱신 (경로가 바뀌면 이전 경로 값은 버림) */
+    double cap = abr_path_capacity(p);
+    int switched = (a->path_idx >= 0 && k != a->path_idx);
+    if (switched || a->cap_Bps <= 0) a->cap_Bps = cap;
+    else if (cap > 0)                a->cap_Bps = ABR_EWMA_ALPHA * cap + (1 - ABR_EWMA_ALPHA) * a->cap_Bps;
+    a->path_idx = k;
+
+    if (a->last_in && now > a->last_in) {
+        double fps = 1e6 / (double)(now - a->last_in);
+        a->in_fps = a->in_fps > 0 ? ABR_EWMA_ALPHA * fps + (1 - ABR_EWMA_ALPHA) * a->in_fps : fps;
+    }
+    a->last_in = now;
+
+    if (a->frame_B <= 0) a->frame_B = (double)len;
+    else                 a->frame_B = ABR_EWMA_ALPHA * (double)len + (1 - ABR_EWMA_ALPHA) * a->frame_B;
+
+    /* 2. 현재 단계 평가 → 단계 조정 (히스테리시스) */
+    double base = a->frame_B / abr_ratio(a, a->level);   /* 0단계 기준으로 환산한 프레임 크기 */
+    a->pred_ms = abr_predict_ms(a, p, a->frame_B);
+
+    if (a->pred_ms > a->target_ms || !abr_fits(a, p, a->level, base, 1.0)) {
+        a->under_since = 0;
+        if (!a->over_since) a->over_since = now;
+
+        if ((switched || a->pred_ms > 2 * a->target_ms) && now - a->last_change >= ABR_DOWN_HOLD_US / 2) {
+            /* 페일오버 직후나 큰 초과: 지속 가능한 단계까지 한 번에 */
+            int lv = a->level + 1;
+            while (lv < ABR_LEVELS - 1 && !abr_fits(a, p, lv, base, ABR_DOWN_MARGIN)) lv++;
+            abr_set_level(a, lv, now);
+        } else if (now - a->over_since >= ABR_DOWN_HOLD_US) {
+            abr_set_level(a, a->level + 1, now);
+        }
+    } else {
+        a->over_since = 0;
+        if (a->level > 0) {
+            int room = abr_fits(a, p, a->level - 1, base, ABR_UP_MARGIN);
+
+            if (!room) a->under_since = 0;
+            else if (!a->under_since) a->under_since = now;
+
+            if (room && now - a->under_since >= ABR_UP_HOLD_US && now - a->last_change >= ABR_UP_HOLD_US) {
+                abr_set_level(a, a->level - 1, now);
+            }
+        }
+    }
+
+    /* 3. 프레임률 제한 (간격의 90%까지는 허용해 캡처 지터로 인한 과도한 건너뜀 방지) */
+    uint64_t gap = 1000000ULL / (uint64_t)k_abr_ladder[a->level].fps;
+    if (a->last_frame && now - a->last_frame < gap * 9 / 10) {
+        a->skipped++;
+        return 0;
+    }
+    a->last_frame = now;
+    return 1;
+}
+
+
+/* ============================================================
+ * [4] 송신 큐 기반 프레임 허용 (latest-frame-wins)
+ * ============================================================ */
+
+/*
+ * picoquic_add_to_stream은 경로가 느려도 데이터를 무한정 받아 두므로, 밀린 프레임 뒤에 새 프레임을 쌓으면
+ * 종단 지연이 수 초까지 늘어납니다. 큐에 넣기 전에 해당 경로 스트림의 미전송 바이트를 재서
+ *     대기 = 미전송 바이트 / 경로 용량
+ * 이 예산(budget_ms)을 넘으면 새 프레임을 넣지 않고 건너뜁니다. 우편함은 최신 프레임만 남기므로
+ * 큐가 빠진 다음 차례에는 가장 최근 프레임이 들어갑니다. (fps를 내주고 신선도를 얻음)
+ * JIT 송신에서는 직렬화 중인 프레임의 나머지가 대기 시간이 되고, 예산 안이면 아직 나가지 않은
+ * 대기 프레임을 새 프레임으로 교체합니다. (send_frame_jit)
+ * 용량을 아직 모르면 이미 프레임 하나 이상이 대기 중일 때만 건너뜁니다.
+ */
+
+#define ADMIT_BUDGET_MS_DEFAULT  100.0
+#define ADMIT_LOG_US             1000000ULL
+
+static inline void admit_init(admit_t* ad, double budget_ms){
+    memset(ad, 0, sizeof(*ad));
+    ad->budget_ms = budget_ms;
+}
+
+/**
+ * @brief 스트림 송신 큐에 남아 있는(아직 패킷으로 나가지 않은) 바이트 수
+ */
+static inline size_t stream_unsent_bytes(picoquic_cnx_t* c, uint64_t sid){
+    picoquic_stream_head_t* s = picoquic_find_stream(c, sid);
+    if (!s) return 0;
+
+    size_t n = 0;
+    for (picoquic_stream_queue_node_t* q = s->send_queue; q; q = q->next_stream_data) {
+        n += q->length - (size_t)q->offset;    /* offset: 노드 안에서 이미 보낸 위치 */
+    }
+    return n;
+}
+
+/**
+ * @brief 새 프레임을 경로 k의 스트림에 넣을지 판단합니다. (전송 직전에 호출)
+ * @param ahead picoquic 큐 밖에서 새 프레임보다 먼저 나갈 바이트 (JIT 송신의 직렬화 중인 프레임 나머지)
+ * @return 넣으면 1, 큐가 밀려 이번 프레임을 건너뛰면 0
+ */
+static inline int admit_frame(admit_t* ad, picoquic_cnx_t* c, uint64_t sid, int k, size_t ahead,
+                              size_t len, uint64_t now){
+    if (ad->budget_ms <= 0 || !c || k < 0 || k >= c->nb_paths) return 1;
+
+    ad->unsent_B = (sid ? stream_unsent_bytes(c, sid) : 0) + ahead;
+    double cap = abr_path_capacity(c->path[k]);
+    ad->wait_ms = cap > 0 ? (double)ad->unsent_B * 1000.0 / cap : 0.0;
+
+    int ok = (cap > 0) ? ad->wait_ms <= ad->budget_ms : ad->unsent_B < len;
+    if (ok) ad->admitted++;
+    else    ad->skipped++;
+
+    /* 1초마다 건너뛴 비율 보고 (건너뛴 프레임이 있을 때만) */
+    if (now - ad->last_log >= ADMIT_LOG_US) {
+        uint64_t ds = ad->skipped - ad->log_skipped, da = ad->admitted - ad->log_admitted;
+        if (ds > 0) {
+            LOGF("[ADMIT] path=%d skipped=%" PRIu64 "/%" PRIu64 " queue=%zuB wait=%.0fms budget=%.0fms",
+                 k, ds, ds + da, ad->unsent_B, ad->wait_ms, ad->budget_ms);
+        }
+        ad->log_skipped  = ad->skipped;
+        ad->log_admitted = ad->admitted;
+        ad->last_log     = now;
+    }
+    return ok;
+}
+
+#endif /* ABR_H */
@@ -2,28 +2,1130 @@
 #include <opencv2/opencv.hpp>
 #include <vector>
 
+#include <string>
+#include <algorithm>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/videodev2.h>
+#include <atomic>
+#include <mutex>
+
+#ifdef HAVE_LIBJPEG_TURBO
+#include <csetjmp>
+#include <jpeglib.h>
+#endif
+
+#ifdef HAVE_X264
 extern "C" {
+#include <x264.h>
+}
+#endif
+
+/* ============================================================
+ * [1] 캡처 백엔드 설정
+ * ============================================================ */
+
+#define CAM_WIDTH        1280
+#define CAM_HEIGHT       720
+#define CAM_FPS          30
+#define CAM_V4L2_BUFS    4       /* 드라이버 mmap 버퍼 수 */
+#define CAM_DQ_TIMEOUT_MS 1000   /* 프레임 대기 제한 시간 */
+
+#define CAM_FRAME_CAP     (1u << 20)     /* 파이프라인 프레임 버퍼 기본 용량 */
+#define SYN_SIZE_DEFAULT  (100 * 1024)  /* 합성 프레임 기본 크기 (B) */
+#define REPLAY_GAP_MAX_US 1000000ULL     /* 기록 간격이 이보다 길면 잘라냄 */
+
+#define JPEG_QUALITY_DEFAULT  95        /* cv::imencode 기본값과 동일 */
+#define JPEG_ROWS_PER_WRITE   16        /* jpeg_write_scanlines 한 번에 넘기는 행 수 */
+
+#define H264_GOP_DEFAULT      60        /* 키프레임 간격 (프레임 수, 30fps 기준 2초) */
+#define H264_KBPS_DEFAULT     2000      /* 목표 비트레이트 (kbit/s, ABR 0단계 기준) */
+#define H264_PRESET_DEFAULT   "veryfast"
+
+struct v4l2_map_t {
+    void*  start;
+    size_t length;
+};
+
+struct camera_t;
 
 /**
- * @brief 새로운 카메라 객체를 생성하고 그 핸들을 반환합니다.
- *        MJPEG 스트림을 바로 받아서 인코딩 없이 전송 가능.
+ * @brief 프레임 소스 인터페이스입니다. 각 소스는 open 시 자신의 ops를 camera_t에 연결합니다.
+ *   v4l2-mjpeg : 네이티브 V4L2 mmap, MJPEG 그대로 전달 (디코딩/재인코딩 없음)
+ *   opencv     : cv::VideoCapture 디코딩 + imencode (폴백)
+ *   synthetic  : 지정 크기/속도/지터의 합성 JPEG
+ *   replay     : frame_*.jpg 디렉토리 또는 서버 .seg 파일 재생
  */
-camera_handle_t camera_create() {
-    // /dev/video1이 MJPEG 스트림일 가능성이 높음 → 장치 번호 변경 가능
-    cv::VideoCapture* cap = new cv::VideoCapture(0, cv::CAP_V4L2);
+struct cam_source_ops_t {
+    const char* name;
+    int  (*capture)(camera_t* c, unsigned char* buffer, int buf_size);
+    void (*close)(camera_t* c);
+    int  (*grab_raw)(camera_t* c, camera_frame_t* f);   /* 인코딩 전 원본 획득 (압축 소스는 NULL) */
+};
+
+/**
+ * @brief camera_handle_t가 가리키는 실제 카메라(프레임 소스) 객체입니다.
+ */
+struct camera_t {
+    const cam_source_ops_t*  ops;
+
+    /* V4L2 백엔드 */
+    int               fd;
+    v4l2_map_t        bufs[CAM_V4L2_BUFS];
+    unsigned          nbufs;
+    int               streaming;
+
+    /* OpenCV 백엔드 */
+    cv::VideoCapture* cap;
+
+    /* 합성/재생 소스 공통: 프레임 간격 제어 */
+    uint64_t          period_ns;   /* 고정 간격 (0이면 기록된 시각 사용) */
+    uint64_t          next_ns;     /* 다음 프레임 송출 시각 (CLOCK_MONOTONIC) */
+
+    /* 합성 소스 */
+    size_t            syn_size;
+    int               syn_jitter;  /* 크기 지터 (±%) */
+    unsigned          syn_seed;
+    uint64_t          syn_seq;
+
+    /* 재생 소스 */
+    std::vector<std::string> rp_files;   /* 디렉토리 재생: 파일 목록 (이름순) */
+    std::vector<uint64_t>    rp_ts_us;   /* 각 파일의 기록 시각 (mtime) */
+    size_t            rp_pos;
+    FILE*             rp_seg;            /* .seg 재생 */
+    int               rp_loop;
+};
+
+/*
+ * UVC 카메라의 MJPEG 프레임은 허프만 테이블(DHT)을 생략하는 경우가 많습니다.
+ * (표준 테이블 사용을 전제) 저장된 .jpg가 일반 디코더에서 열리도록,
+ * DHT가 없으면 SOS 앞에 ITU T.81 K.3 표준 테이블을 끼워 넣습니다.
+ */
+static const unsigned char k_std_dht[] = {
+    0xff, 0xc4, 0x01, 0xa2, 0x00, 0x00, 0x01, 0x05, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a,
+    0x0b, 0x10, 0x00, 0x02, 0x01, 0x03, 0x03, 0x02, 0x04, 0x03, 0x05, 0x05, 0x04, 0x04, 0x00, 0x00,
+    0x01, 0x7d, 0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51,
+    0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52,
+    0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47,
+    0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67,
+    0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6,
+    0xf7, 0xf8, 0xf9, 0xfa, 0x01, 0x00, 0x03, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a,
+    0x0b, 0x11, 0x00, 0x02, 0x01, 0x02, 0x04, 0x04, 0x03, 0x04, 0x07, 0x05, 0x04, 0x04, 0x00, 0x01,
+    0x02, 0x77, 0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07,
+    0x61, 0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33,
+    0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19,
+    0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46,
+    0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66,
+    0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85,
+    0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3,
+    0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba,
+    0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8,
+    0xd9, 0xda, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6,
+    0xf7, 0xf8, 0xf9, 0xfa,
+};
+
+
+/* ============================================================
+ * [2] 네이티브 V4L2 백엔드 (mmap, MJPEG 패스스루)
+ * ============================================================ */
+
+static int xioctl(int fd, unsigned long req, void* arg) {
+    int r;
+    do { r = ioctl(fd, req, arg); } while (r < 0 && errno == EINTR);
+    return r;
+}
+
+static void v4l2_close(camera_t* c) {
+    if (c->streaming) {
+        enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        xioctl(c->fd, VIDIOC_STREAMOFF, &type);
+        c->streaming = 0;
+    }
+    for (unsigned i = 0; i < c->nbufs; i++) {
+        if (c->bufs[i].start && c->bufs[i].start != MAP_FAILED) munmap(c->bufs[i].start, c->bufs[i].length);
+    }
+    c->nbufs = 0;
+    if (c->fd >= 0) close(c->fd);
+    c->fd = -1;
+}
+
+/**
+ * @brief 장치를 MJPEG 포맷으로 설정하고 mmap 버퍼를 큐에 넣은 뒤 스트리밍을 시작합니다.
+ */
+static int v4l2_open(camera_t* c, const char* dev) {
+    c->fd = open(dev, O_RDWR | O_NONBLOCK);
+    if (c->fd < 0) {
+        fprintf(stderr, "[CAM] V4L2 open %s 실패: %s\n", dev, strerror(errno));
+        return -1;
+    }
+
+    struct v4l2_format fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    fmt.fmt.pix.width       = CAM_WIDTH;
+    fmt.fmt.pix.height      = CAM_HEIGHT;
+    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_MJPEG;
+    fmt.fmt.pix.field       = V4L2_FIELD_ANY;
+    if (xioctl(c->fd, VIDIOC_S_FMT, &fmt) < 0 || fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_MJPEG) {
+        fprintf(stderr, "[CAM] V4L2 MJPEG 포맷 미지원 (%s)\n", dev);
+        v4l2_close(c);
+        return -1;
+    }
+
+    /* 프레임레이트는 실패해도 치명적이지 않음 */
+    struct v4l2_streamparm parm;
+    memset(&parm, 0, sizeof(parm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    parm.parm.capture.timeperframe.numerator   = 1;
+    parm.parm.capture.timeperframe.denominator = CAM_FPS;
+    xioctl(c->fd, VIDIOC_S_PARM, &parm);
+
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count  = CAM_V4L2_BUFS;
+    req.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(c->fd, VIDIOC_REQBUFS, &req) < 0 || req.count < 2) {
+        fprintf(stderr, "[CAM] VIDIOC_REQBUFS 실패: %s\n", strerror(errno));
+        v4l2_close(c);
+        return -1;
+    }
+
+    for (unsigned i = 0; i < req.count && i < CAM_V4L2_BUFS; i++) {
+        struct v4l2_buffer b;
+        memset(&b, 0, sizeof(b));
+        b.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        b.memory = V4L2_MEMORY_MMAP;
+        b.index  = i;
+        if (xioctl(c->fd, VIDIOC_QUERYBUF, &b) < 0) { v4l2_close(c); return -1; }
+
+        c->bufs[i].length = b.length;
+        c->bufs[i].start  = mmap(NULL, b.length, PROT_READ | PROT_WRITE, MAP_SHARED, c->fd, b.m.offset);
+        c->nbufs = i + 1;
+        if (c->bufs[i].start == MAP_FAILED) { v4l2_close(c); return -1; }
+
+        if (xioctl(c->fd, VIDIOC_QBUF, &b) < 0) { v4l2_close(c); return -1; }
+    }
+
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(c->fd, VIDIOC_STREAMON, &type) < 0) {
+        fprintf(stderr, "[CAM] VIDIOC_STREAMON 실패: %s\n", strerror(errno));
+        v4l2_close(c);
+        return -1;
+    }
+    c->streaming = 1;
+
+    fprintf(stderr, "[CAM] V4L2 MJPEG passthrough %s %ux%u bufs=%u\n",
+            dev, fmt.fmt.pix.width, fmt.fmt.pix.height, c->nbufs);
+    return 0;
+}
+
+/**
+ * @brief DHT가 빠진 MJPEG 프레임이면 표준 테이블을 넣어 out에 복사합니다.
+ * @return 복사된 길이, 버퍼 부족 시 -4
+ */
+static int mjpeg_copy(const unsigned char* src, size_t len, unsigned char* out, int cap) {
+    size_t sos = 0;
+    int has_dht = 0;
+
+    /* SOI 이후 마커 세그먼트를 SOS까지 순회 */
+    for (size_t p = 2; p + 4 <= len; ) {
+        if (src[p] != 0xFF) break;
+        unsigned char m = src[p + 1];
+        if (m == 0xC4) has_dht = 1;
+        if (m == 0xDA) { sos = p; break; }
+        p += 2 + (((size_t)src[p + 2] << 8) | src[p + 3]);
+    }
+
+    size_t extra = (!has_dht && sos) ? sizeof(k_std_dht) : 0;
+    if (len + extra > (size_t)cap) {
+        fprintf(stderr, "버퍼 크기 부족: 필요 %zu, 제공 %d\n", len + extra, cap);
+        return -4;
+    }
+
+    if (!extra) {
+        memcpy(out, src, len);
+        return (int)len;
+    }
+    memcpy(out, src, sos);
+    memcpy(out + sos, k_std_dht, sizeof(k_std_dht));
+    memcpy(out + sos + sizeof(k_std_dht), src + sos, len - sos);
+    return (int)(len + extra);
+}
+
+/**
+ * @brief 채워진 드라이버 버퍼 하나를 꺼내(DQBUF) 압축 바이트를 그대로 복사하고 다시 큐에 넣습니다(QBUF).
+ */
+static int v4l2_capture(camera_t* c, unsigned char* buffer, int buf_size) {
+    struct pollfd pfd = { c->fd, POLLIN, 0 };
+    int r = poll(&pfd, 1, CAM_DQ_TIMEOUT_MS);
+    if (r <= 0) {
+        fprintf(stderr, "프레임 캡처 실패 (timeout)\n");
+        return -2;
+    }
+
+    struct v4l2_buffer b;
+    memset(&b, 0, sizeof(b));
+    b.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    b.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(c->fd, VIDIOC_DQBUF, &b) < 0) {
+        if (errno == EAGAIN) return -2;
+        fprintf(stderr, "VIDIOC_DQBUF 실패: %s\n", strerror(errno));
+        return -2;
+    }
+
+    int n;
+    if ((b.flags & V4L2_BUF_FLAG_ERROR) || b.bytesused < 4 || b.index >= c->nbufs) {
+        n = -2;  /* 손상된 프레임은 버림 */
+    } else {
+        n = mjpeg_copy((const unsigned char*)c->bufs[b.index].start, b.bytesused, buffer, buf_size);
+    }
+
+    xioctl(c->fd, VIDIOC_QBUF, &b);
+    return n;
+}
+
+
+/* ============================================================
+ * [3] JPEG 인코더 (libjpeg-turbo / OpenCV)
+ * ============================================================ */
+
+/*
+ * 디코딩된 프레임(OpenCV 소스)만 이 단계를 거칩니다. MJPEG 직송/합성/재생 소스는 인코딩하지 않습니다.
+ *   libjpeg-turbo : 스레드마다 압축기(jpeg_compress_struct)를 한 번 만들어 재사용하고,
+ *                   출력 대상을 호출자 버퍼로 지정해 중간 버퍼/복사 없이 전송 버퍼에 바로 씁니다.
+ *   opencv        : cv::imencode (빌드에 libjpeg-turbo가 없을 때 또는 CAM_ENCODER=opencv)
+ * 품질/크로마 서브샘플링/재시작 간격은 실행 중 camera_set_jpeg_params로 바꿀 수 있으며 다음 프레임부터 적용됩니다.
+ */
+
+enum { ENC_OPENCV = 0, ENC_LIBJPEG = 1 };
+
+static std::atomic<int>      g_encoder{ENC_OPENCV};
+static std::atomic<uint64_t> g_jpeg_packed{0};   /* quality | subsamp << 8 | restart_rows << 16 | scale_pct << 32 (한 번에 읽도록 묶음) */
+static std::once_flag        g_jpeg_once;
+
+static uint64_t jpeg_pack(const camera_jpeg_params_t* p) {
+    return (uint64_t)(p->quality & 0xff) | ((uint64_t)(p->subsamp & 0xff) << 8) |
+           ((uint64_t)(p->restart_rows & 0xffff) << 16) | ((uint64_t)(p->scale_pct & 0xff) << 32);
+}
+
+static camera_jpeg_params_t jpeg_unpack(uint64_t v) {
+    camera_jpeg_params_t p;
+    p.quality      = (int)(v & 0xff);
+    p.subsamp      = (int)((v >> 8) & 0xff);
+    p.restart_rows = (int)((v >> 16) & 0xffff);
+    p.scale_pct    = (int)((v >> 32) & 0xff);
+    return p;
+}
+
+static void jpeg_params_clamp(camera_jpeg_params_t* p) {
+    if (p->quality < 1)   p->quality = 1;
+    if (p->quality > 100) p->quality = 100;
+    if (p->subsamp < CAM_JPEG_444 || p->subsamp > CAM_JPEG_GRAY) p->subsamp = CAM_JPEG_420;
+    if (p->restart_rows < 0)      p->restart_rows = 0;
+    if (p->restart_rows > 0xffff) p->restart_rows = 0xffff;
+    if (p->scale_pct <= 0 || p->scale_pct > 100) p->scale_pct = 100;   /* 0은 구버전 호출자(필드 미지정) → 원본 크기 */
+    if (p->scale_pct < 10) p->scale_pct = 10;
+}
+
+static void h264_env_init();
+
+/**
+ * @brief 환경 변수로 인코더와 기본 파라미터를 정합니다. (최초 1회, H.264 설정 포함)
+ *        CAM_ENCODER (auto|libjpeg|opencv), CAM_JPEG_QUALITY (1~100),
+ *        CAM_JPEG_SUBSAMP (444|422|420|gray), CAM_JPEG_RESTART (MCU 행 수, 0=없음), CAM_JPEG_SCALE (10~100 %)
+ */
+static void jpeg_env_init() {
+    camera_jpeg_params_t p = { JPEG_QUALITY_DEFAULT, CAM_JPEG_420, 0, 100 };
+
+    const char* q = getenv("CAM_JPEG_QUALITY");
+    if (q && *q) p.quality = atoi(q);
+    const char* ss = getenv("CAM_JPEG_SUBSAMP");
+    if (ss && !strcmp(ss, "444")) p.subsamp = CAM_JPEG_444;
+    if (ss && !strcmp(ss, "422")) p.subsamp = CAM_JPEG_422;
+    if (ss && !strcmp(ss, "gray")) p.subsamp = CAM_JPEG_GRAY;
+    const char* rst = getenv("CAM_JPEG_RESTART");
+    if (rst && *rst) p.restart_rows = atoi(rst);
+    const char* sc = getenv("CAM_JPEG_SCALE");
+    if (sc && *sc) p.scale_pct = atoi(sc);
+    jpeg_params_clamp(&p);
+    g_jpeg_packed.store(jpeg_pack(&p));
+
+#ifdef HAVE_LIBJPEG_TURBO
+    int enc = ENC_LIBJPEG;
+#else
+    int enc = ENC_OPENCV;
+#endif
+    const char* e = getenv("CAM_ENCODER");
+    if (e && !strcmp(e, "opencv")) enc = ENC_OPENCV;
+    g_encoder.store(enc);
+
+    h264_env_init();
+}
+
+static camera_jpeg_params_t jpeg_params_now() {
+    std::call_once(g_jpeg_once, jpeg_env_init);
+    return jpeg_unpack(g_jpeg_packed.load(std::memory_order_relaxed));
+}
+
+/**
+ * @brief 인코딩 결과의 최악 크기입니다. (버퍼가 모자랄 때 한 번 늘리는 용도)
+ * 4:4:4, 품질 100의 잡음 영상은 원본보다 커질 수 있으므로 TurboJPEG tjBufSize와 같은 픽셀당 6B로 잡습니다.
+ */
+static size_t jpeg_encode_bound(const cv::Mat& frame) {
+    size_t w = ((size_t)frame.cols + 15) & ~(size_t)15;
+    size_t h = ((size_t)frame.rows + 15) & ~(size_t)15;
+    return w * h * 6 + 2048;
+}
+
+/**
+ * @brief cv::imencode로 인코딩합니다. (스레드마다 별도 임시 버퍼를 써서 동시 호출 가능)
+ */
+static int opencv_encode_mat(const cv::Mat& frame, const camera_jpeg_params_t& p,
+                             unsigned char* buffer, int buf_size) {
+    thread_local std::vector<uchar> jpg_buf;
+    jpg_buf.clear();
+
+    /* imencode의 재시작 간격은 MCU 개수 단위이므로 행 수 × 행당 MCU 수로 환산 */
+    int mcu_w = (p.subsamp == CAM_JPEG_444 || p.subsamp == CAM_JPEG_GRAY) ? 8 : 16;
+    int rst   = p.restart_rows * ((frame.cols + mcu_w - 1) / mcu_w);
+    if (rst > 65535) rst = 65535;
+
+    std::vector<int> params = { cv::IMWRITE_JPEG_QUALITY, p.quality, cv::IMWRITE_JPEG_RST_INTERVAL, rst };
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && (CV_VERSION_MINOR > 5 || (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 5)))
+    static const int k_sampling[] = { cv::IMWRITE_JPEG_SAMPLING_FACTOR_444, cv::IMWRITE_JPEG_SAMPLING_FACTOR_422,
+                                      cv::IMWRITE_JPEG_SAMPLING_FACTOR_420, cv::IMWRITE_JPEG_SAMPLING_FACTOR_420 };
+    params.push_back(cv::IMWRITE_JPEG_SAMPLING_FACTOR);
+    params.push_back(k_sampling[p.subsamp]);
+#endif
+
+    cv::Mat gray;
+    const cv::Mat* src = &frame;
+    if (p.subsamp == CAM_JPEG_GRAY && frame.channels() == 3) {
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+        src = &gray;
+    }
+
+    if (!cv::imencode(".jpg", *src, jpg_buf, params)) {
+        fprintf(stderr, "JPEG 인코딩 실패\n");
+        return -3;
+    }
+
+    if ((int)jpg_buf.size() > buf_size) return -4;
+
+    memcpy(buffer, jpg_buf.data(), jpg_buf.size());
+    return static_cast<int>(jpg_buf.size());
+}
+
+#ifdef HAVE_LIBJPEG_TURBO
+
+/**
+ * @brief 스레드별로 재사용하는 libjpeg-turbo 압축기입니다.
+ * 출력은 호출자 버퍼에 직접 쓰며, 버퍼가 차면 longjmp로 빠져나와 -4를 돌려줍니다.
+ */
+struct jpeg_enc_t {
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr       jerr;
+    jpeg_destination_mgr dest;
+    jmp_buf              jb;
+    int                  overflow;
+    bool                 ready;
+
+    ~jpeg_enc_t() { if (ready) jpeg_destroy_compress(&cinfo); }
+};
+
+static thread_local jpeg_enc_t t_jenc;
+
+static void jenc_error_exit(j_common_ptr ci) {
+    jpeg_enc_t* e = static_cast<jpeg_enc_t*>(ci->client_data);
+    longjmp(e->jb, 1);
+}
+
+static void jenc_output_message(j_common_ptr ci) {
+    char msg[JMSG_LENGTH_MAX];
+    (*ci->err->format_message)(ci, msg);
+    fprintf(stderr, "[CAM] libjpeg: %s\n", msg);
+}
+
+static void    jenc_init_dest(j_compress_ptr) {}
+static void    jenc_term_dest(j_compress_ptr) {}
+static boolean jenc_empty_output(j_compress_ptr ci) {
+    jpeg_enc_t* e = static_cast<jpeg_enc_t*>(ci->client_data);
+    e->overflow = 1;
+    longjmp(e->jb, 1);
+    return FALSE;
+}
+
+static int libjpeg_encode_mat(const cv::Mat& frame, const camera_jpeg_params_t& p,
+                              unsigned char* buffer, int buf_size) {
+    jpeg_enc_t& e = t_jenc;
+    jpeg_compress_struct& ci = e.cinfo;
+
+    if (!e.ready) {
+        ci.err = jpeg_std_error(&e.jerr);
+        e.jerr.error_exit     = jenc_error_exit;
+        e.jerr.output_message = jenc_output_message;
+        jpeg_create_compress(&ci);
+        ci.client_data = &e;
+        e.dest.init_destination    = jenc_init_dest;
+        e.dest.empty_output_buffer = jenc_empty_output;
+        e.dest.term_destination    = jenc_term_dest;
+        ci.dest = &e.dest;
+        e.ready = true;
+    }
+
+    e.overflow = 0;
+    if (setjmp(e.jb)) {
+        jpeg_abort_compress(&ci);   /* 압축기는 다음 프레임에 그대로 재사용 */
+        if (e.overflow) return -4;
+        fprintf(stderr, "JPEG 인코딩 실패 (libjpeg)\n");
+        return -3;
+    }
+
+    e.dest.next_output_byte = buffer;
+    e.dest.free_in_buffer   = (size_t)buf_size;
+
+    ci.image_width      = (JDIMENSION)frame.cols;
+    ci.image_height     = (JDIMENSION)frame.rows;
+    ci.input_components = frame.channels();
+    ci.in_color_space   = frame.channels() == 1 ? JCS_GRAYSCALE : JCS_EXT_BGR;
+    jpeg_set_defaults(&ci);
+    jpeg_set_quality(&ci, p.quality, TRUE);
+
+    if (p.subsamp == CAM_JPEG_GRAY) {
+        jpeg_set_colorspace(&ci, JCS_GRAYSCALE);
+    } else if (ci.in_color_space != JCS_GRAYSCALE) {
+        ci.comp_info[0].h_samp_factor = (p.subsamp == CAM_JPEG_444) ? 1 : 2;
+        ci.comp_info[0].v_samp_factor = (p.subsamp == CAM_JPEG_420) ? 2 : 1;
+    }
+    ci.restart_in_rows = p.restart_rows;
+
+    jpeg_start_compress(&ci, TRUE);
+
+    JSAMPROW rows[JPEG_ROWS_PER_WRITE];
+    while (ci.next_scanline < ci.image_height) {
+        JDIMENSION n = 0;
+        while (n < JPEG_ROWS_PER_WRITE && ci.next_scanline + n < ci.image_height) {
+            rows[n] = const_cast<JSAMPROW>(frame.ptr<uchar>((int)(ci.next_scanline + n)));
+            n++;
+        }
+        jpeg_write_scanlines(&ci, rows, n);
+    }
+
+    jpeg_finish_compress(&ci);
+    return (int)((size_t)buf_size - e.dest.free_in_buffer);
+}
+
+#endif /* HAVE_LIBJPEG_TURBO */
+
+/**
+ * @brief 현재 인코더와 파라미터로 Mat을 JPEG으로 인코딩합니다. 여러 스레드에서 동시 호출 가능합니다.
+ * @return JPEG 길이, 버퍼 부족 시 -4, 실패 시 음수
+ */
+static int jpeg_encode_mat(const cv::Mat& in, unsigned char* buffer, int buf_size) {
+    camera_jpeg_params_t p = jpeg_params_now();
+
+    /* 해상도 축소 (ABR 등): 짝수 크기로 맞춰 서브샘플링 경계를 피함 */
+    const cv::Mat* src = &in;
+    thread_local cv::Mat scaled;
+    if (p.scale_pct < 100) {
+        int w = (in.cols * p.scale_pct / 100) & ~1;
+        int h = (in.rows * p.scale_pct / 100) & ~1;
+        if (w >= 16 && h >= 16) {
+            cv::resize(in, scaled, cv::Size(w, h), 0, 0, cv::INTER_AREA);
+            src = &scaled;
+        }
+    }
+    const cv::Mat& frame = *src;
+
+#ifdef HAVE_LIBJPEG_TURBO
+    if (g_encoder.load(std::memory_order_relaxed) == ENC_LIBJPEG &&
+        frame.depth() == CV_8U && (frame.channels() == 3 || frame.channels() == 1)) {
+        return libjpeg_encode_mat(frame, p, buffer, buf_size);
+    }
+#endif
+    return opencv_encode_mat(frame, p, buffer, buf_size);
+}
+
+
+/* ============================================================
+ * [4] H.264 인코더 (libx264, 선택)
+ * ============================================================ */
+
+/*
+ * 대역이 좁은 경로용 인터 프레임 모드입니다. (CAM_CODEC=h264 또는 camera_set_codec("h264"))
+ *   - tune=zerolatency: B 프레임/lookahead 없이 입력 1장당 접근 단위(AU) 1개를 바로 내보냄
+ *   - 출력은 Annex-B(시작 코드) AU이며, 키프레임마다 SPS/PPS를 반복하므로 각 GOP를 따로 디코딩할 수 있음
+ *   - 앞 프레임을 참조하므로 인코더는 하나뿐이고 입력 순서대로 불려야 함 (파이프라인은 인코딩 워커를 1개로 고정)
+ *   - 전송 쪽에서 프레임이 빠지면 camera_request_keyframe으로 다음 프레임을 IDR로 강제
+ * ABR과의 연동: 해상도(scale_pct)가 바뀌면 인코더를 다시 열고, 품질(quality)은 기본 비트레이트에 대한 비율로 환산해 VBV를 재설정합니다.
+ */
+
+static std::atomic<int>      g_codec{CAM_CODEC_JPEG};
+static std::atomic<uint64_t> g_h264_packed{0};   /* gop | bitrate_kbps << 32 */
+static std::atomic<int>      g_h264_key_req{0};
+
+static void h264_env_init() {
+    uint64_t gop = H264_GOP_DEFAULT, kbps = H264_KBPS_DEFAULT;
+    const char* g = getenv("CAM_H264_GOP");
+    if (g && atoi(g) > 0) gop = (uint64_t)atoi(g);
+    const char* b = getenv("CAM_H264_BITRATE");
+    if (b && atoi(b) > 0) kbps = (uint64_t)atoi(b);
+    g_h264_packed.store(gop | (kbps << 32));
+
+#ifdef HAVE_X264
+    const char* c = getenv("CAM_CODEC");
+    if (c && !strcmp(c, "h264")) g_codec.store(CAM_CODEC_H264);
+#endif
+}
+
+static camera_h264_params_t h264_params_now() {
+    std::call_once(g_jpeg_once, jpeg_env_init);
+    uint64_t v = g_h264_packed.load(std::memory_order_relaxed);
+    camera_h264_params_t p;
+    p.gop          = (int)(v & 0xffffffffu);
+    p.bitrate_kbps = (int)(v >> 32);
+    return p;
+}
+
+#ifdef HAVE_X264
+
+/**
+ * @brief 단일 x264 인코더 상태입니다. (인코딩 워커 1개에서만 호출되지만 방어적으로 잠금)
+ */
+struct h264_enc_t {
+    std::mutex m;
+    x264_t*    h = nullptr;
+    int        w = 0, ht = 0;
+    int        gop = 0;
+    int        kbps = 0;     /* 현재 적용된 비트레이트 (품질 환산 후) */
+    int64_t    pts = 0;
+    cv::Mat    yuv;          /* I420 변환 버퍼 (재사용) */
+
+    ~h264_enc_t() { if (h) x264_encoder_close(h); }
+};
+
+static h264_enc_t g_h264;
+
+static void h264_fill_rc(x264_param_t* par, int kbps) {
+    par->rc.i_rc_method       = X264_RC_ABR;
+    par->rc.i_bitrate         = kbps;
+    par->rc.i_vbv_max_bitrate = kbps;
+    par->rc.i_vbv_buffer_size = kbps / 2;   /* 0.5초 분량: 프레임 크기 요동을 억제해 전송 지연을 고르게 */
+}
+
+static int h264_open(h264_enc_t* e, int w, int h, int gop, int kbps) {
+    if (e->h) { x264_encoder_close(e->h); e->h = nullptr; }
+
+    x264_param_t par;
+    const char* preset = getenv("CAM_H264_PRESET");
+    if (x264_param_default_preset(&par, preset && *preset ? preset : H264_PRESET_DEFAULT, "zerolatency") < 0) {
+        x264_param_default_preset(&par, H264_PRESET_DEFAULT, "zerolatency");
+    }
+    par.i_csp            = X264_CSP_I420;
+    par.i_width          = w;
+    par.i_height         = h;
+    par.i_fps_num        = CAM_FPS;
+    par.i_fps_den        = 1;
+    par.i_keyint_max     = gop;
+    par.i_keyint_min     = gop;
+    par.b_repeat_headers = 1;    /* 키프레임마다 SPS/PPS (GOP 단위 독립 디코딩) */
+    par.b_annexb         = 1;
+    par.i_log_level      = X264_LOG_WARNING;
+    h264_fill_rc(&par, kbps);
+    x264_param_apply_profile(&par, "high");
+
+    e->h = x264_encoder_open(&par);
+    if (!e->h) {
+        fprintf(stderr, "[CAM] x264_encoder_open 실패 (%dx%d)\n", w, h);
+        return -1;
+    }
+    e->w = w; e->ht = h; e->gop = gop; e->kbps = kbps;
+    fprintf(stderr, "[CAM] x264 %dx%d gop=%d bitrate=%dkbps\n", w, h, gop, kbps);
+    return 0;
+}
+
+/**
+ * @brief BGR/GRAY Mat 한 장을 H.264 AU로 인코딩해 buffer에 씁니다.
+ * @param key 키프레임(IDR) 여부
+ * @return AU 길이, 버퍼 부족 시 -4, 실패 시 음수 (0은 출력 없음)
+ */
+static int h264_encode_mat(const cv::Mat& frame, unsigned char* buffer, int buf_size, int* key) {
+    h264_enc_t& e = g_h264;
+    std::lock_guard<std::mutex> lk(e.m);
+
+    /* 1. 파라미터 반영: 크기/GOP가 바뀌면 재오픈(자연히 IDR), 품질은 비트레이트 비율로 재설정 */
+    camera_jpeg_params_t jp = jpeg_params_now();
+    camera_h264_params_t hp = h264_params_now();
+    int kbps = (int)((int64_t)hp.bitrate_kbps * jp.quality / JPEG_QUALITY_DEFAULT);
+    if (kbps < 50) kbps = 50;
+
+    int w = frame.cols & ~1, h = frame.rows & ~1;
+    if (!e.h || w != e.w || h != e.ht || hp.gop != e.gop) {
+        if (h264_open(&e, w, h, hp.gop, kbps) != 0) return -3;
+    } else if (kbps != e.kbps) {
+        x264_param_t par;
+        x264_encoder_parameters(e.h, &par);
+        h264_fill_rc(&par, kbps);
+        if (x264_encoder_reconfig(e.h, &par) == 0) e.kbps = kbps;
+    }
+
+    /* 2. I420 변환 후 평면 포인터만 넘김 (x264_picture_alloc/복사 없음) */
+    cv::Mat bgr;
+    const cv::Mat* src = &frame;
+    if (frame.channels() == 1) { cv::cvtColor(frame, bgr, cv::COLOR_GRAY2BGR); src = &bgr; }
+    cv::Mat roi = (*src)(cv::Rect(0, 0, w, h));
+    cv::cvtColor(roi, e.yuv, cv::COLOR_BGR2YUV_I420);
+
+    x264_picture_t in, out;
+    x264_picture_init(&in);
+    in.img.i_csp       = X264_CSP_I420;
+    in.img.i_plane     = 3;
+    in.img.plane[0]    = e.yuv.data;
+    in.img.plane[1]    = e.yuv.data + (size_t)w * h;
+    in.img.plane[2]    = e.yuv.data + (size_t)w * h * 5 / 4;
+    in.img.i_stride[0] = w;
+    in.img.i_stride[1] = in.img.i_stride[2] = w / 2;
+    in.i_pts  = e.pts++;
+    in.i_type = g_h264_key_req.exchange(0) ? X264_TYPE_IDR : X264_TYPE_AUTO;
+
+    /* 3. 인코딩: NAL들은 연속 메모리에 놓이므로 첫 NAL부터 한 번에 복사 */
+    x264_nal_t* nals = nullptr;
+    int n_nal = 0;
+    int sz = x264_encoder_encode(e.h, &nals, &n_nal, &in, &out);
+    if (sz < 0) {
+        fprintf(stderr, "H.264 인코딩 실패\n");
+        return -3;
+    }
+    if (sz == 0) return 0;
+    if (sz > buf_size) {
+        g_h264_key_req.store(1);   /* 버린 AU를 참조하는 다음 프레임을 막기 위해 IDR 요청 */
+        return -4;
+    }
+
+    memcpy(buffer, nals[0].p_payload, (size_t)sz);
+    *key = out.b_keyframe ? 1 : 0;
+    return sz;
+}
+
+#endif /* HAVE_X264 */
+
+/**
+ * @brief 현재 코덱으로 Mat을 인코딩합니다. JPEG은 항상 키프레임입니다.
+ */
+static int codec_encode_mat(const cv::Mat& in, unsigned char* buffer, int buf_size, int* key) {
+    *key = 1;
+#ifdef HAVE_X264
+    if (g_codec.load(std::memory_order_relaxed) == CAM_CODEC_H264) {
+        /* 해상도 축소는 JPEG과 같은 규칙 (짝수 크기) */
+        camera_jpeg_params_t p = jpeg_params_now();
+        if (p.scale_pct < 100) {
+            int w = (in.cols * p.scale_pct / 100) & ~1;
+            int h = (in.rows * p.scale_pct / 100) & ~1;
+            if (w >= 16 && h >= 16) {
+                thread_local cv::Mat scaled;
+                cv::resize(in, scaled, cv::Size(w, h), 0, 0, cv::INTER_AREA);
+                return h264_encode_mat(scaled, buffer, buf_size, key);
+            }
+        }
+        return h264_encode_mat(in, buffer, buf_size, key);
+    }
+#endif
+    return jpeg_encode_mat(in, buffer, buf_size);
+}
+
+
+/* ============================================================
+ * [5] OpenCV 백엔드 (폴백)
+ * ============================================================ */
+
+static int opencv_open(camera_t* c, const char* dev) {
+    cv::VideoCapture* cap = new cv::VideoCapture(dev, cv::CAP_V4L2);
     if (!cap || !cap->isOpened()) {
-        fprintf(stderr, "카메라 열기 실패 (/dev/video1)\n");
+        fprintf(stderr, "카메라 열기 실패 (OpenCV, %s)\n", dev);
         delete cap;
-        return nullptr;
+        return -1;
     }
 
     // MJPEG 모드 설정
     cap->set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('M','J','P','G'));
-    cap->set(cv::CAP_PROP_FRAME_WIDTH, 1280);
-    cap->set(cv::CAP_PROP_FRAME_HEIGHT, 720);
-    cap->set(cv::CAP_PROP_FPS, 30);
+    cap->set(cv::CAP_PROP_FRAME_WIDTH, CAM_WIDTH);
+    cap->set(cv::CAP_PROP_FRAME_HEIGHT, CAM_HEIGHT);
+    cap->set(cv::CAP_PROP_FPS, CAM_FPS);
 
-    return static_cast<camera_handle_t>(cap);
+    c->cap = cap;
+    return 0;
+}
+
+static void opencv_close(camera_t* c) {
+    if (!c->cap) return;
+    c->cap->release();
+    delete c->cap;
+    c->cap = nullptr;
+}
+
+static int opencv_capture(camera_t* c, unsigned char* buffer, int buf_size) {
+    cv::Mat frame;
+    if (!c->cap->read(frame)) {
+        fprintf(stderr, "프레임 캡처 실패\n");
+        return -2;
+    }
+    return jpeg_encode_mat(frame, buffer, buf_size);
+}
+
+static int opencv_grab_raw(camera_t* c, camera_frame_t* f) {
+    if (!f->raw) f->raw = new cv::Mat();
+    if (!c->cap->read(*static_cast<cv::Mat*>(f->raw))) {
+        fprintf(stderr, "프레임 캡처 실패\n");
+        return -2;
+    }
+    return 0;
+}
+
+
+/* ============================================================
+ * [6] 합성 소스 (Synthetic)
+ * ============================================================ */
+
+static uint64_t mono_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief 다음 송출 시각까지 잠든 뒤 다음 시각을 gap_ns만큼 미룹니다.
+ * 1초 이상 밀렸으면(소비자가 느림) 현재 시각으로 다시 맞춥니다.
+ */
+static void pace_wait(camera_t* c, uint64_t gap_ns) {
+    uint64_t now = mono_ns();
+    if (c->next_ns == 0 || now > c->next_ns + 1000000000ULL) {
+        c->next_ns = now;
+    } else if (c->next_ns > now) {
+        struct timespec ts;
+        ts.tv_sec  = (time_t)(c->next_ns / 1000000000ULL);
+        ts.tv_nsec = (long)(c->next_ns % 1000000000ULL);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+    }
+    c->next_ns += gap_ns;
+}
+
+/* 8x8 회색 1블록짜리 baseline JPEG 조각들 (DHT는 k_std_dht 재사용) */
+static const unsigned char k_syn_head[] = {
+    0xff, 0xd8,                                           /* SOI */
+    0xff, 0xdb, 0x00, 0x43, 0x00,                         /* DQT (64개 모두 1) */
+    1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,
+    0xff, 0xc0, 0x00, 0x0b, 0x08, 0x00, 0x08, 0x00, 0x08, 0x01, 0x01, 0x11, 0x00,   /* SOF0 8x8 gray */
+};
+static const unsigned char k_syn_tail[] = {
+    0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x3f, 0x00,   /* SOS */
+    0x2b,                                                         /* DC=0, EOB */
+    0xff, 0xd9                                                    /* EOI */
+};
+
+/**
+ * @brief 정확히 want 바이트인 유효 JPEG을 만듭니다. 남는 공간은 COM 세그먼트로 채웁니다.
+ * 첫 COM에는 프레임 번호를 기록해 수신측에서 순서/유실을 확인할 수 있습니다.
+ */
+static int syn_build(unsigned char* out, int cap, size_t want, uint64_t seq) {
+    const size_t fixed = sizeof(k_syn_head) + sizeof(k_std_dht) + sizeof(k_syn_tail);
+    if (want < fixed + 4 + 16) want = fixed + 4 + 16;
+    if (want > (size_t)cap) {
+        fprintf(stderr, "버퍼 크기 부족: 필요 %zu, 제공 %d\n", want, cap);
+        return -4;
+    }
+
+    size_t o = 0;
+    memcpy(out + o, k_syn_head, sizeof(k_syn_head)); o += sizeof(k_syn_head);
+    memcpy(out + o, k_std_dht, sizeof(k_std_dht));   o += sizeof(k_std_dht);
+
+    size_t pad = want - fixed;
+    int first = 1;
+    while (pad > 0) {
+        /* COM 1개 = 마커(2) + 길이(2) + 데이터(최대 65533) */
+        size_t data = pad - 4;
+        if (data > 65533) data = 65533;
+        if (pad - (data + 4) > 0 && pad - (data + 4) < 4) data -= 4;  /* 마지막 COM이 4B 미만이 되지 않게 */
+
+        out[o++] = 0xff; out[o++] = 0xfe;
+        out[o++] = (unsigned char)((data + 2) >> 8);
+        out[o++] = (unsigned char)((data + 2) & 0xff);
+        memset(out + o, 0, data);
+        if (first) { snprintf((char*)out + o, data, "syn seq=%016llu", (unsigned long long)seq); first = 0; }
+        o += data;
+        pad -= data + 4;
+    }
+
+    memcpy(out + o, k_syn_tail, sizeof(k_syn_tail)); o += sizeof(k_syn_tail);
+    return (int)o;
+}
+
+static int syn_capture(camera_t* c, unsigned char* buffer, int buf_size) {
+    pace_wait(c, c->period_ns);
+
+    size_t want = c->syn_size;
+    if (c->syn_jitter > 0) {
+        int r = (int)(rand_r(&c->syn_seed) % (unsigned)(2 * c->syn_jitter + 1)) - c->syn_jitter;
+        want = (size_t)((double)want * (100.0 + r) / 100.0);
+    }
+    return syn_build(buffer, buf_size, want, c->syn_seq++);
+}
+
+static void syn_close(camera_t* c) { (void)c; }
+
+
+/* ============================================================
+ * [7] 재생 소스 (Replay: frame_*.jpg 디렉토리 / 서버 .seg 파일)
+ * ============================================================ */
+
+static int replay_open_dir(camera_t* c, const char* dir) {
+    DIR* d = opendir(dir);
+    if (!d) return -1;
+
+    std::vector<std::string> names;
+    for (struct dirent* e; (e = readdir(d)) != NULL; ) {
+        size_t n = strlen(e->d_name);
+        if (strncmp(e->d_name, "frame_", 6) == 0 && n > 4 && strcmp(e->d_name + n - 4, ".jpg") == 0) {
+            names.push_back(e->d_name);
+        }
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());   /* frame_%06 형식이므로 이름순 = 기록순 */
+
+    for (const std::string& n : names) {
+        std::string path = std::string(dir) + "/" + n;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) continue;
+        c->rp_files.push_back(path);
+        c->rp_ts_us.push_back((uint64_t)st.st_mtim.tv_sec * 1000000ULL + (uint64_t)st.st_mtim.tv_nsec / 1000ULL);
+    }
+    return c->rp_files.empty() ? -1 : 0;
+}
+
+/**
+ * @brief 디렉토리의 다음 파일을 읽습니다. 간격은 파일 mtime 차이(기록 시각)를 따릅니다.
+ */
+static int replay_dir_next(camera_t* c, unsigned char* buffer, int buf_size) {
+    if (c->rp_pos >= c->rp_files.size()) {
+        if (!c->rp_loop) { usleep(100000); return -5; }
+        c->rp_pos = 0;
+    }
+    size_t i = c->rp_pos++;
+
+    uint64_t gap_ns = c->period_ns;
+    if (!gap_ns && i + 1 < c->rp_ts_us.size()) {
+        uint64_t a = c->rp_ts_us[i], b = c->rp_ts_us[i + 1];
+        uint64_t d = (b > a) ? b - a : 0;
+        if (d > REPLAY_GAP_MAX_US) d = REPLAY_GAP_MAX_US;
+        gap_ns = d * 1000ULL;
+    }
+    pace_wait(c, gap_ns);
+
+    FILE* f = fopen(c->rp_files[i].c_str(), "rb");
+    if (!f) return -2;
+    size_t n = fread(buffer, 1, (size_t)buf_size, f);
+    int more = fgetc(f) != EOF;
+    fclose(f);
+
+    if (more) {
+        fprintf(stderr, "버퍼 크기 부족: %s\n", c->rp_files[i].c_str());
+        return -4;
+    }
+    return (int)n;
+}
+
+/**
+ * @brief .seg 레코드([u32 BE 길이][본문])를 하나 읽습니다.
+ * .seg에는 시각 정보가 없으므로 fps 간격으로 송출합니다. 길이 0(선할당 영역)이나 EOF는 끝으로 봅니다.
+ */
+static int replay_seg_next(camera_t* c, unsigned char* buffer, int buf_size) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        unsigned char h[4];
+        if (fread(h, 1, 4, c->rp_seg) == 4) {
+            uint32_t len = ((uint32_t)h[0] << 24) | ((uint32_t)h[1] << 16) | ((uint32_t)h[2] << 8) | h[3];
+            if (len > 0) {
+                pace_wait(c, c->period_ns);
+                if (len > (uint32_t)buf_size) {
+                    fprintf(stderr, "버퍼 크기 부족: 필요 %u, 제공 %d\n", len, buf_size);
+                    fseek(c->rp_seg, (long)len, SEEK_CUR);
+                    return -4;
+                }
+                if (fread(buffer, 1, len, c->rp_seg) != len) return -2;
+                return (int)len;
+            }
+        }
+        if (!c->rp_loop) break;
+        rewind(c->rp_seg);
+    }
+    usleep(100000);
+    return -5;
+}
+
+static int replay_capture(camera_t* c, unsigned char* buffer, int buf_size) {
+    return c->rp_seg ? replay_seg_next(c, buffer, buf_size) : replay_dir_next(c, buffer, buf_size);
+}
+
+static void replay_close(camera_t* c) {
+    if (c->rp_seg) fclose(c->rp_seg);
+    c->rp_seg = NULL;
+}
+
+
+/* ============================================================
+ * [8] 소스 선택 및 공개 API
+ * ============================================================ */
+
+static const cam_source_ops_t k_ops_v4l2      = { "v4l2-mjpeg", v4l2_capture,   v4l2_close,   NULL };
+static const cam_source_ops_t k_ops_opencv    = { "opencv",     opencv_capture, opencv_close, opencv_grab_raw };
+static const cam_source_ops_t k_ops_synthetic = { "synthetic",  syn_capture,    syn_close,    NULL };
+static const cam_source_ops_t k_ops_replay    = { "replay",     replay_capture, replay_close, NULL };
+
+
+/**
+ * @brief 소스 지정 문자열에서 key=값을 찾습니다. (예: "synthetic,size=80000,fps=30")
+ */
+static std::string spec_get(const char* spec, const char* key, const char* def) {
+    const char* p = strchr(spec, ',');
+    size_t kl = strlen(key);
+    while (p) {
+        p++;
+        const char* end = strchr(p, ',');
+        size_t n = end ? (size_t)(end - p) : strlen(p);
+        if (n > kl && strncmp(p, key, kl) == 0 && p[kl] == '=') return std::string(p + kl + 1, n - kl - 1);
+        p = end;
+    }
+    return def;
+}
+
+static uint64_t fps_to_period_ns(double fps) {
+    return fps > 0 ? (uint64_t)(1e9 / fps) : 0;
+}
+
+/**
+ * @brief "종류[:인자][,키=값...]" 형식을 해석해 소스를 엽니다.
+ */
+static int source_open(camera_t* c, const char* spec) {
+    std::string s = spec;
+    std::string head = s.substr(0, s.find(','));
+    size_t colon = head.find(':');
+    std::string type = head.substr(0, colon);
+    std::string arg  = (colon == std::string::npos) ? "" : head.substr(colon + 1);
+
+    if (type == "camera" || type == "v4l2" || type == "opencv") {
+        const char* dev = getenv("CAM_DEVICE");
+        if (!arg.empty()) dev = arg.c_str();
+        if (!dev || !*dev) dev = "/dev/video0";
+
+        if (type != "opencv") {
+            if (v4l2_open(c, dev) == 0) {
+                c->ops = &k_ops_v4l2;
+                return 0;
+            }
+            if (type == "v4l2") return -1;
+            fprintf(stderr, "[CAM] V4L2 실패 → OpenCV 폴백\n");
+        }
+        if (opencv_open(c, dev) != 0) return -1;
+        c->ops = &k_ops_opencv;
+        return 0;
+    }
+
+    if (type == "synthetic") {
+        c->syn_size   = (size_t)strtoull(spec_get(spec, "size", "0").c_str(), NULL, 10);
+        c->syn_jitter = atoi(spec_get(spec, "jitter", "0").c_str());
+        c->syn_seed   = (unsigned)strtoul(spec_get(spec, "seed", "1").c_str(), NULL, 10);
+        c->period_ns  = fps_to_period_ns(atof(spec_get(spec, "fps", "30").c_str()));
+        if (c->syn_size == 0) c->syn_size = SYN_SIZE_DEFAULT;
+        if (c->syn_jitter < 0) c->syn_jitter = 0;
+        if (c->syn_jitter > 99) c->syn_jitter = 99;
+
+        c->ops = &k_ops_synthetic;
+        fprintf(stderr, "[CAM] synthetic size=%zu jitter=±%d%% period=%lluns\n",
+                c->syn_size, c->syn_jitter, (unsigned long long)c->period_ns);
+        return 0;
+    }
+
+    if (type == "replay") {
+        struct stat st;
+        if (arg.empty() || stat(arg.c_str(), &st) != 0) {
+            fprintf(stderr, "[CAM] replay 경로 없음: %s\n", arg.c_str());
+            return -1;
+        }
+        c->rp_loop = atoi(spec_get(spec, "loop", "1").c_str());
+        std::string fps = spec_get(spec, "fps", "");
+
+        if (S_ISDIR(st.st_mode)) {
+            if (replay_open_dir(c, arg.c_str()) != 0) {
+                fprintf(stderr, "[CAM] replay: frame_*.jpg 없음 (%s)\n", arg.c_str());
+                return -1;
+            }
+            c->period_ns = fps.empty() ? 0 : fps_to_period_ns(atof(fps.c_str()));
+        } else {
+            c->rp_seg = fopen(arg.c_str(), "rb");
+            if (!c->rp_seg) return -1;
+            c->period_ns = fps_to_period_ns(atof(fps.empty() ? "30" : fps.c_str()));
+        }
+
+        c->ops = &k_ops_replay;
+        if (c->rp_seg) fprintf(stderr, "[CAM] replay seg %s (loop=%d)\n", arg.c_str(), c->rp_loop);
+        else           fprintf(stderr, "[CAM] replay dir %s (frames=%zu, loop=%d)\n", arg.c_str(), c->rp_files.size(), c->rp_loop);
+        return 0;
+    }
+
+    fprintf(stderr, "[CAM] 알 수 없는 소스: %s\n", spec);
+    return -1;
+}
+
+
+extern "C" {
+
+/**
+ * @brief 지정한 프레임 소스를 열고 핸들을 반환합니다.
+ *        spec이 NULL이면 CAM_BACKEND 환경 변수(기본 camera)를 사용합니다.
+ */
+camera_handle_t camera_open(const char* spec) {
+    if (!spec || !*spec) {
+        const char* be = getenv("CAM_BACKEND");
+        spec = (be && !strcmp(be, "v4l2"))   ? "v4l2"
+             : (be && !strcmp(be, "opencv")) ? "opencv"
+             : "camera";
+    }
+
+    camera_t* c = new camera_t();
+    c->fd = -1;
+
+    if (source_open(c, spec) != 0) {
+        delete c;   /* 실패한 소스는 스스로 자원을 정리함 */
+        return nullptr;
+    }
+    return static_cast<camera_handle_t>(c);
+}
+
+/**
+ * @brief 새로운 카메라 객체를 생성하고 그 핸들을 반환합니다.
+ *        기본은 네이티브 V4L2(MJPEG 직송)이며, 실패하면 OpenCV로 폴백합니다.
+ *        환경 변수: CAM_DEVICE (기본 /dev/video0), CAM_BACKEND (auto|v4l2|opencv)
+ */
+camera_handle_t camera_create() {
+    return camera_open(NULL);
 }
 
 /**
@@ -31,44 +1133,155 @@ camera_handle_t camera_create() {
  */
 void camera_destroy(camera_handle_t handle) {
     if (!handle) return;
-    cv::VideoCapture* cap = static_cast<cv::VideoCapture*>(handle);
-    cap->release();
-    delete cap;
+    camera_t* c = static_cast<camera_t*>(handle);
+
+    c->ops->close(c);
+    delete c;
 }
 
 /**
- * @brief 특정 카메라에서 프레임을 캡처하여 JPEG 데이터로 반환 (MJPEG 직송)
+ * @brief 소스에서 다음 프레임을 JPEG 데이터로 가져옵니다.
+ *        (V4L2: MJPEG 직송, OpenCV: 재인코딩, 합성/재생: 지정 간격으로 송출)
  */
 int camera_capture_jpeg(camera_handle_t handle, unsigned char* buffer, int buf_size) {
     if (!handle) {
         fprintf(stderr, "유효하지 않은 카메라 핸들입니다.\n");
         return -1;
     }
-    cv::VideoCapture* cap = static_cast<cv::VideoCapture*>(handle);
+    camera_t* c = static_cast<camera_t*>(handle);
+    return c->ops->capture(c, buffer, buf_size);
+}
 
-    cv::Mat frame;
-    if (!cap->read(frame)) {
-        fprintf(stderr, "프레임 캡처 실패\n");
-        return -2;
-    }
+static int frame_reserve(camera_frame_t* f, size_t need) {
+    if (f->cap >= need) return 0;
+    unsigned char* tmp = (unsigned char*)realloc(f->buf, need);
+    if (!tmp) return -1;
+    f->buf = tmp;
+    f->cap = need;
+    return 0;
+}
 
-    // 이미 MJPEG 포맷이므로 imencode 불필요 → OpenCV Mat에서 raw 데이터 추출 불가
-    // 대신 MJPEG 캡처 모드에서는 read()로 받은 Mat을 다시 인코딩해야 하는 경우가 있음
-    // 여기서는 안전하게 재인코딩 (부하 적음)
-    static std::vector<uchar> jpg_buf;
-    jpg_buf.clear();
-    if (!cv::imencode(".jpg", frame, jpg_buf)) {
-        fprintf(stderr, "JPEG 인코딩 실패\n");
-        return -3;
-    }
+/**
+ * @brief 다음 프레임을 가져옵니다. (압축 소스: buf 채움, OpenCV: raw만 채움)
+ */
+int camera_grab(camera_handle_t handle, camera_frame_t* f) {
+    if (!handle || !f) return -1;
+    camera_t* c = static_cast<camera_t*>(handle);
+    f->len = 0;
+    f->ok  = 0;
+    f->key = 1;
 
-    if ((int)jpg_buf.size() > buf_size) {
-        fprintf(stderr, "버퍼 크기 부족: 필요 %zu, 제공 %d\n", jpg_buf.size(), buf_size);
-        return -4;
+    if (c->ops->grab_raw) return c->ops->grab_raw(c, f);
+
+    if (frame_reserve(f, CAM_FRAME_CAP) != 0) return -4;
+    int n = c->ops->capture(c, f->buf, (int)f->cap);
+    if (n <= 0) return n ? n : -2;
+    f->len = (size_t)n;
+    f->ok  = 1;
+    return 0;
+}
+
+/**
+ * @brief raw 프레임을 현재 코덱(JPEG/H.264)으로 인코딩합니다. (이미 압축된 프레임은 그대로 반환)
+ */
+int camera_encode(camera_frame_t* f) {
+    if (!f) return -1;
+    if (f->ok) return (int)f->len;
+    if (!f->raw) return -1;
+
+    if (frame_reserve(f, CAM_FRAME_CAP) != 0) return -4;
+    const cv::Mat& m = *static_cast<cv::Mat*>(f->raw);
+    int key = 1;
+    int n = codec_encode_mat(m, f->buf, (int)f->cap, &key);
+    if (n == -4 && frame_reserve(f, jpeg_encode_bound(m)) == 0) {
+        n = codec_encode_mat(m, f->buf, (int)f->cap, &key);   /* 기본 용량을 넘는 프레임: 최악 크기로 늘려 한 번 더 */
     }
+    if (n <= 0) return n;
+    f->len = (size_t)n;
+    f->key = key;
+    f->ok  = 1;
+    return n;
+}
 
-    memcpy(buffer, jpg_buf.data(), jpg_buf.size());
-    return static_cast<int>(jpg_buf.size());
+void camera_frame_release(camera_frame_t* f) {
+    if (!f) return;
+    free(f->buf);
+    delete static_cast<cv::Mat*>(f->raw);
+    f->buf = NULL;
+    f->raw = NULL;
+    f->cap = f->len = 0;
+}
+
+int camera_needs_encode(camera_handle_t handle) {
+    if (!handle) return 0;
+    return static_cast<camera_t*>(handle)->ops->grab_raw != NULL;
+}
+
+void camera_set_jpeg_params(const camera_jpeg_params_t* p) {
+    if (!p) return;
+    std::call_once(g_jpeg_once, jpeg_env_init);
+    camera_jpeg_params_t v = *p;
+    jpeg_params_clamp(&v);
+    g_jpeg_packed.store(jpeg_pack(&v));
+}
+
+void camera_get_jpeg_params(camera_jpeg_params_t* p) {
+    if (p) *p = jpeg_params_now();
+}
+
+int camera_set_encoder(const char* name) {
+    std::call_once(g_jpeg_once, jpeg_env_init);
+    if (!name) return -1;
+    if (!strcmp(name, "opencv")) { g_encoder.store(ENC_OPENCV); return 0; }
+#ifdef HAVE_LIBJPEG_TURBO
+    if (!strcmp(name, "libjpeg") || !strcmp(name, "libjpeg-turbo")) { g_encoder.store(ENC_LIBJPEG); return 0; }
+#endif
+    return -1;
+}
+
+const char* camera_encoder_name(void) {
+    std::call_once(g_jpeg_once, jpeg_env_init);
+    if (g_codec.load() == CAM_CODEC_H264) return "x264";
+    return g_encoder.load() == ENC_LIBJPEG ? "libjpeg-turbo" : "opencv";
+}
+
+int camera_set_codec(const char* name) {
+    std::call_once(g_jpeg_once, jpeg_env_init);
+    if (!name) return -1;
+    if (!strcmp(name, "jpeg")) { g_codec.store(CAM_CODEC_JPEG); return 0; }
+#ifdef HAVE_X264
+    if (!strcmp(name, "h264")) { g_codec.store(CAM_CODEC_H264); g_h264_key_req.store(1); return 0; }
+#endif
+    return -1;
+}
+
+int camera_codec(void) {
+    std::call_once(g_jpeg_once, jpeg_env_init);
+    return g_codec.load();
+}
+
+void camera_set_h264_params(const camera_h264_params_t* p) {
+    if (!p) return;
+    camera_h264_params_t cur = h264_params_now();
+    uint64_t gop  = (uint64_t)(p->gop > 0 ? p->gop : cur.gop);
+    uint64_t kbps = (uint64_t)(p->bitrate_kbps > 0 ? p->bitrate_kbps : cur.bitrate_kbps);
+    g_h264_packed.store(gop | (kbps << 32));
+}
+
+void camera_get_h264_params(camera_h264_params_t* p) {
+    if (p) *p = h264_params_now();
+}
+
+void camera_request_keyframe(void) {
+    g_h264_key_req.store(1);
+}
+
+/**
+ * @brief 사용 중인 프레임 소스 이름을 반환합니다. (로그용)
+ */
+const char* camera_backend_name(camera_handle_t handle) {
+    if (!handle) return "none";
+    return static_cast<camera_t*>(handle)->ops->name;
 }
 
 } // extern "C"
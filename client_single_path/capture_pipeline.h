@@ -0,0 +1,165 @@
+#ifndef CAPTURE_PIPELINE_H
+#define CAPTURE_PIPELINE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "camera.h"
+
+/* ============================================================
+ * [1] 파이프라인 설정
+ * ============================================================ */
+
+/*
+ *  capture ──raw_q──▶ encode worker × N ──enc_q──▶ sequencer ──cam_mb──▶ loop_cb (network)
+ *     ▲                                                │
+ *     └───────────────────── free_q ◀──────────────────┘
+ *
+ * 프레임 객체는 PIPE_FRAMES개를 돌려 쓰며, 모든 큐는 고정 크기 lock-free 링입니다.
+ * 인코더는 프레임 단위로 병렬 처리하고, sequencer가 순번대로 재정렬해 우편함에 발행합니다.
+ */
+
+#define PIPE_FRAMES      8    /* 순환 프레임 수 (큐 크기와 같은 2의 거듭제곱) */
+#define PIPE_ENC_MAX     8    /* 인코딩 워커 최대 수 */
+#define PIPE_LOG_US      1000000ULL
+
+/* ============================================================
+ * [2] Bounded MPMC lock-free 큐 (프레임 포인터 전달용)
+ * ============================================================ */
+
+typedef struct {
+    _Atomic size_t seq;
+    void* data;
+} pq_cell_t;
+
+typedef struct {
+    pq_cell_t cells[PIPE_FRAMES];
+    _Atomic size_t head;      /* 다음 push 위치 */
+    _Atomic size_t tail;      /* 다음 pop 위치 */
+} pipe_q_t;
+
+static inline void pq_init(pipe_q_t* q){
+    for (size_t i = 0; i < PIPE_FRAMES; i++) {
+        atomic_init(&q->cells[i].seq, i);
+        q->cells[i].data = NULL;
+    }
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+}
+
+/**
+ * @brief 큐에 넣습니다. 가득 찼으면 -1 (대기하지 않음)
+ */
+static inline int pq_push(pipe_q_t* q, void* v){
+    size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+    for (;;) {
+        pq_cell_t* c = &q->cells[pos & (PIPE_FRAMES - 1)];
+        size_t seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                c->data = v;
+                atomic_store_explicit(&c->seq, pos + 1, memory_order_release);
+                return 0;
+            }
+        } else if (dif < 0) {
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief 큐에서 꺼냅니다. 비었으면 NULL (대기하지 않음)
+ */
+static inline void* pq_pop(pipe_q_t* q){
+    size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    for (;;) {
+        pq_cell_t* c = &q->cells[pos & (PIPE_FRAMES - 1)];
+        size_t seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                void* v = c->data;
+                atomic_store_explicit(&c->seq, pos + PIPE_FRAMES, memory_order_release);
+                return v;
+            }
+        } else if (dif < 0) {
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        }
+    }
+}
+
+static inline size_t pq_depth(pipe_q_t* q){
+    size_t h = atomic_load_explicit(&q->head, memory_order_relaxed);
+    size_t t = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    return h - t;
+}
+
+/**
+ * @brief 큐가 비었을 때의 대기: 잠깐 양보하다가 점점 길게 잠듭니다. (최대 1ms)
+ */
+static inline void pipe_idle(unsigned* spins){
+    if (*spins < 16)       sched_yield();
+    else if (*spins < 64)  usleep(50);
+    else                   usleep(1000);
+    (*spins)++;
+}
+
+
+/* ============================================================
+ * [3] 단계별 계측 및 파이프라인 상태
+ * ============================================================ */
+
+/**
+ * @brief 단계별 누적 통계 (여러 스레드가 갱신하므로 atomic)
+ */
+typedef struct {
+    _Atomic uint64_t cap_frames, cap_us, cap_drops;   /* 캡처: 처리 수 / 소요 시간 / 빈 프레임 없어 버린 수 */
+    _Atomic uint64_t enc_frames, enc_us, enc_fail;    /* 인코딩 */
+    _Atomic uint64_t seq_frames, seq_wait_us;         /* 재정렬: 인코딩 완료 → 발행 대기 */
+    _Atomic uint64_t net_frames, net_lat_us;          /* 네트워크: 캡처 → 전송 지연 (종단) */
+} pipe_stats_t;
+
+typedef struct {
+    camera_frame_t  frames[PIPE_FRAMES];
+    pipe_q_t        free_q, raw_q, enc_q;
+
+    int             n_enc;                  /* 인코딩 워커 수 (0이면 자동) */
+    pthread_t       enc_th[PIPE_ENC_MAX];
+    pthread_t       seq_th;
+    volatile int    stop;
+
+    pipe_stats_t    stats;
+} cam_pipe_t;
+
+static inline uint64_t pipe_now_us(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static inline void pipe_add(_Atomic uint64_t* a, uint64_t v){
+    atomic_fetch_add_explicit(a, v, memory_order_relaxed);
+}
+
+/**
+ * @brief 네트워크 단계: 프레임 전송 시점에 호출해 캡처→전송 지연을 기록합니다.
+ */
+static inline void pipe_note_sent(cam_pipe_t* p, uint64_t t_cap_us){
+    if (!t_cap_us) return;
+    pipe_add(&p->stats.net_frames, 1);
+    pipe_add(&p->stats.net_lat_us, pipe_now_us() - t_cap_us);
+}
+
+#endif /* CAPTURE_PIPELINE_H */
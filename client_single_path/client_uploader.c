@@ -5,6 +5,7 @@
 #include "quic_helpers.h"
 #include "path_algo.h"
 #include "camera_task.h"
+#include "abr.h"
 
 /* ============================================================
  * [1] 연결 상태 및 콜백 이벤트 처리
@@ -33,8 +34,10 @@ static void on_cb_event(picoquic_call_back_event_t ev, tx_t* st, picoquic_cnx_t*
 static int client_cb(picoquic_cnx_t* cnx, uint64_t stream_id, uint8_t* bytes, size_t length,
                     picoquic_call_back_event_t ev, void* ctx, void* stream_ctx)
 {
-    (void)stream_id; (void)bytes; (void)length; (void)stream_ctx;
     tx_t* st = (tx_t*)ctx;
+    /* JIT 송신: picoquic이 패킷을 만들 때 active 스트림 데이터를 요청 */
+    if (st && ev == picoquic_callback_prepare_to_send)
+        return jit_prepare_to_send(cnx, st, stream_id, bytes, length, stream_ctx);
     if (st) on_cb_event(ev, st, cnx);
     return 0;
 }
@@ -77,49 +80,64 @@ static int loop_cb(picoquic_quic_t* quic, picoquic_packet_loop_cb_enum cb_mode,
         st->last_keepalive_us = now;
     }
 
-    /* 3. 카메라 프레임 수집 */
-    int cam_len = 0;
-    uint64_t cam_seq = 0;
+    /* 전달 기한이 지난 프레임은 재전송하지 않고 버림 (프레임별 스트림은 reset) */
+    jit_expire(c, st);
 
-    pthread_mutex_lock(&st->cam_mtx);
-    cam_len = st->cam_len;
-    cam_seq = st->cam_seq;
+    /* 3. 카메라 프레임 수집 (lock-free 우편함, 복사 없음) */
+    const mb_slot_t* fr = mb_acquire(&st->cam_mb);
 
-    if (cam_seq == st->last_sent_seq || cam_len <= 0) {
-        pthread_mutex_unlock(&st->cam_mtx);
+    if (!fr || fr->len == 0) {
         picoquic_set_app_wake_time(c, now + 5000);
         return 0;
     }
 
-    if (st->cap_cap < (size_t)cam_len) {
-        uint8_t* tmp = realloc(st->cap_buf, cam_len);
-        if (!tmp) { pthread_mutex_unlock(&st->cam_mtx); return 0; }
-        st->cap_buf = tmp;
-        st->cap_cap = cam_len;
-    }
-
-    memcpy(st->cap_buf, st->cam_buf, cam_len);
-    st->last_sent_seq = cam_seq;
-    pthread_mutex_unlock(&st->cam_mtx);
+    int cam_len = (int)fr->len;
+    st->last_sent_seq = fr->seq;
 
-    size_t hlen = varint_enc(cam_len, st->lenb);
+    /* H.264: 참조가 끊긴 AU는 다음 IDR까지 보내지 않음 (JPEG은 항상 통과) */
+    if (!au_gate(st, fr)) {
+        picoquic_set_app_wake_time(c, now + 5000);
+        return 0;
+    }
 
     /* 4. 데이터 전송 (항상 0번 경로 사용) */
     int sent_ok = -1;
     const int target_idx = 0; // k와 cc 대신 고정된 인덱스 사용
 
-    if (path_sane_for_send(c, target_idx)) {
-        int sr = send_on_path_safe(c, st, target_idx, st->lenb, hlen, st->cap_buf, cam_len);
+    /* ABR: 0번 경로 용량으로 품질/해상도/프레임률 단계 조정, 프레임률 제한에 걸리면 건너뜀 */
+    if (c->nb_paths > 0 && !abr_on_frame(&st->abr, c->path[target_idx], target_idx, (size_t)cam_len, now)) {
+        picoquic_set_app_wake_time(c, now + 5000);
+        return 0;
+    }
+
+    /* 송신 큐 허용: 0번 경로 스트림에 이미 예산 이상 밀려 있으면 새 프레임을 쌓지 않고 건너뜀 (다음 차례엔 최신 프레임) */
+    if (!admit_frame(&st->admit, c, st->sid_per_path[target_idx], target_idx, jit_ahead_bytes(st, target_idx), (size_t)cam_len, now)) {
+        picoquic_set_app_wake_time(c, now + 5000);
+        return 0;
+    }
+
+    /* 우편함 슬롯 버퍼를 복사 없이 넘겨받아 0번 경로 스트림에 대기 (prepare_to_send에서 직렬화) */
+    tx_frame_t* tf = txf_take(st, fr);
+    if (!tf) {
+        picoquic_set_app_wake_time(c, now + 5000);
+        return 0;
+    }
+    if (path_sane_for_send(c, st, target_idx)) {
+        int sr = send_frame_jit(c, st, target_idx, tf);
         if (sr == 0) {
             sent_ok = 0;
         }
     }
+    txf_release(tf);
 
     if (sent_ok != 0) {
         picoquic_set_app_wake_time(c, now + 20000);
         return 0;
     }
 
+    /* 캡처 → 전송 지연은 jit_prepare_to_send에서 마지막 바이트를 직렬화할 때 계측 */
+    st->au_last_seq = fr->seq;
+
     /* 5. 네트워크 모니터링 로그 (Single-Path용) */
     static uint64_t last_log_us = 0;
     static size_t bytes_accum = 0;
@@ -127,7 +145,11 @@ static int loop_cb(picoquic_quic_t* quic, picoquic_packet_loop_cb_enum cb_mode,
 
     if (now - last_log_us > ONE_SEC_US) {
         double mbps = (bytes_accum * 8.0) / 1e6;
-        LOGF("[MON] Single-Path[0] Total: %.2f Mb/s", mbps);
+        LOGF("[MON] Single-Path[0] Total: %.2f Mb/s cam_overwritten=%" PRIu64, mbps, mb_overwritten(&st->cam_mb));
+        if (st->abr.target_ms > 0) {
+            LOGF("[MON] abr level=%d pred=%.0fms cap=%.2fMbps skipped=%" PRIu64,
+                 st->abr.level, st->abr.pred_ms, st->abr.cap_Bps * 8 / 1e6, st->abr.skipped);
+        }
         bytes_accum = 0;
         last_log_us = now;
     }
@@ -142,10 +164,35 @@ int main(int argc, char** argv){
     int port = 4433;
     int sock_port = 55002;
 
-    if (argc > 1) server_ip = argv[1];
-    if (argc > 2) local_ip  = argv[2];
-    if (argc > 3) port      = atoi(argv[3]);
-    if (argc > 4) sock_port = atoi(argv[4]);
+    /* --옵션은 먼저 분리하고, 나머지는 기존 위치 인자로 해석 */
+    const char* source = NULL;    /* 프레임 소스 (NULL: 카메라) */
+    int enc_workers = 0;          /* 인코딩 워커 수 (0: 자동) */
+    double abr_target_ms = ABR_TARGET_MS_DEFAULT;   /* 프레임 전달 목표 시간 (0: ABR 끔) */
+    double queue_budget_ms = ADMIT_BUDGET_MS_DEFAULT;   /* 송신 큐 대기 허용 시간 (0: 끔) */
+    const char* codec = NULL;     /* jpeg | h264 (NULL: CAM_CODEC 환경 변수) */
+    int gop = 0;                  /* H.264 키프레임 간격 (0: 기본 60) */
+    int bitrate_kbps = 0;         /* H.264 목표 비트레이트 (0: 기본 2000) */
+    const char* stream_mode = "path";   /* path: 경로별 장수 스트림 | frame: 프레임별 스트림 + FIN */
+    double deadline_ms = FRAME_DEADLINE_MS_DEFAULT;   /* 프레임 전달 기한 (0: 끔) */
+    char* pos[8];
+    int npos = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--source") && i + 1 < argc) source = argv[++i];
+        else if (!strcmp(argv[i], "--enc-workers") && i + 1 < argc) enc_workers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--abr-target-ms") && i + 1 < argc) abr_target_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--queue-budget-ms") && i + 1 < argc) queue_budget_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--codec") && i + 1 < argc) codec = argv[++i];
+        else if (!strcmp(argv[i], "--gop") && i + 1 < argc) gop = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bitrate") && i + 1 < argc) bitrate_kbps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--stream-mode") && i + 1 < argc) stream_mode = argv[++i];
+        else if (!strcmp(argv[i], "--frame-deadline-ms") && i + 1 < argc) deadline_ms = atof(argv[++i]);
+        else if (npos < 8) pos[npos++] = argv[i];
+    }
+
+    if (npos > 0) server_ip = pos[0];
+    if (npos > 1) local_ip  = pos[1];
+    if (npos > 2) port      = atoi(pos[2]);
+    if (npos > 3) sock_port = atoi(pos[3]);
 
     picoquic_quic_t* q = picoquic_create(32, NULL, NULL, NULL, "hq", NULL, NULL, NULL, NULL, NULL,
                                         picoquic_current_time(), NULL, NULL, NULL, 1);
@@ -165,12 +212,19 @@ int main(int argc, char** argv){
     tx_t st;
     memset(&st, 0, sizeof(st));
     st.cnx = cnx;
-    pthread_mutex_init(&st.cam_mtx, NULL);
+    mb_init(&st.cam_mb);
+    st.pipe.n_enc = enc_workers;
 
     picoquic_set_callback(cnx, client_cb, &st);
     picoquic_start_client_cnx(cnx);
 
-    st.cam = camera_create();
+    st.cam = camera_open_codec(source, codec, gop, bitrate_kbps);
+    if (st.cam) LOGF("[MAIN] camera backend=%s encoder=%s", camera_backend_name(st.cam),
+         camera_needs_encode(st.cam) ? camera_encoder_name() : "none(passthrough)");
+    abr_init(&st.abr, abr_target_ms, camera_needs_encode(st.cam));
+    admit_init(&st.admit, queue_budget_ms);
+    st.stream_per_frame = !strcmp(stream_mode, "frame");
+    st.deadline_us = deadline_ms > 0 ? (uint64_t)(deadline_ms * 1000.0) : 0;
     pthread_create(&st.cam_thread, NULL, camera_thread_main, &st);
     st.cam_thread_started = 1;
 
@@ -2,6 +2,46 @@
 #define STRUCT_TYPE_H
 
 #include "default_header.h"
+#include "frame_mailbox.h"
+#include "capture_pipeline.h"
+
+/* * [abr_t]
+ * 네트워크 기반 적응형 비트레이트 상태입니다. (로직은 abr.h)
+ */
+typedef struct {
+    double   target_ms;         /* 프레임 전달 목표 시간 (0이면 비활성) */
+    int      level;             /* 현재 사다리 단계 (0 = 최고 품질) */
+    int      path_idx;          /* 마지막으로 추정한 경로 인덱스 */
+    int      adapt_size;        /* 1: 품질/해상도로 프레임 크기를 바꿀 수 있음 (재인코딩 소스) */
+
+    double   cap_Bps;           /* 경로 용량 추정 (B/s, EWMA) */
+    double   frame_B;           /* 현재 단계에서 보낸 프레임 크기 (B, EWMA) */
+    double   pred_ms;           /* 마지막 예상 전달 시간 */
+
+    uint64_t over_since;        /* 목표 초과가 시작된 시각 (0이면 초과 아님) */
+    uint64_t under_since;       /* 여유 상태가 시작된 시각 */
+    uint64_t last_change;       /* 마지막 단계 변경 시각 */
+    uint64_t last_frame;        /* 마지막으로 보낸 프레임 시각 (프레임률 제한) */
+    uint64_t last_in;           /* 마지막으로 들어온 프레임 시각 (입력 프레임률 추정) */
+    double   in_fps;            /* 소스 입력 프레임률 (EWMA) */
+
+    uint64_t skipped;           /* 프레임률 제한으로 건너뛴 프레임 수 */
+    uint64_t changes;           /* 단계 변경 횟수 */
+} abr_t;
+
+/* * [admit_t]
+ * 송신 큐 기반 프레임 허용(latest-frame-wins) 상태입니다. (로직은 abr.h)
+ */
+typedef struct {
+    double   budget_ms;         /* picoquic 송신 큐 대기 허용 시간 (0이면 비활성) */
+    size_t   unsent_B;          /* 마지막으로 잰 미전송 바이트 (스트림 큐) */
+    double   wait_ms;           /* 마지막으로 추정한 큐 대기 시간 */
+
+    uint64_t admitted;          /* 큐에 넣은 프레임 수 */
+    uint64_t skipped;           /* 큐가 밀려 건너뛴 프레임 수 */
+    uint64_t last_log;          /* 마지막 [ADMIT] 로그 시각 */
+    uint64_t log_admitted, log_skipped;   /* 직전 로그 시점의 누적값 */
+} admit_t;
 
 /* * [bind_t]
  * 특정 경로(Path)와 스트림 ID(SID) 사이의 바인딩 상태를 관리합니다. 
@@ -16,6 +56,158 @@ typedef struct {
 #define MAX_PATHS 16
 #endif
 
+/* * [path_role_t]
+ * 로컬 인터페이스(IP)별 경로 역할입니다. 우선순위·비용은 설정에서 오며, 스케줄러가 경로를 역할로 찾습니다.
+ */
+typedef struct {
+    char     name[16];          /* 로그용 이름 (WLAN, USB, path2 ...) */
+    uint32_t ip_be;             /* 로컬 IP (Big Endian) */
+    int      prio;              /* 우선순위 (작을수록 먼저, priority 정책) */
+    double   cost;              /* 링크 비용 (0 = 무료, cost 정책) */
+    int      probe;             /* 1: 스케줄러가 직접 probe하는 추가 인터페이스 */
+    uint64_t last_probe;        /* 마지막 probe/챌린지 시각 */
+} path_role_t;
+
+/* * [path_est_t]
+ * 경로별 품질 추정 상태입니다. 반감기 창으로 RTT 평균/분산, 손실률, goodput을 갱신합니다. (로직은 path_est.h)
+ */
+typedef struct {
+    uint64_t upid;              /* picoquic unique_path_id (경로 객체가 바뀌면 다시 시작) */
+    int      valid;             /* 기준값을 잡았음 */
+    uint64_t last_sample;       /* 마지막 표본 시각 */
+    uint64_t last_progress;     /* 전달 바이트(delivered)가 마지막으로 늘어난 시각 */
+    uint64_t prev_lost;         /* 직전 표본의 total_bytes_lost */
+    uint64_t prev_delivered;    /* 직전 표본의 delivered */
+
+    double   rtt_ms;            /* RTT 지수 가중 평균 (0이면 아직 표본 없음) */
+    double   rtt_var;           /* RTT 지수 가중 분산 (ms^2) */
+    double   lost_B, deliv_B;   /* 반감기로 감쇠하는 창 안의 손실/전달 바이트 */
+    double   loss_pct;          /* 창 손실률 (%) */
+    double   goodput_Bps;       /* 표본 간격당 전달 바이트로 잰 goodput (B/s) */
+    int      stale;             /* 보낸 데이터가 있는데 오래 전달 진척이 없음 */
+
+    /* 하트비트 생존 감지 */
+    uint64_t last_rx;           /* 마지막으로 본 last_packet_received_at */
+    uint64_t ping_ts;           /* 마지막 하트비트(PATH_CHALLENGE) 송신 시각 (응답 대기 중이면 last_rx보다 큼) */
+    int      misses;            /* 연속으로 놓친 응답 기한 수 */
+    int      suspect;           /* 1: 응답 기한을 HB_MISS_LIMIT번 놓쳐 죽은 것으로 의심 */
+} path_est_t;
+
+/* * [path_slot_t]
+ * picoquic 경로 이벤트(available/suspended/deleted/quality_changed)로 갱신하는 경로 테이블 항목입니다. (로직은 path_table.h)
+ */
+typedef struct {
+    uint64_t upid;              /* picoquic unique_path_id */
+    int      state;             /* PATH_ST_* (0: 빈 칸) */
+    int      idx;               /* 마지막으로 확인한 경로 인덱스 (-1: 모름) */
+    uint32_t ip_be;             /* 로컬 IP (Big Endian) */
+    uint64_t since;             /* 상태가 바뀐 시각 */
+    uint64_t rtt_us;            /* 마지막 quality 이벤트의 smoothed RTT */
+    uint64_t pacing_Bps;        /* 마지막 quality 이벤트의 pacing rate */
+} path_slot_t;
+
+/* * [netev_t / netmon_t]
+ * RTNETLINK 인터페이스 감시 스레드 → loop_cb 로 넘기는 주소 이벤트와 감시 상태입니다. (로직은 netmon.h)
+ */
+typedef struct {
+    uint32_t ip_be;             /* 로컬 IPv4 (Big Endian) */
+    int      up;                /* 1: 주소가 생김/링크 올라옴, 0: 주소 사라짐/링크 내려감 */
+    int      ifindex;
+    char     ifname[16];
+} netev_t;
+
+#define NETEV_RING 32           /* 2의 거듭제곱 */
+
+typedef struct {
+    int          mode;          /* 0: 끔, 1: 설정된 경로 IP만, 2: 새 인터페이스도 경로로 채택 (auto) */
+    int          fd;            /* NETLINK_ROUTE 소켓 */
+    pthread_t    thread;
+    int          started;
+    volatile int stop;
+
+    /* 단일 생산자(감시 스레드) / 단일 소비자(loop_cb) 링 */
+    netev_t          ring[NETEV_RING];
+    _Atomic uint32_t head, tail;
+
+    uint64_t     events, probes, abandons, dropped;
+} netmon_t;
+
+/* * [mloop_sock_t / mloop_t]
+ * 인터페이스별 소켓을 직접 소유하는 패킷 루프 상태입니다. (로직은 mloop.h, 네트워크 스레드 전용)
+ * 보낼 패킷은 경로의 로컬 주소(addr_from)로 소켓을 고르고, 받은 패킷은 그 소켓의 바인딩 주소를 addr_to로 넘깁니다.
+ */
+typedef struct {
+    int      fd;                /* -1: 빈 칸 */
+    struct sockaddr_storage addr;   /* 바인딩된 로컬 주소 */
+} mloop_sock_t;
+
+typedef struct {
+    mloop_sock_t s[MAX_PATHS];  /* 0번부터 살아 있는 첫 소켓이 로컬 주소가 정해지지 않은 초기 경로용 */
+    int          epfd;
+    int          gso;           /* 1: UDP GSO(송신 묶음) / GRO(수신 묶음) 사용 */
+
+    uint64_t     rx_calls, rx_pkts;     /* recvmmsg 호출 / 받은 QUIC 패킷 */
+    uint64_t     tx_calls, tx_pkts;     /* sendmmsg 호출 / 보낸 QUIC 패킷 */
+    uint64_t     gso_sends, no_route, tx_drop;
+} mloop_t;
+
+/* * [race_t]
+ * 시작 시 인터페이스별 핸드셰이크 경쟁 상태입니다. 먼저 끝난 연결을 st->cnx로 쓰고 나머지는 닫습니다. (로직은 race.h)
+ */
+typedef struct {
+    picoquic_cnx_t*         cnx[MAX_PATHS];     /* 후보 연결 (NULL: 정리됨) */
+    struct sockaddr_storage local[MAX_PATHS];   /* 후보의 로컬 주소 (초기 경로) */
+    uint64_t                start_at[MAX_PATHS];/* 핸드셰이크 시작 예정 시각 (happy eyeballs 시차) */
+    int                     started[MAX_PATHS];
+    int                     n;                  /* 후보 수 (0: 경쟁 없음 / 정리 끝) */
+    int                     winner;             /* 이긴 후보 (-1: 진행 중) */
+    int                     probed;             /* 1: 진 후보의 인터페이스를 이긴 연결의 경로로 probe함 */
+    uint64_t                t0;                 /* 경쟁 시작 시각 */
+    picoquic_stream_data_cb_fn app_cb;          /* 이긴 연결에 넘길 원래 콜백 */
+} race_t;
+
+/* * [tx_frame_t / jit_stream_t]
+ * JIT 송신용 프레임 버퍼와 경로별 송신 스트림 상태입니다. (로직은 quic_helpers.h, 네트워크 스레드 전용)
+ * 프레임 데이터는 우편함 슬롯에서 버퍼째 넘겨받고, picoquic이 패킷을 만들 때 prepare_to_send 콜백에서
+ * 패킷 버퍼로 바로 복사합니다. 여러 경로 스트림이 같은 프레임을 가리킬 수 있으므로 참조 카운트로 관리합니다.
+ */
+#define TXF_POOL (2 * MAX_PATHS + 2)   /* 경로마다 직렬화 중 1 + 대기 1, 그리고 loop_cb가 쥔 1 */
+#define TXV_POOL (3 * MAX_PATHS)       /* 스트라이핑 조각(뷰): 경로마다 직렬화 중 1 + 대기 1, 그리고 만드는 중인 조각 */
+#define TXF_HDR_MAX 52                 /* 길이 varint + 스트라이프 헤더 + AU 헤더 */
+
+typedef struct tx_frame_s {
+    uint8_t* buf;               /* 뷰이면 부모 버퍼 안의 위치 (소유하지 않음) */
+    size_t   cap;
+    size_t   len;               /* 페이로드 길이 */
+    uint8_t  hdr[TXF_HDR_MAX];  /* 길이 varint (+ 스트라이프 헤더) (+ AU 헤더) */
+    size_t   hlen;
+    size_t   alen;              /* hdr 끝의 AU 헤더 길이 (H.264가 아니거나 뷰이면 0) */
+    uint64_t seq;               /* 우편함 발행 순번 */
+    uint64_t ts_us;             /* 캡처 시각 */
+    int      key;               /* 단독 디코딩 가능 여부 */
+    int      refs;              /* 0이면 풀에서 비어 있음 */
+    struct tx_frame_s* parent;  /* 스트라이핑 조각이면 원본 프레임 (참조 1개를 쥠) */
+} tx_frame_t;
+
+typedef struct {
+    uint64_t    sid;            /* cur가 실리는 스트림 */
+    tx_frame_t* cur;            /* 직렬화 중인 프레임 (이미 일부가 패킷으로 나감) */
+    size_t      off;            /* cur 안에서 보낸 위치 (헤더 포함) */
+    tx_frame_t* next;           /* 대기 중인 최신 프레임 (아직 한 바이트도 안 나감, 교체 가능) */
+    uint64_t    next_sid;       /* 프레임별 스트림 모드: next용으로 연 스트림 (0이면 아직 안 엶) */
+    int         active;         /* picoquic_mark_active_stream 상태 */
+} jit_stream_t;
+
+/* * [fstream_t]
+ * FIN까지 picoquic에 넘겼지만 아직 전달이 확인되지 않은 프레임별 스트림과 그 전달 기한입니다.
+ */
+#define FSTREAM_MAX 64
+
+typedef struct {
+    uint64_t sid;
+    uint64_t deadline_us;       /* 캡처 시각 + 전달 기한 (CLOCK_MONOTONIC) */
+} fstream_t;
+
 /* * [tx_t]
  * 데이터 전송(TX)에 필요한 모든 상태 정보와 버퍼를 관리하는 핵심 구조체입니다. 
  */
@@ -59,12 +251,10 @@ typedef struct {
     int      rr;                    /* 라운드 로빈 인덱스 */
     uint64_t send_interval_us;      /* 전송 간격 (us) */
 
-    /* 카메라 캡처 버퍼 (실제 전송용/TX 전용) */
+    /* 카메라 핸들 및 송신 상태 */
     camera_handle_t cam;            /* 카메라 핸들 */
-    size_t   cap_cap;               /* 캡처 버퍼의 총 용량 */
     size_t   pending_off;           /* 데이터 송신 오프셋 (초기값 0) */
     int      last_pi;               /* 마지막 사용 경로 인덱스 (초기값 -1) */
-    uint8_t* cap_buf;               /* 캡처된 데이터를 담는 실제 버퍼 */
 
     /* QUIC varint 인코딩을 위한 프레임 길이 저장용 버퍼 */
     uint8_t  lenb[8];
@@ -76,19 +266,86 @@ typedef struct {
     uint32_t primary_local_ip; 
 
     /* * [카메라 전용 스레드/공유 리소스] 
-     * 백그라운드 캡처 스레드와 메인 루프 간의 동기화를 위한 변수들입니다.
+     * 캡처 → 인코딩 워커 → 재정렬 단계는 lock-free 큐(pipe)로 잇고,
+     * 재정렬 단계 → 메인 루프 프레임 전달은 lock-free 삼중 버퍼(cam_mb)로 합니다.
+     * 어느 단계도 다음 단계를 기다리지 않으며, 메인 루프는 복사 없이 안정된 최신 프레임을 읽습니다.
      */
     pthread_t       cam_thread;     /* 카메라 캡처 스레드 ID */
-    pthread_mutex_t cam_mtx;        /* 공유 데이터 보호를 위한 뮤텍스 */
     int             cam_thread_started;
-    int             cam_stop;       /* 1이면 캡처 스레드 종료 시퀀스 진행 */
-
-    /* 캡처 스레드가 직접 데이터를 쓰는 버퍼와 상태 */
-    uint8_t* cam_buf;              /* 실시간 캡처 데이터 버퍼 */
-    size_t    cam_cap;              /* cam_buf의 총 용량 */
-    int       cam_len;              /* 가장 최근에 캡처된 프레임의 실제 길이 */
-    uint64_t  cam_seq;              /* 프레임별 고유 시퀀스 번호 */
-    uint64_t  last_sent_seq;        /* 메인 루프에서 마지막으로 전송 성공한 seq */
+    volatile int    cam_stop;       /* 1이면 캡처 스레드 종료 시퀀스 진행 */
+
+    cam_pipe_t      pipe;           /* 캡처/인코딩/재정렬 단계 큐와 단계별 계측 */
+    frame_mailbox_t cam_mb;         /* 최신 프레임 우편함 */
+    uint64_t  last_sent_seq;        /* 메인 루프에서 마지막으로 꺼낸 프레임 seq */
+
+    /* H.264 모드 전송 게이트: 끊긴 AU 뒤의 참조 프레임은 다음 IDR까지 보내지 않음 (loop_cb 전용) */
+    uint64_t  au_last_seq;          /* 마지막으로 전송에 성공한 프레임 seq */
+    int       au_need_key;          /* 0이 아니면 키프레임을 기다리는 중 (IDR 요청 후 버린 AU 수) */
+    uint64_t  au_gated;             /* 게이트에서 버린 AU 수 */
+
+    /* 네트워크 기반 적응형 비트레이트 (품질/해상도/프레임률, loop_cb 전용) */
+    abr_t     abr;
+
+    /* 송신 큐 기반 프레임 허용: 밀린 프레임 뒤에 새 프레임을 쌓지 않음 (loop_cb 전용) */
+    admit_t   admit;
+
+    /* JIT 송신: 프레임 버퍼 풀과 경로별 송신 스트림 (prepare_to_send 콜백이 직접 읽음) */
+    tx_frame_t   txf[TXF_POOL];
+    jit_stream_t jit[MAX_PATHS];
+    uint64_t     jit_replaced;      /* 직렬화 전에 더 새 프레임으로 교체된 프레임 수 */
+
+    /* 프레임별 단방향 스트림 모드: 프레임마다 새 스트림을 열고 FIN으로 닫아 프레임 간 HOL 차단을 없앰 */
+    int          stream_per_frame;  /* 0: 경로별 장수 스트림 (기본), 1: 프레임별 스트림 */
+    uint64_t     frame_streams;     /* 프레임별 모드에서 연 스트림 수 */
+    uint64_t     stream_open_fail;  /* 스트림을 열지 못해 버린 프레임 수 (스트림 한도 등) */
+
+    /* 프레임 전달 기한: 기한이 지난 프레임은 재전송하지 않고 버림 (프레임별 스트림은 reset, loop_cb 전용) */
+    uint64_t     deadline_us;       /* 캡처 시각 기준 전달 기한 (0이면 끔) */
+    fstream_t    fstr[FSTREAM_MAX]; /* 전달 확인 대기 중인 프레임별 스트림 (오래된 순) */
+    int          fstr_n;
+    uint64_t     expired;           /* 전송 도중 기한이 지나 reset한 프레임 수 */
+    uint64_t     expired_unsent;    /* 한 바이트도 나가기 전에 기한이 지나 버린 프레임 수 */
+
+    /* 프레임 내 스트라이핑: 한 프레임을 여러 경로로 나눠 동시에 도착하게 보냄 (로직은 stripe.h) */
+    int          stripe;            /* 1이면 사용 */
+    tx_frame_t   txv[TXV_POOL];     /* 조각 뷰 풀 (버퍼는 부모 프레임 것) */
+    uint64_t     stripe_frames;     /* 나눠 보낸 프레임 수 */
+    uint64_t     stripe_chunks;     /* 보낸 조각 수 */
+    uint64_t     stripe_fail;       /* 일부 조각을 넘기지 못한 프레임 수 */
+
+    /* 이중 경로 중복 전송: 전환 중이거나 주 경로가 불확실할 때 두 경로로 같은 프레임 (로직은 stripe.h) */
+    double       red_pct;           /* 추가 대역 예산 (보낸 바이트 대비 %, 0이면 끔) */
+    double       red_credit_B;      /* 중복 전송에 쓸 수 있는 누적 예산 (B) */
+    uint64_t     red_frames;        /* 두 경로로 보낸 프레임 수 */
+    uint64_t     red_no_budget;     /* 중복이 필요했지만 예산이 없어 한 경로로 보낸 프레임 수 */
+
+    /* 경로 스케줄러: 설정된 경로 역할(우선순위/비용)과 선택 정책 (로직은 path_sched.h) */
+    path_role_t  roles[MAX_PATHS];
+    int          nroles;
+    int          sched;             /* SCHED_PRIORITY / SCHED_MINRTT / SCHED_WRR / SCHED_COST */
+    double       wrr_credit[MAX_PATHS];   /* 가중 라운드 로빈 누적 크레딧 (경로 인덱스별) */
+    uint64_t     sched_switches;    /* 주 경로 전환 횟수 */
+
+    /* 시작 시 인터페이스별 핸드셰이크 경쟁 */
+    race_t       race;
+
+    /* 인터페이스별 소켓 패킷 루프 (picoquic_packet_loop_v2 대신) */
+    mloop_t      mloop;
+
+    /* RTNETLINK 인터페이스 감시: 주소/링크 변화에 바로 probe·abandon */
+    netmon_t     netmon;
+
+    /* 경로 이벤트 테이블: 콜백이 갱신하고 loop_cb는 세대(path_gen)가 바뀌었을 때만 다시 봄 */
+    path_slot_t  ptab[MAX_PATHS];
+    uint64_t     path_gen;          /* 경로 테이블 변경 세대 (이벤트마다 증가) */
+    uint64_t     path_events;       /* 받은 경로 이벤트 수 */
+
+    /* 경로별 품질 추정기 (경로 인덱스별, 스케줄러·중복 전송 판정이 읽음) */
+    path_est_t   est[MAX_PATHS];
+    double       est_half_life_ms;  /* 추정 반감기 (ms) */
+    uint64_t     hb_idle_us;        /* 유휴 경로 하트비트 간격 (0이면 하트비트 끔) */
+    uint64_t     hb_pings;          /* 보낸 하트비트 수 */
+    uint64_t     hb_suspects;       /* 의심 판정 횟수 */
 
     /* 알고리즘 및 모니터링용 메트릭 */
     uint64_t hs_done_ts;            /* 핸드셰이크가 완료된 타임스탬프 */
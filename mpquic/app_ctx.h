@@ -12,7 +12,7 @@
 #endif
 
 #ifndef MAX_STREAMS
-#define MAX_STREAMS 16  /* 동시에 처리할 최대 스트림(경로) 수 */
+#define MAX_STREAMS 64  /* 동시에 조립 중인 최대 스트림 수 (경로별 스트림 + 프레임별 스트림) */
 #endif
 
 #ifndef MAX_FRAME_SIZE
@@ -46,6 +46,15 @@ typedef enum {
 } rx_state_e;
 
 
+/**
+ * @brief 프레임별 파일 저장 시 디렉토리 배치 방식입니다.
+ */
+typedef enum {
+    FA_LAYOUT_BUCKETED = 0,  /* out_dir/<client>/YYYYMMDD/HH/frame_N.jpg (기본) */
+    FA_LAYOUT_FLAT     = 1,  /* out_dir/frame_N.jpg (구버전 호환) */
+} fa_layout_e;
+
+
 /* ============================================================
  * [3] 스트림 및 애플리케이션 컨텍스트 구조체
  * ============================================================ */
@@ -87,6 +96,7 @@ typedef struct {
     char     out_dir[256];   /* 프레임이 저장될 디렉토리 경로 */
     int      frame_count;    /* 현재까지 수신 완료된 총 프레임 수 */
     int      max_frames;     /* 수신할 최대 프레임 제한 (0이면 무제한) */
+    fa_layout_e layout;      /* 프레임 파일 디렉토리 배치 방식 */
     
     /* 스트림별 상태 배열 */
     rx_stream_t rx[MAX_STREAMS];   
@@ -96,6 +106,39 @@ typedef struct {
     uint64_t   backlog_bytes;      /* 디스크 저장을 대기 중인 추정 데이터량 */
     uint64_t   frame_idx;          /* 저장 시 사용할 프레임 인덱스 */
     uint64_t   bytes_saved_total;  /* 실제로 디스크에 기록 완료된 총 바이트 수 */
+
+    /* 클라이언트별 공정 저장 설정 */
+    uint64_t   client_rate_bps;    /* 클라이언트별 기본 기록 속도 제한 (B/s, 0이면 무제한) */
+
+    /* 계층형 저장소 설정 (stage_dir가 비어 있으면 비활성) */
+    char       stage_dir[256];     /* Tier-0 착륙 구역 (tmpfs 권장) */
+    uint64_t   stage_max_bytes;    /* 착륙 구역 최대 점유량 */
+    uint64_t   mover_rate_bps;     /* 이전 속도 제한 (B/s, 0이면 무제한) */
+
+    /* 계층형 저장소 통계 */
+    uint64_t   tier0_bytes;        /* 착륙 구역에 남아 있는 바이트 */
+    uint64_t   tier0_files;        /* 착륙 구역에 남아 있는 프레임 수 */
+    uint64_t   tier_moved_frames;  /* 영구 저장소로 이전 완료된 프레임 수 */
+    uint64_t   tier_moved_bytes;   /* 영구 저장소로 이전 완료된 바이트 */
+    uint64_t   tier_direct_frames; /* 착륙 구역이 가득 차 직접 기록한 프레임 수 */
+
+    /* H.264 AU 저장 통계 (클라이언트별 GOP 세그먼트) */
+    uint64_t   h264_aus;           /* 세그먼트에 기록한 AU 수 */
+    uint64_t   h264_segments;      /* 시작한 세그먼트(GOP) 수 */
+    uint64_t   h264_dropped;       /* 키프레임 전이거나 순번이 어긋나 버린 AU 수 */
+    uint64_t   h264_gaps;          /* AU 순번이 빠져 세그먼트를 끊은 횟수 */
+
+    /* 스트림 종료(FIN) 통계 (프레임별 스트림 모드에서는 프레임마다 1회) */
+    uint64_t   stream_fins;        /* FIN으로 닫힌 스트림 수 */
+    uint64_t   fin_truncated;      /* 프레임 중간에 FIN이 와서 버린 프레임 수 */
+    uint64_t   stream_resets;      /* 송신 측 reset으로 버린 스트림 수 (기한 초과 프레임 등) */
+    uint64_t   reset_bytes;        /* reset으로 버린 조립 중 바이트 */
+
+    /* 스트라이프 재조립 통계 (여러 경로로 나뉘어 온 프레임) */
+    uint64_t   stripe_frames;      /* 재조립을 마친 프레임 수 */
+    uint64_t   stripe_chunks;      /* 받은 조각 수 */
+    uint64_t   stripe_dropped;     /* 조각이 모자라 버린 프레임 수 (잘못된 조각 포함) */
+    uint64_t   dup_dropped;        /* 이미 받은 프레임이라 버린 중복 사본 수 */
 } app_ctx_t;
 
 #endif /* APP_CTX_SERVER_H */
\ No newline at end of file
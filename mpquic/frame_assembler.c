@@ -9,6 +9,11 @@
 #include <pthread.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <fcntl.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <sys/sendfile.h>
 
 #include "picoquic.h"
 #include "frame_assembler.h"
@@ -70,21 +75,63 @@ static rx_bank_t g_bank;
 #  define SAVE_POP_BATCH 128   /* 한 번에 처리할 최대 프레임 수 */
 #endif
 
+#ifndef FA_DRR_QUANTUM
+#  define FA_DRR_QUANTUM (256 * 1024)  /* DRR 라운드당 클라이언트별 기록 허용량 (B) */
+#endif
+
 typedef struct {
     app_ctx_t* app;
     uint8_t* buf;
     size_t len;
+    char tag[FA_TAG_MAX];     /* 클라이언트 식별 태그 (디렉토리 이름) */
 } save_job_t;
 
+/**
+ * @brief 작업 풀의 노드입니다. 클라이언트별 FIFO를 next 인덱스로 연결합니다.
+ */
+typedef struct {
+    save_job_t job;
+    int next;                 /* 같은 클라이언트 큐의 다음 노드 (-1이면 끝) */
+} save_node_t;
+
+/**
+ * @brief 클라이언트별 하위 큐 + DRR/속도 제한 상태 + 통계입니다.
+ */
+typedef struct {
+    int      in_use;
+    char     tag[FA_TAG_MAX];
+    int      head, tail;      /* 노드 인덱스 (-1이면 비어 있음) */
+    uint64_t n, bytes;        /* 대기 중인 프레임 수 / 바이트 */
+    int64_t  deficit;         /* DRR 잔여 허용량 */
+    uint64_t rate_bps;        /* 바이트 속도 제한 (0이면 무제한) */
+    int64_t  tokens;          /* 토큰 버킷 (음수면 빚) */
+    uint64_t tok_ts_us;       /* 마지막 토큰 충전 시각 */
+    uint64_t last_us;         /* 마지막 활동(적재/저장) 시각, 슬롯 회수 순서 */
+    fa_client_stat_t st;      /* 누적 통계 */
+} client_q_t;
+
 typedef struct {
-    save_job_t q[SAVEQ_MAX];
-    int h, t, n;              /* head, tail, count */
+    save_node_t node[SAVEQ_MAX];
+    int free_head;            /* 빈 노드 리스트 */
+    client_q_t cq[FA_MAX_CLIENTS];
+    int rr;                   /* DRR 순회 위치 */
+    int n;                    /* 전체 대기 프레임 수 */
+    uint64_t drop_noslot;     /* 클라이언트 슬롯이 없어 버린 프레임 수 */
     pthread_mutex_t m;
     pthread_cond_t cv;
     int inited;
     int started;
 } saveq_t;
 
+/* 클라이언트별 속도 제한 예외 설정 (태그 → B/s) */
+typedef struct {
+    char     tag[FA_TAG_MAX];
+    uint64_t bps;
+} rate_ovr_t;
+
+static rate_ovr_t g_rate_ovr[FA_MAX_CLIENTS];
+static int g_rate_ovr_n;
+
 static saveq_t g_saveq;
 static pthread_once_t g_once = PTHREAD_ONCE_INIT;
 
@@ -94,7 +141,8 @@ static pthread_once_t g_once = PTHREAD_ONCE_INIT;
  * ============================================================ */
 
 static void* save_worker(void*);
-static int saveq_push_take(app_ctx_t*, uint8_t*, size_t);
+static int saveq_push_take(app_ctx_t*, uint8_t*, size_t, const char*);
+static size_t quic_varint_decode(const uint8_t*, size_t, uint64_t*);
 
 static void ensure_dir(const char* d){
     if (!d || !*d) return;
@@ -107,9 +155,21 @@ static void saveq_init_once(void){
     memset(&g_saveq, 0, sizeof(g_saveq));
     pthread_mutex_init(&g_saveq.m, NULL);
     pthread_cond_init(&g_saveq.cv, NULL);
+
+    for (int i = 0; i < SAVEQ_MAX; i++) g_saveq.node[i].next = i + 1;
+    g_saveq.node[SAVEQ_MAX - 1].next = -1;
+    g_saveq.free_head = 0;
+
+    for (int i = 0; i < FA_MAX_CLIENTS; i++) g_saveq.cq[i].head = g_saveq.cq[i].tail = -1;
     g_saveq.inited = 1;
 }
 
+static uint64_t mono_us(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
 /**
  * @brief 디스크 저장 전담 워커 스레드를 시작합니다.
  */
@@ -125,7 +185,782 @@ static void maybe_start_worker(void){
 
 
 /* ============================================================
- * [4] 디스크 저장 워커 로직
+ * [4] 클라이언트별 공정 큐 (Deficit Round Robin)
+ *     (아래 함수들은 모두 g_saveq.m 잠금 상태에서 호출)
+ * ============================================================ */
+
+static uint64_t rate_for_tag(app_ctx_t* app, const char* tag){
+    for (int i = 0; i < g_rate_ovr_n; i++) {
+        if (strcmp(g_rate_ovr[i].tag, tag) == 0) return g_rate_ovr[i].bps;
+    }
+    return app ? app->client_rate_bps : 0;
+}
+
+#define FA_CQ_EVICT_IDLE_US 10000000ULL   /* 쓰던 슬롯을 넘기려면 이만큼 쉬고 있어야 함 */
+
+/**
+ * @brief 태그에 해당하는 하위 큐를 찾거나, 빈 슬롯을 배정합니다.
+ * 빈 슬롯이 없을 때만 큐가 비고 가장 오래 쉰(FA_CQ_EVICT_IDLE_US 이상) 클라이언트의 슬롯을 넘깁니다.
+ * 큐가 막 비었을 뿐인 클라이언트는 토큰 버킷과 드랍 통계를 그대로 유지합니다.
+ */
+static client_q_t* cq_get(app_ctx_t* app, const char* tag){
+    client_q_t* fr  = NULL;
+    client_q_t* lru = NULL;
+    uint64_t now = mono_us();
+
+    for (int i = 0; i < FA_MAX_CLIENTS; i++) {
+        client_q_t* c = &g_saveq.cq[i];
+        if (c->in_use && strcmp(c->tag, tag) == 0) {
+            c->last_us = now;
+            return c;
+        }
+        if (!c->in_use) {
+            if (!fr) fr = c;
+        } else if (c->n == 0 && now - c->last_us >= FA_CQ_EVICT_IDLE_US && (!lru || c->last_us < lru->last_us)) {
+            lru = c;
+        }
+    }
+    client_q_t* idle = fr ? fr : lru;
+    if (!idle) return NULL;
+
+    /* 빈 슬롯 또는 오래 쉬고 있던 슬롯을 새 클라이언트에게 넘김 (통계 초기화) */
+    memset(idle, 0, sizeof(*idle));
+    idle->in_use = 1;
+    idle->head = idle->tail = -1;
+    snprintf(idle->tag, sizeof(idle->tag), "%s", tag);
+    snprintf(idle->st.tag, sizeof(idle->st.tag), "%s", tag);
+    idle->rate_bps = rate_for_tag(app, tag);
+    idle->tokens = (int64_t)idle->rate_bps;
+    idle->tok_ts_us = now;
+    idle->last_us   = now;
+    return idle;
+}
+
+static void cq_push(client_q_t* c, int ni){
+    g_saveq.node[ni].next = -1;
+    if (c->tail >= 0) g_saveq.node[c->tail].next = ni;
+    else c->head = ni;
+    c->tail = ni;
+    c->n++;
+    c->bytes += g_saveq.node[ni].job.len;
+    g_saveq.n++;
+}
+
+static save_job_t cq_pop(client_q_t* c){
+    int ni = c->head;
+    c->last_us = mono_us();
+    save_job_t job = g_saveq.node[ni].job;
+
+    c->head = g_saveq.node[ni].next;
+    if (c->head < 0) c->tail = -1;
+    c->n--;
+    c->bytes -= job.len;
+    g_saveq.n--;
+
+    g_saveq.node[ni].next = g_saveq.free_head;
+    g_saveq.free_head = ni;
+    return job;
+}
+
+/**
+ * @brief 과부하 시 대기 바이트가 가장 많은 클라이언트의 가장 오래된 프레임을 버립니다.
+ */
+static void cq_drop_heaviest(void){
+    client_q_t* heavy = NULL;
+    for (int i = 0; i < FA_MAX_CLIENTS; i++) {
+        client_q_t* c = &g_saveq.cq[i];
+        if (c->n > 0 && (!heavy || c->bytes > heavy->bytes)) heavy = c;
+    }
+    if (!heavy) return;
+
+    save_job_t old = cq_pop(heavy);
+    heavy->st.dropped_frames++;
+    heavy->st.dropped_bytes += old.len;
+    if (old.buf) free(old.buf);
+}
+
+/**
+ * @brief 속도 제한 토큰을 충전하고, 기록 가능하면 1을 반환합니다.
+ * 불가능하면 토큰이 다시 0 이상이 될 때까지의 시간을 *wait_us에 반영합니다.
+ */
+static int cq_tokens_ok(client_q_t* c, uint64_t now, uint64_t* wait_us){
+    if (c->rate_bps == 0) return 1;
+
+    uint64_t dt = now - c->tok_ts_us;
+    c->tok_ts_us = now;
+    c->tokens += (int64_t)(dt * c->rate_bps / 1000000ULL);
+    if (c->tokens > (int64_t)c->rate_bps) c->tokens = (int64_t)c->rate_bps;  /* 최대 1초 분량 */
+
+    if (c->tokens >= 0) return 1;
+
+    uint64_t w = (uint64_t)(-c->tokens) * 1000000ULL / c->rate_bps + 1;
+    if (*wait_us == 0 || w < *wait_us) *wait_us = w;
+    return 0;
+}
+
+/**
+ * @brief DRR로 클라이언트들을 돌며 최대 max개의 작업을 꺼냅니다.
+ * 모두 속도 제한에 걸려 하나도 못 꺼내면 0을 반환하고 *wait_us에 대기 시간을 줍니다.
+ */
+static int saveq_pop_drr(save_job_t* out, int max, uint64_t* wait_us){
+    int k = 0;
+    uint64_t now = mono_us();
+    *wait_us = 0;
+
+    while (k < max && g_saveq.n > 0) {
+        int any = 0;
+
+        for (int step = 0; step < FA_MAX_CLIENTS && k < max; step++) {
+            client_q_t* c = &g_saveq.cq[g_saveq.rr];
+            g_saveq.rr = (g_saveq.rr + 1) % FA_MAX_CLIENTS;
+
+            if (c->n == 0) { c->deficit = 0; continue; }
+            if (!cq_tokens_ok(c, now, wait_us)) continue;
+
+            any = 1;
+            c->deficit += FA_DRR_QUANTUM;
+
+            while (c->n > 0 && k < max) {
+                size_t hl = g_saveq.node[c->head].job.len;
+                if ((int64_t)hl > c->deficit) break;
+                if (c->tokens < 0) break;
+
+                save_job_t job = cq_pop(c);
+                c->deficit -= (int64_t)hl;
+                if (c->rate_bps) c->tokens -= (int64_t)hl;
+                c->st.written_frames++;
+                c->st.written_bytes += hl;
+                out[k++] = job;
+            }
+            if (c->n == 0) c->deficit = 0;
+        }
+        if (!any) break;
+    }
+    return k;
+}
+
+
+/* ============================================================
+ * [5] 디렉토리 캐시 (dirfd 기반, 저장 워커 전용)
+ * ============================================================ */
+
+/**
+ * @brief 클라이언트별로 열어둔 디렉토리 핸들입니다.
+ * 시간 버킷(YYYYMMDD/HH)이 바뀔 때만 mkdirat/openat을 수행하므로
+ * 프레임당 메타데이터 작업은 openat + renameat 두 번으로 고정됩니다.
+ */
+typedef struct {
+    int    in_use;
+    char   tag[FA_TAG_MAX];
+    int    client_fd;         /* out_dir/<client> */
+    int    hour_fd;           /* out_dir/<client>/YYYYMMDD/HH */
+    time_t hour_end;          /* 현재 hour_fd가 유효한 마지막 시각(배타) */
+} dir_slot_t;
+
+typedef struct {
+    app_ctx_t* app;           /* root_fd가 가리키는 out_dir의 주인 */
+    int        root_fd;       /* out_dir */
+    dir_slot_t slot[FA_MAX_CLIENTS];
+    int        victim;        /* 슬롯이 가득 찼을 때 교체할 위치 */
+} dir_cache_t;
+
+static dir_cache_t g_dirs = { .app = NULL, .root_fd = -1 };
+
+static int open_subdir(int parent, const char* name){
+    if (mkdirat(parent, name, 0755) != 0 && errno != EEXIST) return -1;
+    return openat(parent, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+static void dir_slot_drop(dir_slot_t* d){
+    if (d->hour_fd >= 0) close(d->hour_fd);
+    if (d->client_fd >= 0) close(d->client_fd);
+    memset(d, 0, sizeof(*d));
+    d->client_fd = d->hour_fd = -1;
+}
+
+static int dir_root(app_ctx_t* app){
+    if (g_dirs.app == app && g_dirs.root_fd >= 0) return g_dirs.root_fd;
+
+    for (int i = 0; i < FA_MAX_CLIENTS; i++) {
+        if (g_dirs.slot[i].in_use) dir_slot_drop(&g_dirs.slot[i]);
+    }
+    if (g_dirs.root_fd >= 0) close(g_dirs.root_fd);
+
+    ensure_dir(app->out_dir);
+    g_dirs.root_fd = open(app->out_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    g_dirs.app = app;
+    return g_dirs.root_fd;
+}
+
+/**
+ * @brief 클라이언트 태그와 현재 시각에 해당하는 버킷 디렉토리 fd를 반환합니다.
+ */
+static int dir_for_frame(app_ctx_t* app, const char* tag, time_t now){
+    int root = dir_root(app);
+    if (root < 0) return -1;
+    if (app->layout == FA_LAYOUT_FLAT) return root;
+
+    if (!tag || !*tag) tag = "unknown";
+
+    /* 1. 클라이언트 슬롯 찾기 (없으면 새로 열기) */
+    dir_slot_t* d = NULL;
+    for (int i = 0; i < FA_MAX_CLIENTS; i++) {
+        if (g_dirs.slot[i].in_use && strcmp(g_dirs.slot[i].tag, tag) == 0) {
+            d = &g_dirs.slot[i];
+            break;
+        }
+    }
+    if (!d) {
+        for (int i = 0; i < FA_MAX_CLIENTS && !d; i++) {
+            if (!g_dirs.slot[i].in_use) d = &g_dirs.slot[i];
+        }
+        if (!d) {
+            d = &g_dirs.slot[g_dirs.victim];
+            g_dirs.victim = (g_dirs.victim + 1) % FA_MAX_CLIENTS;
+            dir_slot_drop(d);
+        }
+        d->client_fd = open_subdir(root, tag);
+        if (d->client_fd < 0) { d->client_fd = -1; return -1; }
+        d->in_use = 1;
+        d->hour_fd = -1;
+        d->hour_end = 0;
+        snprintf(d->tag, sizeof(d->tag), "%s", tag);
+    }
+
+    /* 2. 시간 버킷이 유효하면 그대로 사용 */
+    if (d->hour_fd >= 0 && now < d->hour_end) return d->hour_fd;
+
+    /* 3. 버킷 교체: YYYYMMDD/HH 생성 및 오픈 */
+    if (d->hour_fd >= 0) close(d->hour_fd);
+    d->hour_fd = -1;
+
+    struct tm tm;
+    localtime_r(&now, &tm);
+
+    char day[16], hour[8];
+    strftime(day,  sizeof(day),  "%Y%m%d", &tm);
+    strftime(hour, sizeof(hour), "%H", &tm);
+
+    int day_fd = open_subdir(d->client_fd, day);
+    if (day_fd < 0) return -1;
+    d->hour_fd = open_subdir(day_fd, hour);
+    close(day_fd);
+    if (d->hour_fd < 0) return -1;
+
+    tm.tm_min = 0; tm.tm_sec = 0; tm.tm_hour += 1; tm.tm_isdst = -1;
+    d->hour_end = mktime(&tm);
+    return d->hour_fd;
+}
+
+
+/* ============================================================
+ * [6] 영구 저장소(Durable tier) 기록
+ * ============================================================ */
+
+/* 디렉토리 캐시는 저장 워커와 tier mover가 함께 사용하므로 잠금으로 보호 */
+static pthread_mutex_t g_dirs_m = PTHREAD_MUTEX_INITIALIZER;
+
+static int write_all(int fd, const uint8_t* p, size_t len){
+    while (len > 0) {
+        ssize_t w = write(fd, p, len);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+/**
+ * @brief 파일 간 복사를 커널 안에서 수행합니다 (tmpfs → 디스크).
+ */
+static int copy_fd_all(int out_fd, int in_fd, size_t len){
+    off_t off = 0;
+    while ((size_t)off < len) {
+        ssize_t w = sendfile(out_fd, in_fd, &off, len - (size_t)off);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (w == 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 프레임 하나를 영구 저장소에 기록합니다. (buf 또는 src_fd 중 하나를 사용)
+ * 원자적 저장을 위해 .part 파일로 쓰고 renameat 수행합니다.
+ */
+static int durable_store(app_ctx_t* app, const char* tag, uint64_t idx, time_t ts,
+                         const uint8_t* buf, int src_fd, size_t len)
+{
+    char tmp[64], dst[64];
+    snprintf(tmp, sizeof(tmp), "frame_%06" PRIu64 ".part", idx);
+    snprintf(dst, sizeof(dst), "frame_%06" PRIu64 ".jpg",  idx);
+
+    pthread_mutex_lock(&g_dirs_m);
+
+    int rc = -1;
+    int dfd = dir_for_frame(app, tag, ts);
+    if (dfd < 0) {
+        LOG_WRN("[SAVE] no directory for client=%s", tag);
+    } else {
+        int fd = openat(dfd, tmp, O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd >= 0) {
+            int wr = buf ? write_all(fd, buf, len) : copy_fd_all(fd, src_fd, len);
+            close(fd);
+            if (wr == 0 && renameat(dfd, tmp, dfd, dst) == 0) rc = 0;
+            else unlinkat(dfd, tmp, 0);
+        }
+    }
+
+    pthread_mutex_unlock(&g_dirs_m);
+    return rc;
+}
+
+/*
+ * H.264 모드 클라이언트는 JPEG 대신 Annex-B 접근 단위(AU)를 같은 길이 프레이밍으로 보냅니다.
+ * AU는 앞 프레임을 참조하므로 파일 하나씩이 아니라 클라이언트별 세그먼트에 이어 붙이고,
+ * 키프레임(IDR, SPS/PPS 반복)마다 새 세그먼트를 시작해 각 파일을 단독으로 재생할 수 있게 합니다.
+ *   gop_<첫 AU 번호>.h264.part 에 기록 → 다음 키프레임에서 .h264로 확정
+ * 키프레임 여부는 AU 안의 NAL 유형으로 판단합니다.
+ *
+ * 경로마다 도착 순서가 다르므로 AU 레코드에는 클라이언트 순번이 붙어 옵니다. (FF 'M' 'P' 'A' + varint 순번)
+ * 클라이언트의 au_gate처럼, 앞 AU의 다음 순번이 아닌 P 프레임이 오면 그때까지의 세그먼트를 확정하고
+ * 다음 키프레임까지 버립니다. 이미 지난 순번(중복·늦은 도착)은 세그먼트를 끊지 않고 버립니다.
+ */
+
+/**
+ * @brief 클라이언트별로 기록 중인 H.264 세그먼트입니다. (저장 워커 전용, g_dirs_m 잠금 상태)
+ */
+typedef struct {
+    int      in_use;
+    char     tag[FA_TAG_MAX];
+    int      dfd;             /* 세그먼트를 연 버킷 디렉토리 (dup: 버킷이 바뀌어도 유효) */
+    int      fd;              /* 기록 중인 .part (-1이면 키프레임 대기) */
+    uint64_t idx;             /* 세그먼트 번호 (첫 AU의 frame_idx) */
+    uint64_t last_seq;        /* 마지막으로 기록한 AU의 클라이언트 순번 */
+    int      has_seq;         /* last_seq가 유효함 (순번 없는 AU를 기록하면 0) */
+} es_seg_t;
+
+static es_seg_t g_es[FA_MAX_CLIENTS];
+static int      g_es_victim;
+
+/**
+ * @brief 페이로드가 Annex-B 시작 코드(00 00 01 / 00 00 00 01)로 시작하면 H.264 AU로 봅니다. (JPEG은 FF D8)
+ */
+static int is_h264_au(const uint8_t* p, size_t len){
+    return len >= 4 && p[0] == 0 && p[1] == 0 && (p[2] == 1 || (p[2] == 0 && p[3] == 1));
+}
+
+/**
+ * @brief AU 레코드(FF 'M' 'P' 'A' + varint 순번 + Annex-B AU)이면 순번과 헤더 길이를 채웁니다.
+ */
+static int au_rec_parse(const uint8_t* p, size_t len, uint64_t* seq, size_t* hl){
+    if (len < 5 || p[0] != 0xFF || p[1] != 'M' || p[2] != 'P' || p[3] != 'A') return 0;
+    size_t n = quic_varint_decode(p + 4, len - 4, seq);
+    if (n == 0 || !is_h264_au(p + 4 + n, len - 4 - n)) return 0;
+    *hl = 4 + n;
+    return 1;
+}
+
+/**
+ * @brief AU에 IDR 슬라이스(5) 또는 SPS(7)가 있으면 키프레임입니다. 비IDR 슬라이스(1)를 만나면 중단합니다.
+ */
+static int h264_au_is_key(const uint8_t* p, size_t len){
+    for (size_t i = 0; i + 3 < len; i++) {
+        if (p[i] != 0 || p[i + 1] != 0 || p[i + 2] != 1) continue;
+        uint8_t t = p[i + 3] & 0x1F;
+        if (t == 5 || t == 7) return 1;
+        if (t == 1) return 0;
+        i += 2;
+    }
+    return 0;
+}
+
+static void es_seg_close(es_seg_t* s){
+    if (s->fd >= 0) {
+        char part[64], dst[64];
+        snprintf(part, sizeof(part), "gop_%06" PRIu64 ".h264.part", s->idx);
+        snprintf(dst,  sizeof(dst),  "gop_%06" PRIu64 ".h264",      s->idx);
+        close(s->fd);
+        renameat(s->dfd, part, s->dfd, dst);
+    }
+    if (s->dfd >= 0) close(s->dfd);
+    s->fd = s->dfd = -1;
+}
+
+static es_seg_t* es_seg_get(const char* tag){
+    for (int i = 0; i < FA_MAX_CLIENTS; i++) {
+        if (g_es[i].in_use && strcmp(g_es[i].tag, tag) == 0) return &g_es[i];
+    }
+    es_seg_t* s = NULL;
+    for (int i = 0; i < FA_MAX_CLIENTS && !s; i++) {
+        if (!g_es[i].in_use) s = &g_es[i];
+    }
+    if (!s) {
+        s = &g_es[g_es_victim];
+        g_es_victim = (g_es_victim + 1) % FA_MAX_CLIENTS;
+        es_seg_close(s);
+    }
+    memset(s, 0, sizeof(*s));
+    s->in_use = 1;
+    s->fd = s->dfd = -1;
+    snprintf(s->tag, sizeof(s->tag), "%s", tag);
+    return s;
+}
+
+/**
+ * @brief H.264 AU 하나를 클라이언트 세그먼트에 이어 씁니다.
+ * @param has_seq 0이면 순번 없는 AU (순번 검사 없이 도착 순서대로 기록)
+ * @return 기록 시 0, 키프레임 전이거나 순번이 어긋나 버리면 1, 오류 시 -1
+ */
+static int es_store(app_ctx_t* app, const char* tag, uint64_t idx, time_t ts,
+                    const uint8_t* buf, size_t len, uint64_t seq, int has_seq)
+{
+    if (!tag || !*tag) tag = "unknown";
+    int key = h264_au_is_key(buf, len);
+
+    pthread_mutex_lock(&g_dirs_m);
+
+    int rc = -1;
+    es_seg_t* s = es_seg_get(tag);
+
+    if (key) {
+        /* 새 GOP: 이전 세그먼트를 확정하고 현재 시간 버킷에 새로 시작 */
+        es_seg_close(s);
+        int dfd = dir_for_frame(app, tag, ts);
+        s->dfd = (dfd >= 0) ? dup(dfd) : -1;
+        if (s->dfd >= 0) {
+            char part[64];
+            snprintf(part, sizeof(part), "gop_%06" PRIu64 ".h264.part", idx);
+            s->fd = openat(s->dfd, part, O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+            s->idx = idx;
+            if (s->fd >= 0) app->h264_segments++;
+        }
+        if (s->fd < 0) LOG_WRN("[SAVE] cannot start h264 segment for client=%s", tag);
+    } else if (s->fd >= 0 && has_seq && s->has_seq && seq != s->last_seq + 1) {
+        if (seq > s->last_seq) {
+            /* 중간 AU가 빠짐: 디코딩 가능한 앞부분만 확정하고 다음 키프레임까지 버림 */
+            LOG_WRN("[H264] AU gap: client=%s seq=%" PRIu64 " expected=%" PRIu64 " (wait for IDR)",
+                    tag, seq, s->last_seq + 1);
+            app->h264_gaps++;
+            es_seg_close(s);
+        }
+        pthread_mutex_unlock(&g_dirs_m);
+        return 1;
+    }
+
+    if (s->fd < 0) {
+        rc = key ? -1 : 1;    /* 참조할 키프레임이 없는 AU는 디코딩할 수 없으므로 버림 */
+    } else if (write_all(s->fd, buf, len) == 0) {
+        s->last_seq = seq;
+        s->has_seq  = has_seq;
+        rc = 0;
+    } else {
+        LOG_WRN("[SAVE] h264 segment write failed: client=%s", tag);
+        es_seg_close(s);
+    }
+
+    pthread_mutex_unlock(&g_dirs_m);
+    return rc;
+}
+
+/**
+ * @brief 클라이언트의 세그먼트를 .h264로 확정하고 슬롯을 비웁니다. (tag가 NULL이면 전부)
+ */
+static void es_close_tag(const char* tag){
+    pthread_mutex_lock(&g_dirs_m);
+    for (int i = 0; i < FA_MAX_CLIENTS; i++) {
+        if (!g_es[i].in_use || (tag && strcmp(g_es[i].tag, tag) != 0)) continue;
+        es_seg_close(&g_es[i]);
+        g_es[i].in_use = 0;
+    }
+    pthread_mutex_unlock(&g_dirs_m);
+}
+
+
+/* ============================================================
+ * [7] 계층형 저장소 (Tier-0 tmpfs 착륙 → Tier-1 디스크 이전)
+ * ============================================================ */
+
+#ifndef TIER_Q_MAX
+#  define TIER_Q_MAX 16384                     /* 착륙 구역에 대기 가능한 최대 프레임 수 */
+#endif
+#ifndef TIER_BATCH
+#  define TIER_BATCH 64                        /* mover가 한 번에 이전할 최대 프레임 수 */
+#endif
+#ifndef TIER_HIGH_WM_PCT
+#  define TIER_HIGH_WM_PCT 75                  /* 이 점유율을 넘으면 속도 제한 해제 */
+#endif
+#ifndef TIER_LOG_US
+#  define TIER_LOG_US (5 * 1000000ULL)         /* 점유율 로그 주기 */
+#endif
+#ifndef TIER_RETRY_BASE_US
+#  define TIER_RETRY_BASE_US 100000ULL         /* 이전 실패 후 첫 재시도 지연 (실패마다 2배) */
+#endif
+#ifndef TIER_RETRY_MAX_US
+#  define TIER_RETRY_MAX_US (5 * 1000000ULL)   /* 재시도 지연 상한 */
+#endif
+#ifndef TIER_RETRY_LIMIT
+#  define TIER_RETRY_LIMIT 8                   /* 이만큼 실패하면 다음 기동 시 복구에 맡김 */
+#endif
+
+/**
+ * @brief 착륙 구역(tmpfs)에 올라가 이전을 기다리는 프레임입니다.
+ */
+typedef struct {
+    char     tag[FA_TAG_MAX];
+    uint64_t idx;
+    size_t   len;
+    time_t   ts;              /* 도착 시각 (영구 저장소 시간 버킷 결정용) */
+    unsigned tries;           /* 이전 실패 횟수 */
+    uint64_t retry_us;        /* 재시도 가능 시각 (mono_us, 0이면 바로) */
+} tier_ent_t;
+
+typedef struct {
+    tier_ent_t q[TIER_Q_MAX];
+    int h, t, n;
+    app_ctx_t* app;
+    int stage_fd;             /* app->stage_dir */
+    pthread_mutex_t m;
+    pthread_cond_t cv;
+    int started;
+} tier_t;
+
+static tier_t g_tier = { .stage_fd = -1,
+                         .m = PTHREAD_MUTEX_INITIALIZER, .cv = PTHREAD_COND_INITIALIZER };
+
+static void* tier_mover(void*);
+
+static inline void tier_name(char* out, size_t cap, uint64_t idx, const char* tag){
+    snprintf(out, cap, "%06" PRIu64 "_%s.jpg", idx, tag);
+}
+
+/**
+ * @brief 이전 실행에서 옮기지 못하고 남은 착륙 파일을 다시 큐에 올립니다.
+ */
+static void tier_recover(void){
+    int dup_fd = dup(g_tier.stage_fd);
+    DIR* dir = (dup_fd >= 0) ? fdopendir(dup_fd) : NULL;
+    if (!dir) { if (dup_fd >= 0) close(dup_fd); return; }
+
+    struct dirent* de;
+    while ((de = readdir(dir)) != NULL && g_tier.n < TIER_Q_MAX) {
+        char* us = NULL;
+        uint64_t idx = strtoull(de->d_name, &us, 10);
+        size_t nl = strlen(de->d_name);
+        if (!us || *us != '_' || nl < 5 || strcmp(de->d_name + nl - 4, ".jpg") != 0) continue;
+
+        struct stat sb;
+        if (fstatat(g_tier.stage_fd, de->d_name, &sb, 0) != 0) continue;
+
+        tier_ent_t* e = &g_tier.q[g_tier.t];
+        size_t tl = (size_t)(de->d_name + nl - 4 - (us + 1));
+        if (tl >= sizeof(e->tag)) continue;
+        memcpy(e->tag, us + 1, tl);
+        e->tag[tl] = 0;
+        e->idx = idx;
+        e->len = (size_t)sb.st_size;
+        e->ts  = sb.st_mtime;
+        e->tries    = 0;
+        e->retry_us = 0;
+
+        g_tier.t = (g_tier.t + 1) % TIER_Q_MAX;
+        g_tier.n++;
+        g_tier.app->tier0_files++;
+        g_tier.app->tier0_bytes += e->len;
+        if (idx > g_tier.app->frame_idx) g_tier.app->frame_idx = idx;
+    }
+    closedir(dir);
+
+    if (g_tier.n > 0) {
+        LOG_INF("[TIER] recovered %d staged frames (%" PRIu64 " B)", g_tier.n, g_tier.app->tier0_bytes);
+    }
+}
+
+/**
+ * @brief 착륙 구역을 열고 mover 스레드를 시작합니다. (저장 워커에서 최초 1회)
+ */
+static int tier_enabled(app_ctx_t* app){
+    if (!app->stage_dir[0]) return 0;
+    if (g_tier.started) return g_tier.stage_fd >= 0;
+
+    g_tier.started = 1;
+    g_tier.app = app;
+
+    ensure_dir(app->stage_dir);
+    g_tier.stage_fd = open(app->stage_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (g_tier.stage_fd < 0) {
+        LOG_WRN("[TIER] cannot open stage dir %s, writing directly", app->stage_dir);
+        return 0;
+    }
+    tier_recover();
+
+    pthread_t th;
+    if (pthread_create(&th, NULL, tier_mover, NULL) == 0) pthread_detach(th);
+
+    LOG_INF("[TIER] stage=%s max=%" PRIu64 "B rate=%" PRIu64 "B/s",
+            app->stage_dir, app->stage_max_bytes, app->mover_rate_bps);
+    return 1;
+}
+
+/**
+ * @brief 프레임을 착륙 구역에 기록합니다. 공간이 없으면 -1 (호출자가 직접 기록).
+ */
+static int tier_land(app_ctx_t* app, const char* tag, uint64_t idx, time_t ts,
+                     const uint8_t* buf, size_t len)
+{
+    pthread_mutex_lock(&g_tier.m);
+    int room = (g_tier.n < TIER_Q_MAX) &&
+               (app->tier0_bytes + len <= app->stage_max_bytes);
+    if (room) app->tier0_bytes += len;   /* 기록 전에 공간 예약 */
+    pthread_mutex_unlock(&g_tier.m);
+    if (!room) return -1;
+
+    char name[96];
+    tier_name(name, sizeof(name), idx, tag);
+
+    int fd = openat(g_tier.stage_fd, name, O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+    int wr = (fd >= 0) ? write_all(fd, buf, len) : -1;
+    if (fd >= 0) close(fd);
+
+    pthread_mutex_lock(&g_tier.m);
+    if (wr != 0) {
+        app->tier0_bytes -= len;
+        pthread_mutex_unlock(&g_tier.m);
+        unlinkat(g_tier.stage_fd, name, 0);
+        return -1;
+    }
+
+    tier_ent_t* e = &g_tier.q[g_tier.t];
+    snprintf(e->tag, sizeof(e->tag), "%s", tag);
+    e->idx = idx;
+    e->len = len;
+    e->ts  = ts;
+    e->tries    = 0;
+    e->retry_us = 0;
+    g_tier.t = (g_tier.t + 1) % TIER_Q_MAX;
+    g_tier.n++;
+    app->tier0_files++;
+
+    pthread_cond_signal(&g_tier.cv);
+    pthread_mutex_unlock(&g_tier.m);
+    return 0;
+}
+
+/**
+ * @brief 착륙 구역의 프레임을 일괄로 영구 저장소에 옮기는 백그라운드 스레드입니다.
+ * 점유율이 고수위(HIGH_WM) 미만이면 mover_rate_bps로 속도를 제한해 디스크를
+ * 수신 경로와 나눠 쓰고, 넘으면 제한 없이 비웁니다.
+ * 이전에 실패한 프레임은 착륙 구역에 남긴 채(용량 유지) 지수 백오프로 큐 뒤에 다시 올리고,
+ * TIER_RETRY_LIMIT번 실패하면 다음 기동 시 복구(tier_recover)에 맡깁니다.
+ */
+static void* tier_mover(void* arg){
+    (void)arg;
+    app_ctx_t* app = g_tier.app;
+    tier_ent_t batch[TIER_BATCH];
+    uint64_t next_ok_us = mono_us();
+    uint64_t last_log_us = 0;
+
+    for (;;) {
+        int k = 0;
+
+        /* 1) 이전할 프레임을 일괄로 꺼내기 (용량은 이전 완료 후 반환) */
+        pthread_mutex_lock(&g_tier.m);
+        for (;;) {
+            while (g_tier.n == 0) {
+                pthread_cond_wait(&g_tier.cv, &g_tier.m);
+            }
+            uint64_t now = mono_us();
+            while (g_tier.n > 0 && k < TIER_BATCH && g_tier.q[g_tier.h].retry_us <= now) {
+                batch[k++] = g_tier.q[g_tier.h];
+                g_tier.h = (g_tier.h + 1) % TIER_Q_MAX;
+                g_tier.n--;
+            }
+            if (k > 0) break;
+
+            /* 맨 앞 프레임이 재시도 대기 중: 도착 순서를 지키도록 그 시각까지 대기 */
+            uint64_t wait_us = g_tier.q[g_tier.h].retry_us - now;
+            struct timespec dl;
+            clock_gettime(CLOCK_REALTIME, &dl);
+            dl.tv_sec  += (time_t)(wait_us / 1000000ULL);
+            dl.tv_nsec += (long)(wait_us % 1000000ULL) * 1000L;
+            dl.tv_sec  += dl.tv_nsec / 1000000000L;
+            dl.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&g_tier.cv, &g_tier.m, &dl);
+        }
+        pthread_mutex_unlock(&g_tier.m);
+
+        /* 2) 도착 순서대로 연속 기록 */
+        for (int i = 0; i < k; i++) {
+            tier_ent_t* e = &batch[i];
+            char name[96];
+            tier_name(name, sizeof(name), e->idx, e->tag);
+
+            int src = openat(g_tier.stage_fd, name, O_RDONLY | O_CLOEXEC);
+            int rc = (src >= 0) ? durable_store(app, e->tag, e->idx, e->ts, NULL, src, e->len) : -1;
+            if (src >= 0) close(src);
+
+            /* 영구 저장소 오류면 착륙 파일이 그대로 남으므로 용량도 그대로 둠 */
+            int staged = (rc != 0 && src >= 0);
+            if (rc == 0) {
+                unlinkat(g_tier.stage_fd, name, 0);
+            } else if (!staged) {
+                LOG_WRN("[TIER] staged frame missing: %s", name);
+            }
+
+            pthread_mutex_lock(&g_tier.m);
+            if (!staged) {
+                app->tier0_bytes -= e->len;
+                app->tier0_files--;
+            }
+            if (rc == 0) {
+                app->tier_moved_frames++;
+                app->tier_moved_bytes += e->len;
+            } else if (staged && e->tries + 1 < TIER_RETRY_LIMIT && g_tier.n < TIER_Q_MAX) {
+                uint64_t backoff = TIER_RETRY_BASE_US << e->tries;
+                if (backoff > TIER_RETRY_MAX_US) backoff = TIER_RETRY_MAX_US;
+                e->tries++;
+                e->retry_us = mono_us() + backoff;
+                g_tier.q[g_tier.t] = *e;
+                g_tier.t = (g_tier.t + 1) % TIER_Q_MAX;
+                g_tier.n++;
+                LOG_WRN("[TIER] migrate failed: %s (retry %u in %" PRIu64 "ms)", name, e->tries, backoff / 1000);
+            } else if (staged) {
+                LOG_WRN("[TIER] migrate failed: %s (giving up, left for recovery on restart)", name);
+            }
+            uint64_t occ_pct = app->stage_max_bytes ? app->tier0_bytes * 100 / app->stage_max_bytes : 0;
+            pthread_mutex_unlock(&g_tier.m);
+
+            /* 3) 스로틀: 고수위 미만일 때만 토큰 버킷 방식으로 속도 제한 */
+            uint64_t now = mono_us();
+            if (app->mover_rate_bps > 0 && occ_pct < TIER_HIGH_WM_PCT) {
+                if (next_ok_us < now) next_ok_us = now;
+                next_ok_us += (uint64_t)e->len * 1000000ULL / app->mover_rate_bps;
+                if (next_ok_us > now) usleep((useconds_t)(next_ok_us - now));
+            } else {
+                next_ok_us = now;
+            }
+        }
+
+        uint64_t now = mono_us();
+        if (now - last_log_us > TIER_LOG_US) {
+            LOG_INF("[TIER] t0=%" PRIu64 "/%" PRIu64 "B files=%" PRIu64
+                    " moved=%" PRIu64 " direct=%" PRIu64,
+                    app->tier0_bytes, app->stage_max_bytes, app->tier0_files,
+                    app->tier_moved_frames, app->tier_direct_frames);
+            last_log_us = now;
+        }
+    }
+    return NULL;
+}
+
+
+/* ============================================================
+ * [8] 디스크 저장 워커 로직
  * ============================================================ */
 
 static void* save_worker(void* arg){
@@ -135,48 +970,73 @@ static void* save_worker(void* arg){
     for(;;){
         int k = 0;
 
-        /* 1) 큐에서 일괄(Batch)로 작업 뽑기 */
+        /* 1) 클라이언트별 큐에서 DRR로 일괄(Batch) 작업 뽑기 */
         pthread_mutex_lock(&g_saveq.m);
-        while (g_saveq.n == 0) {
-            pthread_cond_wait(&g_saveq.cv, &g_saveq.m);
-        }
+        for (;;) {
+            while (g_saveq.n == 0) {
+                pthread_cond_wait(&g_saveq.cv, &g_saveq.m);
+            }
 
-        while (g_saveq.n > 0 && k < SAVE_POP_BATCH) {
-            batch[k++] = g_saveq.q[g_saveq.h];
-            g_saveq.h = (g_saveq.h + 1) % SAVEQ_MAX;
-            g_saveq.n--;
+            uint64_t wait_us = 0;
+            k = saveq_pop_drr(batch, SAVE_POP_BATCH, &wait_us);
+            if (k > 0) break;
+
+            /* 대기 중인 클라이언트가 모두 속도 제한에 걸림: 토큰이 찰 때까지 대기 */
+            if (wait_us == 0 || wait_us > 100000) wait_us = 100000;
+            struct timespec dl;
+            clock_gettime(CLOCK_REALTIME, &dl);
+            dl.tv_nsec += (long)wait_us * 1000L;
+            dl.tv_sec  += dl.tv_nsec / 1000000000L;
+            dl.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&g_saveq.cv, &g_saveq.m, &dl);
         }
         pthread_mutex_unlock(&g_saveq.m);
 
-        /* 2) 뽑힌 작업들을 디스크에 순차 기록 */
+        /* 2) 뽑힌 작업들을 순차 기록 (착륙 구역 우선, 가득 차면 직접 기록) */
+        time_t now = time(NULL);
+
         for (int i = 0; i < k; i++) {
             save_job_t job = batch[i];
 
+            if (!job.buf && job.len == 0) {
+                /* 연결 종료 표식: 앞서 쌓인 AU를 모두 기록한 뒤 세그먼트 확정 */
+                es_close_tag(job.tag);
+                continue;
+            }
             if (!job.app || !job.buf || job.len == 0) {
                 if (job.buf) free(job.buf);
                 continue;
             }
 
-            ensure_dir(job.app->out_dir);
-
-            int idx = job.app->frame_count + 1;
-            char tmp[512], dst[512];
-
-            /* 원자적 저장을 위해 .part 파일로 쓰고 rename 수행 */
-            snprintf(tmp, sizeof(tmp), "%s/frame_%06d.part", job.app->out_dir, idx);
-            snprintf(dst, sizeof(dst), "%s/frame_%06d.jpg",  job.app->out_dir, idx);
-
-            FILE* f = fopen(tmp, "wb");
-            if (!f) {
-                free(job.buf);
-                continue;
+            /* 착륙 구역 초기화(복구 포함)는 번호 할당 전에 끝나야 함 */
+            int tiered = tier_enabled(job.app);
+
+            /* 번호는 64비트로 증가만 하므로 랩어라운드 없음 */
+            uint64_t idx = job.app->frame_idx + 1;
+            int rc = -1;
+
+            uint64_t au_seq = 0;
+            size_t   au_hl  = 0;
+            int      au_rec = au_rec_parse(job.buf, job.len, &au_seq, &au_hl);
+
+            if (au_rec || is_h264_au(job.buf, job.len)) {
+                /* H.264 AU: 순서가 중요하므로 착륙 구역을 거치지 않고 세그먼트에 바로 이어 씀 (AU 헤더는 떼고 기록) */
+                rc = es_store(job.app, job.tag, idx, now, job.buf + au_hl, job.len - au_hl, au_seq, au_rec);
+                if (rc == 0) job.app->h264_aus++;
+                if (rc == 1) job.app->h264_dropped++;
+            } else if (tiered) {
+                rc = tier_land(job.app, job.tag, idx, now, job.buf, job.len);
+                if (rc != 0) {
+                    rc = durable_store(job.app, job.tag, idx, now, job.buf, -1, job.len);
+                    if (rc == 0) job.app->tier_direct_frames++;
+                }
+            } else {
+                rc = durable_store(job.app, job.tag, idx, now, job.buf, -1, job.len);
             }
 
-            size_t w = fwrite(job.buf, 1, job.len, f);
-            fclose(f);
-
-            if (w == job.len && rename(tmp, dst) == 0) {
-                job.app->frame_count = idx;
+            if (rc == 0) {
+                job.app->frame_idx = idx;
+                job.app->frame_count++;
                 job.app->bytes_saved_total += job.len;
             }
             free(job.buf);
@@ -186,25 +1046,42 @@ static void* save_worker(void* arg){
 }
 
 /**
- * @brief 버퍼의 소유권을 가져와 저장 큐에 추가합니다.
+ * @brief 버퍼의 소유권을 가져와 해당 클라이언트의 저장 큐에 추가합니다.
+ * buf가 NULL이고 len이 0이면 연결 종료 표식으로, 저장 워커가 그 자리에서 H.264 세그먼트를 확정합니다.
  */
-static int saveq_push_take(app_ctx_t* app, uint8_t* buf, size_t len){
+static int saveq_push_take(app_ctx_t* app, uint8_t* buf, size_t len, const char* tag){
     if (!g_saveq.inited) pthread_once(&g_once, saveq_init_once);
+    if (!tag || !*tag) tag = "unknown";
 
     pthread_mutex_lock(&g_saveq.m);
-    
-    /* 큐가 가득 찼다면 가장 오래된 데이터 드랍 */
-    if (g_saveq.n == SAVEQ_MAX) {
-        save_job_t old = g_saveq.q[g_saveq.h];
-        g_saveq.h = (g_saveq.h + 1) % SAVEQ_MAX;
-        g_saveq.n--;
-        if (old.buf) free(old.buf);
+
+    client_q_t* c = cq_get(app, tag);
+    if (!c) {
+        /* 모든 슬롯이 대기 중인 다른 클라이언트로 차 있음 */
+        g_saveq.drop_noslot++;
+        pthread_mutex_unlock(&g_saveq.m);
+        free(buf);
+        return -1;
     }
 
-    g_saveq.q[g_saveq.t] = (save_job_t){app, buf, len};
-    g_saveq.t = (g_saveq.t + 1) % SAVEQ_MAX;
-    g_saveq.n++;
-    
+    /* 작업 풀이 가득 찼다면 가장 무거운 송신자의 가장 오래된 데이터 드랍 */
+    if (g_saveq.free_head < 0) cq_drop_heaviest();
+
+    int ni = g_saveq.free_head;
+    g_saveq.free_head = g_saveq.node[ni].next;
+
+    save_job_t* job = &g_saveq.node[ni].job;
+    job->app = app;
+    job->buf = buf;
+    job->len = len;
+    snprintf(job->tag, sizeof(job->tag), "%s", tag);
+
+    cq_push(c, ni);
+    c->st.queued_frames = c->n;
+    c->st.queued_bytes  = c->bytes;
+    c->st.enq_frames++;
+    c->st.enq_bytes += len;
+
     pthread_cond_signal(&g_saveq.cv);
     pthread_mutex_unlock(&g_saveq.m);
     return 0;
@@ -217,18 +1094,106 @@ int save_frame(app_ctx_t* app, const uint8_t* data, size_t len){
     uint8_t* cp = malloc(len);
     if (!cp) return -1;
     memcpy(cp, data, len);
-    return saveq_push_take(app, cp, len);
+    return saveq_push_take(app, cp, len, NULL);
 }
 
-static int save_frame_take(app_ctx_t* app, uint8_t* take, size_t len){
+static int save_frame_take(app_ctx_t* app, uint8_t* take, size_t len, const char* tag){
     if (!app || !take || len == 0) return -1;
     maybe_start_worker();
-    return saveq_push_take(app, take, len);
+    return saveq_push_take(app, take, len, tag);
+}
+
+void fa_set_client_rate(const char* tag, uint64_t bps){
+    if (!tag || !*tag) return;
+    if (!g_saveq.inited) pthread_once(&g_once, saveq_init_once);
+
+    pthread_mutex_lock(&g_saveq.m);
+
+    rate_ovr_t* o = NULL;
+    for (int i = 0; i < g_rate_ovr_n; i++) {
+        if (strcmp(g_rate_ovr[i].tag, tag) == 0) { o = &g_rate_ovr[i]; break; }
+    }
+    if (!o && g_rate_ovr_n < FA_MAX_CLIENTS) o = &g_rate_ovr[g_rate_ovr_n++];
+    if (o) {
+        snprintf(o->tag, sizeof(o->tag), "%s", tag);
+        o->bps = bps;
+    }
+
+    /* 이미 활성화된 클라이언트에도 즉시 반영 */
+    for (int i = 0; i < FA_MAX_CLIENTS; i++) {
+        if (g_saveq.cq[i].in_use && strcmp(g_saveq.cq[i].tag, tag) == 0) {
+            g_saveq.cq[i].rate_bps = bps;
+        }
+    }
+    pthread_mutex_unlock(&g_saveq.m);
+}
+
+int fa_client_stats(fa_client_stat_t* out, int max){
+    if (!out || max <= 0 || !g_saveq.inited) return 0;
+
+    int k = 0;
+    pthread_mutex_lock(&g_saveq.m);
+    for (int i = 0; i < FA_MAX_CLIENTS && k < max; i++) {
+        client_q_t* c = &g_saveq.cq[i];
+        if (!c->in_use) continue;
+        c->st.queued_frames = c->n;
+        c->st.queued_bytes  = c->bytes;
+        out[k++] = c->st;
+    }
+    pthread_mutex_unlock(&g_saveq.m);
+    return k;
 }
 
 
 /* ============================================================
- * [5] 수신 스트림 상태 관리
+ * [9] 연결별 클라이언트 태그
+ * ============================================================ */
+
+typedef struct {
+    picoquic_cnx_t* cnx;
+    char tag[FA_TAG_MAX];
+} fa_client_t;
+
+static fa_client_t g_clients[FA_MAX_CLIENTS];
+static int g_client_victim;
+
+/**
+ * @brief 연결의 클라이언트 태그(최초 피어 IP)를 반환합니다.
+ * 멀티패스로 피어 주소가 바뀌어도 연결이 유지되는 동안 같은 디렉토리를 씁니다.
+ * 항목은 연결이 닫힐 때(fa_cnx_close) 비우므로, 같은 주소에 새 연결이 생겨도 이전 태그를 물려받지 않습니다.
+ */
+static const char* fa_client_tag(picoquic_cnx_t* cnx){
+    if (!cnx) return "unknown";
+
+    for (int i = 0; i < FA_MAX_CLIENTS; i++) {
+        if (g_clients[i].cnx == cnx) return g_clients[i].tag;
+    }
+
+    fa_client_t* c = NULL;
+    for (int i = 0; i < FA_MAX_CLIENTS && !c; i++) {
+        if (!g_clients[i].cnx) c = &g_clients[i];
+    }
+    if (!c) {
+        c = &g_clients[g_client_victim];
+        g_client_victim = (g_client_victim + 1) % FA_MAX_CLIENTS;
+    }
+
+    c->cnx = cnx;
+    snprintf(c->tag, sizeof(c->tag), "unknown");
+
+    struct sockaddr* sa = NULL;
+    picoquic_get_peer_addr(cnx, &sa);
+    if (sa && sa->sa_family == AF_INET) {
+        inet_ntop(AF_INET, &((struct sockaddr_in*)sa)->sin_addr, c->tag, sizeof(c->tag));
+    } else if (sa && sa->sa_family == AF_INET6) {
+        inet_ntop(AF_INET6, &((struct sockaddr_in6*)sa)->sin6_addr, c->tag, sizeof(c->tag));
+    }
+    return c->tag;
+}
+
+
+/* ============================================================
+ * [10] 수신 스트림 상태 관리
  * ============================================================ */
 
 void rx_clear(rx_stream_t* rx){
@@ -240,17 +1205,31 @@ void rx_clear(rx_stream_t* rx){
     rx->last_b = 0;
 }
 
+/* 스트림 ID의 순번(sid >> 2)에서 탐색을 시작: 프레임별 스트림처럼 ID가 계속 바뀌어도 보통 첫 슬롯에서 찾음 */
+static inline int rx_home(uint64_t sid){
+    return (int)((sid >> 2) % MAX_STREAMS);
+}
+
+static rx_stream_t* rx_find(uint64_t sid){
+    int h = rx_home(sid);
+    for (int j = 0; j < MAX_STREAMS; j++){
+        rx_stream_t* rx = &g_bank.rx[(h + j) % MAX_STREAMS];
+        if (rx->in_use && rx->sid == sid) return rx;
+    }
+    return NULL;
+}
+
 static rx_stream_t* rx_get(app_ctx_t* app, uint64_t sid){
     (void)app;
     /* 기존 사용 중인 스트림 찾기 */
-    for (int i = 0; i < MAX_STREAMS; i++){
-        if (g_bank.rx[i].in_use && g_bank.rx[i].sid == sid)
-            return &g_bank.rx[i];
-    }
+    rx_stream_t* rx = rx_find(sid);
+    if (rx) return rx;
+
     /* 빈 슬롯에 새 스트림 등록 */
-    for (int i = 0; i < MAX_STREAMS; i++){
-        if (!g_bank.rx[i].in_use){
-            rx_stream_t* rx = &g_bank.rx[i];
+    int h = rx_home(sid);
+    for (int j = 0; j < MAX_STREAMS; j++){
+        rx = &g_bank.rx[(h + j) % MAX_STREAMS];
+        if (!rx->in_use){
             memset(rx, 0, sizeof(*rx));
             rx->in_use = 1;
             rx->sid = sid;
@@ -280,7 +1259,7 @@ static int ensure_cap(rx_stream_t* rx, size_t need){
 
 
 /* ============================================================
- * [6] QUIC VarInt 디코딩
+ * [11] QUIC VarInt 디코딩
  * ============================================================ */
 
 static size_t quic_varint_decode(const uint8_t* in, size_t len, uint64_t* v){
@@ -314,7 +1293,149 @@ static size_t quic_varint_decode(const uint8_t* in, size_t len, uint64_t* v){
 
 
 /* ============================================================
- * [7] 프레임 조립 로직 (FSM)
+ * [12] 스트라이프 재조립 (여러 경로로 나뉜 프레임)
+ * ============================================================ */
+
+/*
+ * 클라이언트 스트라이핑 모드는 한 프레임을 여러 경로 스트림으로 나눠 보냅니다. 각 조각 레코드는
+ *     [FF 'M' 'P' 'S'][varint 프레임 id][varint 전체 길이][varint 오프셋][조각]
+ * 이며, (연결, 프레임 id)별 슬롯에 오프셋대로 모아 다 차면 일반 프레임처럼 저장 큐에 넣습니다.
+ * 조각이 reset/기한 초과로 끝내 오지 않는 프레임은 슬롯이 모자라거나 FA_STRIPE_TTL_US가 지나면 버립니다.
+ * 중복 전송 모드의 사본은 조각 하나짜리 레코드라 먼저 온 쪽이 프레임을 완성하고, 최근 완성한
+ * (연결, 프레임 id)를 기억해 두었다가 늦게 온 사본은 버립니다.
+ */
+
+#ifndef FA_STRIPE_SLOTS
+#  define FA_STRIPE_SLOTS 32
+#endif
+#define FA_STRIPE_PARTS  16                 /* 프레임당 조각 수 상한 (중복 조각 판별용) */
+#define FA_STRIPE_TTL_US 2000000ULL
+#define FA_STRIPE_DONE   64                 /* 최근 완성한 프레임 기록 (늦게 온 중복 사본 판별용) */
+
+typedef struct {
+    int            in_use;
+    picoquic_cnx_t* cnx;
+    uint64_t       fid;
+    uint64_t       total, got;
+    uint8_t*       buf;
+    uint64_t       offs[FA_STRIPE_PARTS];   /* 받은 조각 오프셋 */
+    int            nparts;
+    uint64_t       born_us;
+} stripe_slot_t;
+
+static stripe_slot_t g_stripe[FA_STRIPE_SLOTS];
+
+static struct { picoquic_cnx_t* cnx; uint64_t fid; } g_stripe_done[FA_STRIPE_DONE];
+static int g_stripe_done_pos;
+
+static int stripe_done_has(picoquic_cnx_t* cnx, uint64_t fid){
+    for (int i = 0; i < FA_STRIPE_DONE; i++){
+        if (g_stripe_done[i].cnx == cnx && g_stripe_done[i].fid == fid) return 1;
+    }
+    return 0;
+}
+
+static void stripe_done_add(picoquic_cnx_t* cnx, uint64_t fid){
+    g_stripe_done[g_stripe_done_pos].cnx = cnx;
+    g_stripe_done[g_stripe_done_pos].fid = fid;
+    g_stripe_done_pos = (g_stripe_done_pos + 1) % FA_STRIPE_DONE;
+}
+
+static int is_stripe_rec(const uint8_t* p, size_t len){
+    return len >= 4 && p[0] == 0xFF && p[1] == 'M' && p[2] == 'P' && p[3] == 'S';
+}
+
+static void stripe_drop(app_ctx_t* app, stripe_slot_t* s){
+    if (app) app->stripe_dropped++;
+    free(s->buf);
+    memset(s, 0, sizeof(*s));
+}
+
+static stripe_slot_t* stripe_get(app_ctx_t* app, picoquic_cnx_t* cnx, uint64_t fid, uint64_t total){
+    stripe_slot_t* free_s = NULL;
+    stripe_slot_t* oldest = NULL;
+    uint64_t now = mono_us();
+
+    for (int i = 0; i < FA_STRIPE_SLOTS; i++){
+        stripe_slot_t* s = &g_stripe[i];
+        if (s->in_use && s->cnx == cnx && s->fid == fid) return s;
+        if (s->in_use && now - s->born_us > FA_STRIPE_TTL_US) stripe_drop(app, s);
+        if (!s->in_use) { if (!free_s) free_s = s; continue; }
+        if (!oldest || s->born_us < oldest->born_us) oldest = s;
+    }
+    if (!free_s){
+        stripe_drop(app, oldest);
+        free_s = oldest;
+    }
+
+    uint8_t* buf = malloc(total);
+    if (!buf) return NULL;
+    free_s->in_use  = 1;
+    free_s->cnx     = cnx;
+    free_s->fid     = fid;
+    free_s->total   = total;
+    free_s->buf     = buf;
+    free_s->born_us = now;
+    return free_s;
+}
+
+/**
+ * @brief 완성된 레코드가 스트라이프 조각이면 재조립합니다. (rec의 소유권을 가져감)
+ * @return 1 조각으로 처리함, 0 일반 프레임
+ */
+static int stripe_on_rec(picoquic_cnx_t* cnx, app_ctx_t* app, uint8_t* rec, size_t len){
+    if (!is_stripe_rec(rec, len)) return 0;
+
+    uint64_t fid = 0, total = 0, off = 0;
+    size_t   p = 4, u;
+    uint64_t* fields[3] = { &fid, &total, &off };
+    for (int i = 0; i < 3; i++){
+        if ((u = quic_varint_decode(rec + p, len - p, fields[i])) == 0) goto bad;
+        p += u;
+    }
+
+    size_t clen = len - p;
+    if (total == 0 || total > MAX_FRAME_SIZE || off > total || clen > total - off) goto bad;
+
+    /* 이미 완성한 프레임의 사본 (중복 전송) */
+    if (stripe_done_has(cnx, fid)){
+        if (app) app->dup_dropped++;
+        free(rec);
+        return 1;
+    }
+
+    stripe_slot_t* s = stripe_get(app, cnx, fid, total);
+    if (!s || s->total != total) goto bad;
+
+    for (int i = 0; i < s->nparts; i++){
+        if (s->offs[i] == off) { free(rec); return 1; }   /* 중복 조각 */
+    }
+    if (s->nparts < FA_STRIPE_PARTS) s->offs[s->nparts++] = off;
+
+    memcpy(s->buf + off, rec + p, clen);
+    s->got += clen;
+    free(rec);
+    if (app) app->stripe_chunks++;
+
+    if (s->got >= s->total){
+        uint8_t* frame = s->buf;
+        size_t   flen  = (size_t)s->total;
+        memset(s, 0, sizeof(*s));
+        stripe_done_add(cnx, fid);
+        if (app) app->stripe_frames++;
+        save_frame_take(app, frame, flen, fa_client_tag(cnx));
+    }
+    return 1;
+
+bad:
+    if (app) app->stripe_dropped++;
+    free(rec);
+    return 1;
+}
+
+
+/* ============================================================
+ * [13] 프레임 조립 로직 (FSM)
  * ============================================================ */
 
 static int rx_try_parse_len(rx_stream_t* rx, const uint8_t** pp, const uint8_t* pmax){
@@ -378,21 +1499,71 @@ static inline void fc_bump(picoquic_cnx_t* cnx, uint64_t sid, uint64_t used){
 
 
 /* ============================================================
- * [8] 공개 API 구현
+ * [14] 공개 API 구현
  * ============================================================ */
 
 void fa_stream_close(app_ctx_t* app, uint64_t sid){
     (void)app;
-    for (int i = 0; i < MAX_STREAMS; i++){
-        rx_stream_t* rx = &g_bank.rx[i];
-        if (rx->in_use && rx->sid == sid){
-            if (rx->buf) free(rx->buf);
-            memset(rx, 0, sizeof(*rx));
-            return;
+    rx_stream_t* rx = rx_find(sid);
+    if (rx){
+        if (rx->buf) free(rx->buf);
+        memset(rx, 0, sizeof(*rx));
+    }
+}
+
+void fa_stream_fin(app_ctx_t* app, uint64_t sid){
+    rx_stream_t* rx = rx_find(sid);
+    if (app){
+        app->stream_fins++;
+        /* FIN이 프레임 경계: 길이 헤더나 페이로드를 덜 받은 채 끝났으면 그 프레임은 불완전 */
+        if (rx && (rx->len_got > 0 || (rx->st == RX_WANT_PAYLOAD && rx->received < rx->frame_size)))
+            app->fin_truncated++;
+    }
+    fa_stream_close(app, sid);
+}
+
+void fa_stream_reset(app_ctx_t* app, uint64_t sid){
+    rx_stream_t* rx = rx_find(sid);
+    if (app){
+        app->stream_resets++;
+        if (rx) app->reset_bytes += rx->received + rx->len_got;
+    }
+    fa_stream_close(app, sid);
+}
+
+void fa_cnx_close(app_ctx_t* app, picoquic_cnx_t* cnx){
+    if (!cnx) return;
+
+    /* 해제된 연결 포인터는 새 연결에 재사용될 수 있으므로 그 포인터로 찾는 항목을 모두 비움 */
+    char tag[FA_TAG_MAX] = "";
+    for (int i = 0; i < FA_MAX_CLIENTS; i++){
+        if (g_clients[i].cnx != cnx) continue;
+        snprintf(tag, sizeof(tag), "%s", g_clients[i].tag);
+        memset(&g_clients[i], 0, sizeof(g_clients[i]));
+    }
+
+    /* 마지막 GOP가 .part로 남지 않도록, 같은 태그의 다른 연결이 없으면 큐 뒤에 종료 표식을 넣음 */
+    int shared = 0;
+    for (int i = 0; i < FA_MAX_CLIENTS && tag[0]; i++){
+        if (g_clients[i].cnx && strcmp(g_clients[i].tag, tag) == 0) shared = 1;
+    }
+    if (tag[0] && !shared && g_saveq.started) saveq_push_take(app, NULL, 0, tag);
+
+    for (int i = 0; i < FA_STRIPE_SLOTS; i++){
+        if (g_stripe[i].in_use && g_stripe[i].cnx == cnx) stripe_drop(app, &g_stripe[i]);
+    }
+    for (int i = 0; i < FA_STRIPE_DONE; i++){
+        if (g_stripe_done[i].cnx == cnx) {
+            g_stripe_done[i].cnx = NULL;
+            g_stripe_done[i].fid = 0;
         }
     }
 }
 
+void fa_flush_segments(void){
+    es_close_tag(NULL);
+}
+
 void fa_reset(app_ctx_t* app){
     (void)app;
     for (int i = 0; i < MAX_STREAMS; i++){
@@ -485,7 +1656,8 @@ int fa_on_bytes(picoquic_cnx_t* cnx, app_ctx_t* app, uint64_t sid,
                 rx->cap = 0;
                 rx_clear(rx);
 
-                save_frame_take(app, stolen, slen);
+                if (!stripe_on_rec(cnx, app, stolen, slen))
+                    save_frame_take(app, stolen, slen, fa_client_tag(cnx));
                 frames++;
                 continue;
             }
@@ -515,7 +1687,7 @@ int fa_on_bytes(picoquic_cnx_t* cnx, app_ctx_t* app, uint64_t sid,
 
                     /* EOI (End of Image) 마커 탐색 */
                     if (rx->last_b == 0xFF && c == 0xD9){
-                        save_frame_take(app, rx->buf, rx->received);
+                        save_frame_take(app, rx->buf, rx->received, fa_client_tag(cnx));
                         rx->buf = NULL; 
                         rx->cap = 0;
                         rx_clear(rx);
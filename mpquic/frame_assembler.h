@@ -7,6 +7,29 @@
 #include "app_ctx.h"
 #include "picoquic_internal.h"
 
+#ifndef FA_MAX_CLIENTS
+#  define FA_MAX_CLIENTS 64   /* 동시에 추적할 클라이언트(연결) 수 */
+#endif
+#ifndef FA_TAG_MAX
+#  define FA_TAG_MAX 48       /* 클라이언트 태그(디렉토리 이름) 최대 길이 */
+#endif
+
+/**
+ * @brief 클라이언트별 저장 큐 통계입니다. (fa_client_stats로 조회)
+ */
+typedef struct {
+    char     tag[FA_TAG_MAX];  /* 클라이언트 태그 (최초 피어 IP) */
+    uint64_t queued_frames;    /* 현재 대기 중인 프레임 수 */
+    uint64_t queued_bytes;     /* 현재 대기 중인 바이트 */
+    uint64_t enq_frames;       /* 누적 입력 프레임 수 */
+    uint64_t enq_bytes;        /* 누적 입력 바이트 */
+    uint64_t written_frames;   /* 누적 기록(워커 전달) 프레임 수 */
+    uint64_t written_bytes;    /* 누적 기록(워커 전달) 바이트 */
+    uint64_t dropped_frames;   /* 과부하로 버려진 프레임 수 */
+    uint64_t dropped_bytes;    /* 과부하로 버려진 바이트 */
+} fa_client_stat_t;
+
+
 /* ============================================================
  * [1] 프레임 조립 및 처리 인터페이스
  * ============================================================ */
@@ -52,4 +75,56 @@ void rx_clear(rx_stream_t* rx);
  */
 void fa_stream_close(app_ctx_t* app, uint64_t sid);
 
+
+/**
+ * @brief 스트림 FIN 처리: 프레임 경계로 보고, 덜 받은 프레임이 남아 있으면 버린 뒤 슬롯을 반환합니다.
+ * * @param app 애플리케이션 컨텍스트
+ * @param sid 종료된 스트림 ID
+ */
+void fa_stream_fin(app_ctx_t* app, uint64_t sid);
+
+
+/**
+ * @brief 스트림 reset 처리: 조립 중이던 프레임을 저장하지 않고 버린 뒤 슬롯을 반환합니다.
+ * * @param app 애플리케이션 컨텍스트
+ * @param sid reset된 스트림 ID
+ */
+void fa_stream_reset(app_ctx_t* app, uint64_t sid);
+
+
+/**
+ * @brief 연결 종료 처리: 그 연결로 찾던 클라이언트 태그·스트라이프 재조립 상태를 비웁니다.
+ * (picoquic이 해제한 연결 주소를 새 연결에 다시 쓸 수 있으므로 close 콜백에서 반드시 호출)
+ * * @param app 애플리케이션 컨텍스트
+ * @param cnx 닫힌 연결
+ */
+void fa_cnx_close(app_ctx_t* app, picoquic_cnx_t* cnx);
+
+/**
+ * @brief 기록 중인 모든 H.264 세그먼트(.part)를 .h264로 확정합니다. (서버 종료 시 호출)
+ */
+void fa_flush_segments(void);
+
+
+
+/* ============================================================
+ * [3] 클라이언트별 공정 저장 (DRR)
+ * ============================================================ */
+
+/**
+ * @brief 특정 클라이언트의 디스크 기록 속도 제한을 설정합니다.
+ * * @param tag 클라이언트 태그 (피어 IP 문자열)
+ * @param bps 바이트/초 (0이면 무제한)
+ */
+void fa_set_client_rate(const char* tag, uint64_t bps);
+
+
+/**
+ * @brief 클라이언트별 저장 큐 통계를 복사합니다.
+ * * @param out 결과 배열
+ * @param max 배열 크기
+ * @return int 복사된 클라이언트 수
+ */
+int fa_client_stats(fa_client_stat_t* out, int max);
+
 #endif /* FRAME_ASSEMBLER_H */
\ No newline at end of file
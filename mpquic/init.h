@@ -1,6 +1,11 @@
 #ifndef INIT_H
 #define INIT_H
 
+/* fallocate / sync_file_range / O_DIRECT 등 GNU 확장 기능 활성화 */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 /* [표준 라이브러리 헤더] */
 #include <stdio.h>
 #include <stdlib.h>
@@ -29,6 +34,7 @@
 /* [프로젝트 내부 헤더] */
 #include "app_ctx.h"
 #include "frame_assembler.h"
+#include "quic_lb.h"
 
 /* ============================================================
  * [1] 시스템 설정 및 매크로
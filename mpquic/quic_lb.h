@@ -0,0 +1,133 @@
+#ifndef QUIC_LB_H
+#define QUIC_LB_H
+
+/*
+ * QUIC-LB (draft-ietf-quic-load-balancers) 평문(plaintext) CID 인코딩.
+ * 서버 프로세스(server_recv)와 참조 로드밸런서(quic_lb_proxy) 양쪽에서 공유하므로
+ * picoquic에 의존하지 않는 순수 C 코드만 둡니다.
+ *
+ *   CID = [first octet][server id (sid_len B)][nonce (nonce_len B)]
+ *   first octet = config rotation(상위 3비트) | CID 길이-1 (하위 5비트)
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/* ============================================================
+ * [1] 설정 상수 및 구조체
+ * ============================================================ */
+
+#define QLB_CID_MAX          20  /* QUIC v1 CID 최대 길이 */
+#define QLB_CONFIG_UNROUTED  7   /* config rotation 7 = 라우팅 불가 CID (클라이언트 선택 CID 등) */
+#define QLB_SID_LEN_DEFAULT  2   /* 서버 ID 길이 기본값 (B) */
+#define QLB_NONCE_LEN_DEFAULT 6  /* nonce 길이 기본값 (B, 최소 4) */
+#define QLB_NONCE_LEN_MIN    4
+
+/**
+ * @brief 인스턴스별 QUIC-LB 설정입니다. (로드밸런서와 모든 서버가 같은 config_id/sid_len 사용)
+ */
+typedef struct {
+    uint8_t  config_id;   /* config rotation (0~6) */
+    uint8_t  sid_len;     /* 서버 ID 길이 (1~8, 표준은 1~15지만 server_id가 uint64_t) */
+    uint8_t  nonce_len;   /* nonce 길이 (4~18) */
+    uint64_t server_id;   /* 이 인스턴스의 서버 ID */
+} qlb_cfg_t;
+
+
+/* ============================================================
+ * [2] 인코딩 / 디코딩
+ * ============================================================ */
+
+/**
+ * @brief 설정값을 검증합니다. 유효하면 0을 반환합니다.
+ */
+static inline int qlb_cfg_check(const qlb_cfg_t* c){
+    if (!c) return -1;
+    if (c->config_id >= QLB_CONFIG_UNROUTED) return -1;
+    if (c->sid_len < 1 || c->sid_len > 8) return -1;   /* server_id가 uint64_t이므로 8B까지 */
+    if (c->nonce_len < QLB_NONCE_LEN_MIN) return -1;
+    if (1u + c->sid_len + c->nonce_len > QLB_CID_MAX) return -1;
+    if (c->sid_len < 8 && (c->server_id >> (8 * c->sid_len)) != 0) return -1;
+    return 0;
+}
+
+/**
+ * @brief 설정에 따른 CID 전체 길이입니다.
+ */
+static inline size_t qlb_cid_len(const qlb_cfg_t* c){
+    return 1u + c->sid_len + c->nonce_len;
+}
+
+/**
+ * @brief 서버 ID를 담은 CID를 만듭니다.
+ * * @param c 설정
+ * @param nonce 무작위 바이트 (nonce_len 이상)
+ * @param out CID 출력 버퍼 (qlb_cid_len 이상)
+ * @return size_t 기록된 CID 길이
+ */
+static inline size_t qlb_encode(const qlb_cfg_t* c, const uint8_t* nonce, uint8_t* out){
+    size_t len = qlb_cid_len(c);
+
+    out[0] = (uint8_t)((c->config_id << 5) | ((len - 1) & 0x1f));
+    for (int i = 0; i < c->sid_len; i++) {
+        out[1 + i] = (uint8_t)(c->server_id >> (8 * (c->sid_len - 1 - i)));
+    }
+    memcpy(out + 1 + c->sid_len, nonce, c->nonce_len);
+    return len;
+}
+
+/**
+ * @brief CID에서 서버 ID를 꺼냅니다.
+ * config rotation이 일치하지 않거나 길이가 부족하면 -1 (해시 기반 폴백 대상)
+ */
+static inline int qlb_decode(const qlb_cfg_t* c, const uint8_t* cid, size_t len, uint64_t* sid){
+    if (len < 1u + c->sid_len) return -1;
+    if ((cid[0] >> 5) != c->config_id) return -1;
+
+    uint64_t v = 0;
+    for (int i = 0; i < c->sid_len; i++) v = (v << 8) | cid[1 + i];
+    *sid = v;
+    return 0;
+}
+
+
+/* ============================================================
+ * [3] 패킷 헤더에서 DCID 추출
+ * ============================================================ */
+
+/**
+ * @brief UDP 페이로드(QUIC 패킷)에서 목적지 CID 위치를 찾습니다.
+ * Short header는 CID 길이가 패킷에 없으므로 설정된 길이(short_len)를 사용합니다.
+ * * @return int 1: long header, 0: short header, -1: 잘못된 패킷
+ */
+static inline int qlb_packet_dcid(const uint8_t* pkt, size_t len, size_t short_len,
+                                  const uint8_t** dcid, size_t* dcid_len){
+    if (len < 1) return -1;
+
+    if (pkt[0] & 0x80) {
+        /* Long header: flags(1) + version(4) + dcid_len(1) + dcid */
+        if (len < 6) return -1;
+        size_t l = pkt[5];
+        if (l > QLB_CID_MAX || len < 6 + l) return -1;
+        *dcid = pkt + 6;
+        *dcid_len = l;
+        return 1;
+    }
+
+    if (len < 1 + short_len) return -1;
+    *dcid = pkt + 1;
+    *dcid_len = short_len;
+    return 0;
+}
+
+/**
+ * @brief 서버 ID를 해석할 수 없는 CID(Initial 등)를 위한 폴백 해시 (FNV-1a)
+ */
+static inline uint64_t qlb_hash(const uint8_t* b, size_t len){
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) { h ^= b[i]; h *= 1099511628211ULL; }
+    return h;
+}
+
+#endif /* QUIC_LB_H */
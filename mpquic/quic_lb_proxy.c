@@ -0,0 +1,315 @@
+// quic_lb_proxy.c — QUIC-LB CID 기반 참조용 UDP 로드밸런서 (로컬 테스트/수평 확장용)
+//
+//   client ──UDP──▶ [VIP :4433] ──(DCID → server id)──▶ server_recv --lb-server-id N
+//
+// 서버가 발급한 CID에는 서버 ID가 들어 있으므로(quic_lb.h), 멀티패스로 새 경로가 열리거나
+// 클라이언트 주소가 바뀌어도 같은 백엔드로 전달됩니다. 클라이언트 경로(주소:포트)마다
+// 백엔드 쪽 UDP 소켓을 하나씩 두어, 백엔드에서도 경로가 서로 구분되어 보이게 합니다.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "quic_lb.h"
+
+/* ============================================================
+ * [1] 설정 상수 및 구조체
+ * ============================================================ */
+
+#define LB_MAX_BACKENDS  16
+#define LB_MAX_FLOWS     1024            /* 동시 클라이언트 경로 수 */
+#define LB_PKT_MAX       2048
+#define LB_IDLE_US_DEFAULT (60ULL * 1000000ULL)
+#define LB_LOG_US        (5ULL * 1000000ULL)
+
+#define LBLOG(fmt, ...) fprintf(stderr, "[LB] " fmt "\n", ##__VA_ARGS__)
+
+/**
+ * @brief 서버 ID와 주소로 식별되는 백엔드(server_recv 인스턴스)입니다.
+ */
+typedef struct {
+    uint64_t server_id;
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    uint64_t pkts_fwd;
+} lb_backend_t;
+
+/**
+ * @brief 클라이언트 경로 1개 ↔ 백엔드 1개의 전달 흐름입니다.
+ */
+typedef struct {
+    int in_use;
+    struct sockaddr_storage cli;
+    socklen_t cli_len;
+    int be;                   /* 백엔드 인덱스 */
+    int fd;                   /* 백엔드로 connect된 UDP 소켓 */
+    uint64_t last_us;
+} lb_flow_t;
+
+static lb_backend_t g_be[LB_MAX_BACKENDS];
+static int g_nb_be;
+static lb_flow_t g_flows[LB_MAX_FLOWS];
+static uint64_t g_unrouted;   /* 서버 ID를 해석하지 못해 해시로 보낸 패킷 수 */
+
+
+/* ============================================================
+ * [2] 유틸리티
+ * ============================================================ */
+
+static uint64_t now_us(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static int addr_eq(const struct sockaddr_storage* a, const struct sockaddr_storage* b){
+    if (a->ss_family != b->ss_family) return 0;
+    if (a->ss_family == AF_INET) {
+        const struct sockaddr_in* x = (const struct sockaddr_in*)a;
+        const struct sockaddr_in* y = (const struct sockaddr_in*)b;
+        return x->sin_port == y->sin_port && x->sin_addr.s_addr == y->sin_addr.s_addr;
+    }
+    const struct sockaddr_in6* x = (const struct sockaddr_in6*)a;
+    const struct sockaddr_in6* y = (const struct sockaddr_in6*)b;
+    return x->sin6_port == y->sin6_port &&
+           memcmp(&x->sin6_addr, &y->sin6_addr, sizeof(x->sin6_addr)) == 0;
+}
+
+/**
+ * @brief "ID=HOST:PORT" 형식의 백엔드 지정을 해석합니다.
+ */
+static int parse_backend(const char* spec, lb_backend_t* be){
+    char host[256];
+    const char* eq = strchr(spec, '=');
+    const char* colon = strrchr(spec, ':');
+    if (!eq || !colon || colon < eq) return -1;
+
+    size_t hl = (size_t)(colon - eq - 1);
+    if (hl == 0 || hl >= sizeof(host)) return -1;
+    memcpy(host, eq + 1, hl);
+    host[hl] = '\0';
+
+    /* [::1] 형태의 IPv6 괄호 제거 */
+    char* h = host;
+    if (h[0] == '[' && h[hl - 1] == ']') { h[hl - 1] = '\0'; h++; }
+
+    struct addrinfo hints = {0}, *res = NULL;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(h, colon + 1, &hints, &res) != 0 || !res) return -1;
+
+    memset(be, 0, sizeof(*be));
+    be->server_id = strtoull(spec, NULL, 0);
+    memcpy(&be->addr, res->ai_addr, res->ai_addrlen);
+    be->addr_len = res->ai_addrlen;
+    freeaddrinfo(res);
+    return 0;
+}
+
+
+/* ============================================================
+ * [3] 라우팅 및 흐름 관리
+ * ============================================================ */
+
+/**
+ * @brief 패킷의 DCID로 백엔드를 고릅니다.
+ * 서버 ID가 설정된 백엔드와 일치하지 않으면(Initial의 클라이언트 선택 CID 등) DCID 해시로 고릅니다.
+ */
+static int route_packet(const qlb_cfg_t* cfg, const uint8_t* pkt, size_t len){
+    const uint8_t* dcid = NULL;
+    size_t dlen = 0;
+
+    if (qlb_packet_dcid(pkt, len, qlb_cid_len(cfg), &dcid, &dlen) < 0) return -1;
+
+    uint64_t sid;
+    if (qlb_decode(cfg, dcid, dlen, &sid) == 0) {
+        for (int i = 0; i < g_nb_be; i++) {
+            if (g_be[i].server_id == sid) return i;
+        }
+    }
+
+    /* 같은 Initial DCID는 항상 같은 백엔드로 가야 하므로 해시로 결정 */
+    g_unrouted++;
+    return (int)(qlb_hash(dcid, dlen) % (uint64_t)g_nb_be);
+}
+
+static lb_flow_t* flow_get(const struct sockaddr_storage* cli, socklen_t cli_len, int be, uint64_t now){
+    lb_flow_t* free_slot = NULL;
+
+    for (int i = 0; i < LB_MAX_FLOWS; i++) {
+        lb_flow_t* f = &g_flows[i];
+        if (!f->in_use) { if (!free_slot) free_slot = f; continue; }
+        if (f->be == be && addr_eq(&f->cli, cli)) return f;
+    }
+    if (!free_slot) return NULL;
+
+    int fd = socket(g_be[be].addr.ss_family, SOCK_DGRAM, 0);
+    if (fd < 0) return NULL;
+    if (connect(fd, (struct sockaddr*)&g_be[be].addr, g_be[be].addr_len) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    free_slot->in_use = 1;
+    free_slot->cli = *cli;
+    free_slot->cli_len = cli_len;
+    free_slot->be = be;
+    free_slot->fd = fd;
+    free_slot->last_us = now;
+
+    char hs[INET6_ADDRSTRLEN] = {0};
+    if (cli->ss_family == AF_INET)
+        inet_ntop(AF_INET, &((const struct sockaddr_in*)cli)->sin_addr, hs, sizeof(hs));
+    else
+        inet_ntop(AF_INET6, &((const struct sockaddr_in6*)cli)->sin6_addr, hs, sizeof(hs));
+    LBLOG("new flow %s → backend id=%" PRIu64, hs, g_be[be].server_id);
+    return free_slot;
+}
+
+static void flow_expire(uint64_t now, uint64_t idle_us){
+    for (int i = 0; i < LB_MAX_FLOWS; i++) {
+        lb_flow_t* f = &g_flows[i];
+        if (f->in_use && now - f->last_us > idle_us) {
+            close(f->fd);
+            f->in_use = 0;
+        }
+    }
+}
+
+
+/* ============================================================
+ * [4] CLI 도움말 및 메인 함수
+ * ============================================================ */
+
+static void usage(const char* argv0){
+    fprintf(stderr,
+        "Usage: %s --backend ID=HOST:PORT [--backend ...] [--port N]\n"
+        "          [--lb-config-id N] [--lb-sid-len N] [--lb-nonce-len N] [--idle-sec N]\n", argv0);
+}
+
+int main(int argc, char** argv)
+{
+    int port = 4433;
+    uint64_t idle_us = LB_IDLE_US_DEFAULT;
+    qlb_cfg_t cfg = { .config_id = 0, .sid_len = QLB_SID_LEN_DEFAULT, .nonce_len = QLB_NONCE_LEN_DEFAULT };
+
+    for (int i = 1; i < argc; i++){
+        if (!strcmp(argv[i], "--port") && i + 1 < argc){
+            port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--backend") && i + 1 < argc && g_nb_be < LB_MAX_BACKENDS){
+            if (parse_backend(argv[++i], &g_be[g_nb_be]) != 0) { usage(argv[0]); return -1; }
+            g_nb_be++;
+        } else if (!strcmp(argv[i], "--lb-config-id") && i + 1 < argc){
+            cfg.config_id = (uint8_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--lb-sid-len") && i + 1 < argc){
+            cfg.sid_len = (uint8_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--lb-nonce-len") && i + 1 < argc){
+            cfg.nonce_len = (uint8_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--idle-sec") && i + 1 < argc){
+            idle_us = (uint64_t)atoi(argv[++i]) * 1000000ULL;
+        } else {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (g_nb_be == 0 || qlb_cfg_check(&cfg) != 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    /* VIP 소켓 (IPv4/IPv6 듀얼 스택) */
+    int vfd = socket(AF_INET6, SOCK_DGRAM, 0);
+    int off = 0, one = 1;
+    setsockopt(vfd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    setsockopt(vfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in6 la = {0};
+    la.sin6_family = AF_INET6;
+    la.sin6_addr = in6addr_any;
+    la.sin6_port = htons((uint16_t)port);
+    if (vfd < 0 || bind(vfd, (struct sockaddr*)&la, sizeof(la)) != 0) {
+        LBLOG("bind :%d failed: %s", port, strerror(errno));
+        return -1;
+    }
+
+    LBLOG("listen UDP :%d backends=%d config_id=%u sid_len=%u cid_len=%zu",
+          port, g_nb_be, cfg.config_id, cfg.sid_len, qlb_cid_len(&cfg));
+
+    static struct pollfd pfd[1 + LB_MAX_FLOWS];
+    static int pidx[1 + LB_MAX_FLOWS];
+    uint8_t pkt[LB_PKT_MAX];
+    uint64_t last_log_us = now_us();
+
+    for (;;) {
+        /* 1. poll 대상 구성: VIP + 활성 흐름 소켓 */
+        int np = 0;
+        pfd[np].fd = vfd; pfd[np].events = POLLIN; pidx[np++] = -1;
+        for (int i = 0; i < LB_MAX_FLOWS; i++) {
+            if (!g_flows[i].in_use) continue;
+            pfd[np].fd = g_flows[i].fd; pfd[np].events = POLLIN; pidx[np++] = i;
+        }
+
+        int r = poll(pfd, (nfds_t)np, 1000);
+        if (r < 0 && errno != EINTR) break;
+
+        uint64_t now = now_us();
+
+        /* 2. 클라이언트 → 백엔드 */
+        if (r > 0 && (pfd[0].revents & POLLIN)) {
+            for (;;) {
+                struct sockaddr_storage cli;
+                socklen_t cl = sizeof(cli);
+                ssize_t n = recvfrom(vfd, pkt, sizeof(pkt), MSG_DONTWAIT, (struct sockaddr*)&cli, &cl);
+                if (n <= 0) break;
+
+                int be = route_packet(&cfg, pkt, (size_t)n);
+                if (be < 0) continue;
+
+                lb_flow_t* f = flow_get(&cli, cl, be, now);
+                if (!f) continue;
+
+                f->last_us = now;
+                if (send(f->fd, pkt, (size_t)n, 0) == n) g_be[be].pkts_fwd++;
+            }
+        }
+
+        /* 3. 백엔드 → 클라이언트 (VIP 주소로 응답) */
+        for (int k = 1; r > 0 && k < np; k++) {
+            if (!(pfd[k].revents & POLLIN)) continue;
+            lb_flow_t* f = &g_flows[pidx[k]];
+            for (;;) {
+                ssize_t n = recv(f->fd, pkt, sizeof(pkt), MSG_DONTWAIT);
+                if (n <= 0) break;
+                f->last_us = now;
+                sendto(vfd, pkt, (size_t)n, 0, (struct sockaddr*)&f->cli, f->cli_len);
+            }
+        }
+
+        /* 4. 유휴 흐름 정리 및 주기적 통계 */
+        if (now - last_log_us > LB_LOG_US) {
+            flow_expire(now, idle_us);
+            for (int i = 0; i < g_nb_be; i++) {
+                LBLOG("backend id=%" PRIu64 " fwd=%" PRIu64, g_be[i].server_id, g_be[i].pkts_fwd);
+            }
+            LBLOG("unrouted(hash)=%" PRIu64, g_unrouted);
+            last_log_us = now;
+        }
+    }
+
+    close(vfd);
+    return 0;
+}
@@ -61,10 +61,10 @@ static int stream_cb(picoquic_cnx_t* cnx, uint64_t sid, uint8_t* bytes, size_t l
             }
         }
 
-        /* 스트림 종료(FIN) 처리 */
+        /* 스트림 종료(FIN) 처리: 프레임 경계로 보고 슬롯 반환 (프레임별 스트림이면 프레임마다 발생) */
         if (ev == picoquic_callback_stream_fin) {
-            fa_stream_close(app, sid);
-            LOG_INF("[STREAM] FIN sid=%" PRIu64, sid);
+            fa_stream_fin(app, sid);
+            LOG_DBG("[STREAM] FIN sid=%" PRIu64, sid);
         }
 
         /* 최대 프레임 수신 제한 도달 시 연결 종료 */
@@ -76,8 +76,9 @@ static int stream_cb(picoquic_cnx_t* cnx, uint64_t sid, uint8_t* bytes, size_t l
     }
 
     case picoquic_callback_stream_reset:
-        fa_stream_close(app, sid);
-        LOG_WRN("[STREAM] RESET sid=%" PRIu64, sid);
+        /* 기한이 지나 클라이언트가 버린 프레임: 조립 중이던 데이터만 버림 (프레임별 스트림이면 흔함) */
+        fa_stream_reset(app, sid);
+        LOG_DBG("[STREAM] RESET sid=%" PRIu64, sid);
         return 0;
 
     case picoquic_callback_stop_sending:
@@ -85,6 +86,14 @@ static int stream_cb(picoquic_cnx_t* cnx, uint64_t sid, uint8_t* bytes, size_t l
         LOG_WRN("[STREAM] STOP_SENDING sid=%" PRIu64, sid);
         return 0;
 
+    case picoquic_callback_close:
+    case picoquic_callback_application_close:
+    case picoquic_callback_stateless_reset:
+        /* 연결 단위 상태 정리 (연결 주소가 새 연결에 재사용돼도 이전 태그·중복 기록을 물려받지 않도록) */
+        fa_cnx_close(app, cnx);
+        LOG_INF("[CONN] closed (ev=%d)", ev);
+        return 0;
+
     default:
         return 0;
     }
@@ -103,6 +112,7 @@ static int loop_cb(picoquic_quic_t* quic,
     app_ctx_t* app = (app_ctx_t*)cb_ctx;
 
     static uint64_t last_paths_dump_us = 0;
+    static uint64_t last_fair_dump_us = 0;
     static picoquic_state_enum last_state = (picoquic_state_enum)-1;
 
     if (cb_mode == picoquic_packet_loop_ready) {
@@ -156,6 +166,32 @@ static int loop_cb(picoquic_quic_t* quic,
         }
     }
 
+    /* 5초마다 클라이언트별 저장 큐 통계(공정 스케줄러) 출력 */
+    uint64_t now = picoquic_current_time();
+    if (now - last_fair_dump_us > 5 * 1000000ULL) {
+        fa_client_stat_t st[FA_MAX_CLIENTS];
+        int n = fa_client_stats(st, FA_MAX_CLIENTS);
+        for (int i = 0; i < n; i++) {
+            LOG_INF("[FAIR] client=%s queued=%" PRIu64 "/%" PRIu64 "B written=%" PRIu64 "/%" PRIu64 "B dropped=%" PRIu64 "/%" PRIu64 "B",
+                    st[i].tag, st[i].queued_frames, st[i].queued_bytes,
+                    st[i].written_frames, st[i].written_bytes,
+                    st[i].dropped_frames, st[i].dropped_bytes);
+        }
+        if (app->h264_aus || app->h264_dropped) {
+            LOG_INF("[H264] aus=%" PRIu64 " segments=%" PRIu64 " dropped=%" PRIu64 " gaps=%" PRIu64,
+                    app->h264_aus, app->h264_segments, app->h264_dropped, app->h264_gaps);
+        }
+        if (app->stripe_chunks) {
+            LOG_INF("[STRIPE] frames=%" PRIu64 " chunks=%" PRIu64 " dropped=%" PRIu64 " dup=%" PRIu64,
+                    app->stripe_frames, app->stripe_chunks, app->stripe_dropped, app->dup_dropped);
+        }
+        if (app->stream_fins || app->stream_resets) {
+            LOG_INF("[STREAM] fins=%" PRIu64 " truncated=%" PRIu64 " resets=%" PRIu64 " (discarded %" PRIu64 "B)",
+                    app->stream_fins, app->fin_truncated, app->stream_resets, app->reset_bytes);
+        }
+        last_fair_dump_us = now;
+    }
+
     /* 송수신 완료 후 2ms 뒤에 다시 깨어나도록 설정 (반응성 유지) */
     if (cb_mode == picoquic_packet_loop_after_receive ||
         cb_mode == picoquic_packet_loop_after_send)
@@ -178,7 +214,12 @@ static int loop_cb(picoquic_quic_t* quic,
 static void usage(const char* argv0){
     fprintf(stderr,
         "Usage: %s [--port N] [--cert path] [--key path] [--qlog] [--binlog]\n"
-        "          [--out DIR] [--max-frames N]\n", argv0);
+        "          [--out DIR] [--max-frames N] [--layout bucketed|flat]\n"
+        "          [--seg-sync none|interval(default)|frame] [--seg-sync-ms N]\n"
+        "          [--seg-direct] [--seg-roll-mb N]\n"
+        "          [--stage-dir DIR] [--stage-max-mb N] [--mover-mbps N]\n"
+        "          [--client-rate-mbps N] [--client-rate TAG=Mbps]... [--max-uni-streams N]\n"
+        "          [--lb-server-id N] [--lb-config-id N] [--lb-sid-len N] [--lb-nonce-len N]\n", argv0);
 }
 
 int main(int argc, char** argv)
@@ -188,12 +229,21 @@ int main(int argc, char** argv)
     const char* cert = DEFAULT_CERT;
     const char* key  = DEFAULT_KEY;
     int enable_qlog = 0, enable_binlog = 0;
+    int max_uni_streams = SVR_MAX_UNI_STREAMS;   /* 클라이언트가 동시에 열 수 있는 단방향 스트림 수 */
 
     app_ctx_t app; 
     memset(&app, 0, sizeof(app));
+
+    /* 세그먼트 라이터 설정 (기본: 1GB 롤링, 200ms 주기 그룹 fsync, 버퍼드 I/O) */
+    seg_writer_t w = { .fd = -1, .bytes_in_seg = 0, .sync_mode = SEG_SYNC_INTERVAL };
+    
+    /* QUIC-LB CID 설정 (--lb-server-id 지정 시 활성화) */
+    qlb_cfg_t lb = { .config_id = 0, .sid_len = QLB_SID_LEN_DEFAULT, .nonce_len = QLB_NONCE_LEN_DEFAULT };
+    int lb_on = 0;
     
     snprintf(app.out_dir, sizeof(app.out_dir), "%s", "frames_out");
     app.max_frames = 0; 
+    app.stage_max_bytes = 256ULL * 1024 * 1024;  /* 착륙 구역 기본 256MB */
 
     /* 1. 명령행 인자 파싱 */
     for (int i = 1; i < argc; i++){
@@ -211,14 +261,78 @@ int main(int argc, char** argv)
             snprintf(app.out_dir, sizeof(app.out_dir), "%s", argv[++i]);
         } else if (!strcmp(argv[i], "--max-frames") && i + 1 < argc){
             app.max_frames = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--layout") && i + 1 < argc){
+            const char* m = argv[++i];
+            if      (!strcmp(m, "bucketed")) app.layout = FA_LAYOUT_BUCKETED;
+            else if (!strcmp(m, "flat"))     app.layout = FA_LAYOUT_FLAT;
+            else { usage(argv[0]); return -1; }
+        } else if (!strcmp(argv[i], "--stage-dir") && i + 1 < argc){
+            snprintf(app.stage_dir, sizeof(app.stage_dir), "%s", argv[++i]);
+        } else if (!strcmp(argv[i], "--stage-max-mb") && i + 1 < argc){
+            app.stage_max_bytes = (uint64_t)atoi(argv[++i]) * 1024 * 1024;
+        } else if (!strcmp(argv[i], "--mover-mbps") && i + 1 < argc){
+            app.mover_rate_bps = (uint64_t)(atof(argv[++i]) * 1e6 / 8.0);
+        } else if (!strcmp(argv[i], "--client-rate-mbps") && i + 1 < argc){
+            app.client_rate_bps = (uint64_t)(atof(argv[++i]) * 1e6 / 8.0);
+        } else if (!strcmp(argv[i], "--client-rate") && i + 1 < argc){
+            char tag[FA_TAG_MAX];
+            const char* a = argv[++i];
+            const char* eq = strrchr(a, '=');
+            if (!eq || eq == a || (size_t)(eq - a) >= sizeof(tag)) { usage(argv[0]); return -1; }
+            memcpy(tag, a, (size_t)(eq - a));
+            tag[eq - a] = '\0';
+            fa_set_client_rate(tag, (uint64_t)(atof(eq + 1) * 1e6 / 8.0));
+        } else if (!strcmp(argv[i], "--lb-server-id") && i + 1 < argc){
+            lb.server_id = strtoull(argv[++i], NULL, 0);
+            lb_on = 1;
+        } else if (!strcmp(argv[i], "--lb-config-id") && i + 1 < argc){
+            lb.config_id = (uint8_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--lb-sid-len") && i + 1 < argc){
+            lb.sid_len = (uint8_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--lb-nonce-len") && i + 1 < argc){
+            lb.nonce_len = (uint8_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seg-sync") && i + 1 < argc){
+            const char* m = argv[++i];
+            if      (!strcmp(m, "none"))     w.sync_mode = SEG_SYNC_NONE;
+            else if (!strcmp(m, "interval")) w.sync_mode = SEG_SYNC_INTERVAL;
+            else if (!strcmp(m, "frame"))    w.sync_mode = SEG_SYNC_FRAME;
+            else { usage(argv[0]); return -1; }
+        } else if (!strcmp(argv[i], "--seg-sync-ms") && i + 1 < argc){
+            w.sync_interval_us = (uint64_t)atoi(argv[++i]) * 1000ULL;
+        } else if (!strcmp(argv[i], "--seg-direct")){
+            w.use_direct = 1;
+        } else if (!strcmp(argv[i], "--seg-roll-mb") && i + 1 < argc){
+            w.roll_bytes = (size_t)atoi(argv[++i]) * 1024 * 1024;
+        } else if (!strcmp(argv[i], "--max-uni-streams") && i + 1 < argc){
+            max_uni_streams = atoi(argv[++i]);
+            if (max_uni_streams < 16) max_uni_streams = 16;
         } else {
             usage(argv[0]);
             return -1;
         }
     }
     
-    LOGF("[SVR][MAIN] args: port=%d cert=%s key=%s out=%s max_frames=%d",
-         port, cert, key, app.out_dir, app.max_frames);
+    LOGF("[SVR][MAIN] args: port=%d cert=%s key=%s out=%s max_frames=%d layout=%s",
+         port, cert, key, app.out_dir, app.max_frames,
+         app.layout == FA_LAYOUT_FLAT ? "flat" : "bucketed");
+    if (app.stage_dir[0]) {
+        LOGF("[SVR][MAIN] tier: stage=%s max=%" PRIu64 "MB mover=%" PRIu64 "B/s",
+             app.stage_dir, app.stage_max_bytes >> 20, app.mover_rate_bps);
+    }
+    if (app.client_rate_bps) {
+        LOGF("[SVR][MAIN] fair: client_rate=%" PRIu64 "B/s", app.client_rate_bps);
+    }
+    if (lb_on) {
+        if (qlb_cfg_check(&lb) != 0) {
+            LOGF("[SVR][ERR] invalid QUIC-LB config (config_id<7, sid_len 1-8, nonce_len>=4, cid<=20)");
+            return -1;
+        }
+        LOGF("[SVR][MAIN] quic-lb: server_id=%" PRIu64 " config_id=%u sid_len=%u cid_len=%zu",
+             lb.server_id, lb.config_id, lb.sid_len, qlb_cid_len(&lb));
+    }
+    LOGF("[SVR][MAIN] streams: max_uni=%d", max_uni_streams);
+    LOGF("[SVR][MAIN] seg: sync=%d sync_ms=%" PRIu64 " direct=%d roll=%zu",
+         (int)w.sync_mode, w.sync_interval_us / 1000, w.use_direct, seg_roll_bytes(&w));
 
 
     /* 2. QUIC 컨텍스트 생성 */
@@ -226,7 +340,7 @@ int main(int argc, char** argv)
     
     picoquic_quic_t* quic = picoquic_create(
         64, cert, key, NULL, "hq",
-        stream_cb, &app, NULL, NULL, NULL,
+        stream_cb, &app, lb_on ? qlb_cid_cb : NULL, lb_on ? &lb : NULL, NULL,
         picoquic_current_time(), NULL, NULL, NULL, 1);
         
     if (!quic){
@@ -234,6 +348,11 @@ int main(int argc, char** argv)
         return -1;
     }
 
+    /* QUIC-LB: 로컬 CID 길이를 인코딩 길이에 맞춤 (short header 라우팅에 필요) */
+    if (lb_on) {
+        picoquic_set_default_connection_id_length(quic, (uint8_t)qlb_cid_len(&lb));
+    }
+
 
     /* 3. 전송 파라미터(TP) 설정 (서버 측) */
     picoquic_tp_t tp; 
@@ -253,7 +372,9 @@ int main(int argc, char** argv)
     tp.initial_max_stream_data_uni         = 128 * 1024 * 1024;
 
     tp.initial_max_stream_id_bidir  = 64;
-    tp.initial_max_stream_id_unidir = 64;
+    /* 프레임별 스트림 모드는 프레임마다 새 uni 스트림을 씀: 초기 한도를 넉넉히 주고,
+       닫힌 스트림만큼은 picoquic이 MAX_STREAMS로 계속 늘려 줌 */
+    tp.initial_max_stream_id_unidir = 4 * (uint64_t)max_uni_streams;
     
     /* 지연 감소를 위해 ACK 딜레이 최소화 */
     tp.max_ack_delay      = 0;  
@@ -263,7 +384,6 @@ int main(int argc, char** argv)
 
 
     /* 4. 비동기 저장 스레드(Writer) 시작 */
-    seg_writer_t w = { .fd = -1, .bytes_in_seg = 0 };
     snprintf(w.dir, sizeof(w.dir), "%s", app.out_dir);
     
     ensure_dir(w.dir);
@@ -289,6 +409,7 @@ int main(int argc, char** argv)
 
     rxq_close(&g_rxq);
     pthread_join(wth, NULL);
+    fa_flush_segments();
 
     picoquic_free(quic);
     LOGF("[SVR][MAIN] quic freed, exit ret=%d", ret);
@@ -13,6 +13,7 @@
 #define ONE_SEC_US   1000000ULL        /* 1초(us) */
 #define MAX_FRAME    (8 * 1024 * 1024) /* 단일 프레임 최대 제한 (8MB) */
 #define MAX_PRINTED  128               /* 로그 출력 관리용 커넥션 최대 수 */
+#define SVR_MAX_UNI_STREAMS 1024       /* 클라이언트 단방향 스트림 초기 한도 (프레임별 스트림 대비) */
 
 /**
  * @brief 연결(Connection)별 로그 출력 상태를 관리하는 구조체입니다.
@@ -189,4 +190,30 @@ static inline void dump_prefix(const uint8_t* p, size_t len, size_t n) {
     fprintf(stderr, "\n");
 }
 
+
+/* ============================================================
+ * [6] QUIC-LB 호환 CID 생성
+ * ============================================================ */
+
+/**
+ * @brief picoquic CID 콜백: 무작위 CID를 서버 ID가 담긴 QUIC-LB CID로 바꿉니다.
+ * 핸드셰이크 CID와 NEW_CONNECTION_ID로 발급되는 모든 CID에 적용되므로,
+ * 멀티패스로 추가된 경로나 이동(migration)한 경로도 같은 인스턴스로 라우팅됩니다.
+ */
+static inline void qlb_cid_cb(picoquic_quic_t* quic, picoquic_connection_id_t cnx_id_local,
+                              picoquic_connection_id_t cnx_id_remote, void* cnx_id_cb_data,
+                              picoquic_connection_id_t* cnx_id_returned)
+{
+    (void)quic; (void)cnx_id_remote;
+    const qlb_cfg_t* c = (const qlb_cfg_t*)cnx_id_cb_data;
+
+    /* picoquic이 만든 무작위 CID(같은 길이)의 뒷부분을 nonce로 재사용 */
+    size_t len = qlb_cid_len(c);
+    if (cnx_id_local.id_len < len) return;
+
+    *cnx_id_returned = cnx_id_local;
+    cnx_id_returned->id_len = (uint8_t)qlb_encode(c, cnx_id_local.id + (len - c->nonce_len),
+                                                  cnx_id_returned->id);
+}
+
 #endif /* SERVER_UTILS_H */
\ No newline at end of file
@@ -1,8 +1,13 @@
 #ifndef SERVER_WORKER_H
 #define SERVER_WORKER_H
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  /* fallocate, sync_file_range, O_DIRECT */
+#endif
+
 #include <sys/uio.h>
 #include <fcntl.h>
+#include <errno.h>
 #include "init.h"
 #include "server_utils.h"
 
@@ -39,6 +44,22 @@ typedef struct {
  * [2] 세그먼트 라이터(Segment Writer) 구조
  * ============================================================ */
 
+/* 세그먼트 기본 튜닝값 */
+#define SEG_ROLL_BYTES_DEFAULT  ((size_t)1 << 30)         /* 1GB마다 파일 롤링 */
+#define SEG_WB_CHUNK_DEFAULT    ((size_t)8 * 1024 * 1024) /* 8MB 단위 writeback */
+#define SEG_SYNC_US_DEFAULT     200000ULL                 /* 그룹 fsync 주기 200ms */
+#define SEG_DIO_ALIGN           4096                      /* O_DIRECT 정렬 단위 */
+#define SEG_STAGE_BYTES         ((size_t)1 << 20)         /* O_DIRECT 스테이징 버퍼 1MB */
+
+/**
+ * @brief 세그먼트 기록의 내구성(Durability) 수준입니다.
+ */
+typedef enum {
+    SEG_SYNC_NONE     = 0,  /* fsync 없음 (커널 writeback에 위임) */
+    SEG_SYNC_INTERVAL = 1,  /* 일정 주기마다 모아서 fdatasync (그룹 커밋) */
+    SEG_SYNC_FRAME    = 2,  /* 프레임 기록마다 fdatasync */
+} seg_sync_e;
+
 /**
  * @brief 데이터를 하나의 거대한 세그먼트 파일로 이어서 쓰는 라이터입니다.
  */
@@ -46,6 +67,23 @@ typedef struct {
     int fd;                /* 현재 오픈된 파일 디스크립터 */
     size_t bytes_in_seg;   /* 현재 세그먼트 파일에 기록된 총 바이트 */
     char dir[256];         /* 저장 디렉토리 경로 */
+
+    /* 설정값 (0이면 기본값 사용) */
+    size_t     roll_bytes;        /* 세그먼트 롤링 크기 (fallocate 선할당 크기) */
+    size_t     wb_chunk;          /* sync_file_range + DONTNEED 처리 단위 */
+    uint64_t   sync_interval_us;  /* SEG_SYNC_INTERVAL 모드의 fsync 주기 */
+    seg_sync_e sync_mode;         /* 내구성 모드 */
+    int        use_direct;        /* 1이면 O_DIRECT + 정렬 스테이징 버퍼 사용 */
+
+    /* 내부 상태 */
+    int      direct_on;           /* 현재 세그먼트가 실제로 O_DIRECT로 열렸는지 */
+    uint8_t* stage;               /* O_DIRECT용 정렬 버퍼 */
+    size_t   stage_len;           /* 스테이징 버퍼에 쌓인 바이트 */
+    size_t   disk_off;            /* 정렬 블록 단위로 확정 기록된 파일 오프셋 */
+    size_t   wb_issued;           /* 비동기 writeback을 시작한 위치 */
+    size_t   wb_done;             /* writeback 완료 + 페이지 캐시 반환된 위치 */
+    uint64_t last_sync_us;        /* 마지막 fdatasync 시각 */
+    int      dirty;               /* 마지막 fsync 이후 기록이 있었는지 */
 } seg_writer_t;
 
 /* 전역 수신 큐 초기화 */
@@ -118,6 +156,36 @@ static inline int rxq_pop(rx_queue_t* rq, rx_item_t* out) {
     return 0;
 }
 
+/**
+ * @brief rxq_pop과 같지만 timeout_us 동안 데이터가 없으면 1을 반환합니다.
+ * 그룹 fsync처럼 큐가 한가할 때도 주기 작업이 필요한 소비자용입니다.
+ */
+static inline int rxq_pop_timed(rx_queue_t* rq, rx_item_t* out, uint64_t timeout_us) {
+    struct timespec dl;
+    clock_gettime(CLOCK_REALTIME, &dl);
+    dl.tv_sec  += (time_t)(timeout_us / 1000000ULL);
+    dl.tv_nsec += (long)(timeout_us % 1000000ULL) * 1000L;
+    if (dl.tv_nsec >= 1000000000L) { dl.tv_sec++; dl.tv_nsec -= 1000000000L; }
+
+    pthread_mutex_lock(&rq->m);
+
+    while (rq->head == rq->tail && !rq->closed) {
+        if (pthread_cond_timedwait(&rq->cv, &rq->m, &dl) == ETIMEDOUT) break;
+    }
+
+    if (rq->head == rq->tail) {
+        int closed = rq->closed;
+        pthread_mutex_unlock(&rq->m);
+        return closed ? -1 : 1;
+    }
+
+    *out = rq->q[rq->tail];
+    rq->tail = (rq->tail + 1) % RXQ_CAP;
+
+    pthread_mutex_unlock(&rq->m);
+    return 0;
+}
+
 /**
  * @brief 수신 큐를 닫고 대기 중인 모든 스레드를 깨웁니다.
  */
@@ -155,8 +223,13 @@ static inline int ensure_cap(uint8_t** buf, size_t* cap, size_t need, size_t max
     return 0;
 }
 
+static inline size_t seg_roll_bytes(const seg_writer_t* w){
+    return w->roll_bytes ? w->roll_bytes : SEG_ROLL_BYTES_DEFAULT;
+}
+
 /**
  * @brief 새로운 세그먼트 파일을 생성하고 오픈합니다 (파일명: 날짜-시간 기반).
+ * ROLL 크기만큼 fallocate로 미리 블록을 확보해 기록 중 할당 지연을 없앱니다.
  */
 static inline int seg_open_new(seg_writer_t* w){
     time_t t = time(NULL);
@@ -169,27 +242,204 @@ static inline int seg_open_new(seg_writer_t* w){
     char path[512];
     snprintf(path, sizeof(path), "%s/frames_%s.seg", w->dir, stamp);
     
-    /* 파일 생성, 쓰기 전용, 이어쓰기 모드로 오픈 */
-    w->fd = open(path, O_CREAT | O_WRONLY | O_APPEND, 0644);
     w->bytes_in_seg = 0;
-    
-    return (w->fd >= 0) ? 0 : -1;
+    w->stage_len = 0;
+    w->disk_off = 0;
+    w->wb_issued = 0;
+    w->wb_done = 0;
+    w->dirty = 0;
+    w->direct_on = 0;
+
+    /* O_DIRECT 요청 시: 정렬 버퍼 확보 후 직접 오프셋 관리 (O_APPEND 미사용) */
+    if (w->use_direct) {
+        if (!w->stage && posix_memalign((void**)&w->stage, SEG_DIO_ALIGN, SEG_STAGE_BYTES) != 0) {
+            w->stage = NULL;
+        }
+        if (w->stage) {
+            w->fd = open(path, O_CREAT | O_WRONLY | O_DIRECT, 0644);
+            if (w->fd >= 0) {
+                w->direct_on = 1;
+            } else if (errno == EINVAL) {
+                /* tmpfs 등 O_DIRECT 미지원 파일시스템: 버퍼드 모드로 폴백 */
+                LOG_WRN("[SEG] O_DIRECT unsupported on %s, falling back to buffered", w->dir);
+            }
+        }
+    }
+
+    /* 파일 생성, 쓰기 전용, 이어쓰기 모드로 오픈 */
+    if (!w->direct_on) {
+        w->fd = open(path, O_CREAT | O_WRONLY | O_APPEND, 0644);
+    }
+    if (w->fd < 0) return -1;
+
+    /* 선할당: 파일 크기(i_size)는 그대로 두고 블록만 확보 (미지원 FS면 무시) */
+    if (fallocate(w->fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)seg_roll_bytes(w)) != 0 &&
+        errno != EOPNOTSUPP && errno != ENOSYS) {
+        LOG_WRN("[SEG] fallocate failed: %s", strerror(errno));
+    }
+
+    w->last_sync_us = picoquic_current_time();
+    return 0;
+}
+
+/**
+ * @brief O_DIRECT 스테이징 버퍼를 디스크로 내보냅니다.
+ * 정렬된 블록은 확정 기록하고, 남은 꼬리는 패딩해서 쓰되 다음 기록 때 같은 위치에 덮어씁니다.
+ */
+static inline int seg_direct_flush(seg_writer_t* w, int with_tail){
+    size_t full = w->stage_len & ~((size_t)SEG_DIO_ALIGN - 1);
+
+    if (full > 0) {
+        if (pwrite(w->fd, w->stage, full, (off_t)w->disk_off) != (ssize_t)full) return -1;
+        w->disk_off += full;
+        w->stage_len -= full;
+        if (w->stage_len) memmove(w->stage, w->stage + full, w->stage_len);
+    }
+
+    if (with_tail && w->stage_len > 0) {
+        memset(w->stage + w->stage_len, 0, SEG_DIO_ALIGN - w->stage_len);
+        if (pwrite(w->fd, w->stage, SEG_DIO_ALIGN, (off_t)w->disk_off) != SEG_DIO_ALIGN) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 세그먼트에 바이트를 이어 씁니다. (O_DIRECT면 스테이징 버퍼 경유)
+ */
+static inline int seg_write_iov(seg_writer_t* w, const struct iovec* iov, int n){
+    if (!w->direct_on) {
+        size_t want = 0;
+        for (int i = 0; i < n; i++) want += iov[i].iov_len;
+
+        ssize_t r = writev(w->fd, iov, n);
+        if (r > 0) w->bytes_in_seg += (size_t)r;
+        return (r == (ssize_t)want) ? 0 : -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        const uint8_t* p = (const uint8_t*)iov[i].iov_base;
+        size_t left = iov[i].iov_len;
+
+        while (left > 0) {
+            size_t room = SEG_STAGE_BYTES - w->stage_len;
+            size_t to = (left < room) ? left : room;
+
+            memcpy(w->stage + w->stage_len, p, to);
+            w->stage_len += to;
+            w->bytes_in_seg += to;
+            p += to;
+            left -= to;
+
+            if (w->stage_len == SEG_STAGE_BYTES && seg_direct_flush(w, 0) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 버퍼드 모드에서 더티 페이지를 일정 단위로 나눠 흘려보냅니다.
+ * 이전 구간의 writeback 완료를 기다린 뒤 DONTNEED로 페이지 캐시를 돌려주어
+ * 커널의 몰아치기(burst) flush로 writer가 멈추는 것을 막습니다.
+ */
+static inline void seg_writeback_smooth(seg_writer_t* w){
+    if (w->direct_on) return;
+
+    size_t chunk = w->wb_chunk ? w->wb_chunk : SEG_WB_CHUNK_DEFAULT;
+    if (w->bytes_in_seg - w->wb_issued < chunk) return;
+
+    /* 1) 새 구간의 비동기 writeback 시작 */
+    sync_file_range(w->fd, (off_t)w->wb_issued, (off_t)(w->bytes_in_seg - w->wb_issued),
+                    SYNC_FILE_RANGE_WRITE);
+
+    /* 2) 직전 구간은 완료를 기다린 후 캐시에서 제거 */
+    if (w->wb_issued > w->wb_done) {
+        sync_file_range(w->fd, (off_t)w->wb_done, (off_t)(w->wb_issued - w->wb_done),
+                        SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        posix_fadvise(w->fd, (off_t)w->wb_done, (off_t)(w->wb_issued - w->wb_done),
+                      POSIX_FADV_DONTNEED);
+        w->wb_done = w->wb_issued;
+    }
+    w->wb_issued = w->bytes_in_seg;
+}
+
+/**
+ * @brief 지금까지 기록한 내용을 디스크에 영속화합니다 (fdatasync).
+ */
+static inline void seg_sync_now(seg_writer_t* w, uint64_t now){
+    if (w->direct_on) seg_direct_flush(w, 1);
+    if (w->dirty) fdatasync(w->fd);
+    w->dirty = 0;
+    w->last_sync_us = now;
+}
+
+/**
+ * @brief 내구성 모드에 따라 필요하면 fsync를 수행합니다.
+ */
+static inline void seg_maybe_sync(seg_writer_t* w, uint64_t now){
+    if (!w->dirty) return;
+
+    switch (w->sync_mode) {
+    case SEG_SYNC_FRAME:
+        seg_sync_now(w, now);
+        break;
+    case SEG_SYNC_INTERVAL: {
+        uint64_t iv = w->sync_interval_us ? w->sync_interval_us : SEG_SYNC_US_DEFAULT;
+        if (now - w->last_sync_us >= iv) seg_sync_now(w, now);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief 세그먼트를 닫습니다. 남은 데이터를 내보내고 선할당/패딩 영역을 잘라냅니다.
+ */
+static inline void seg_close(seg_writer_t* w){
+    if (w->fd < 0) return;
+
+    if (w->direct_on) seg_direct_flush(w, 1);
+    if (w->sync_mode != SEG_SYNC_NONE && w->dirty) fdatasync(w->fd);
+
+    /* KEEP_SIZE로 잡아둔 여분 블록과 O_DIRECT 꼬리 패딩 반환 */
+    if (ftruncate(w->fd, (off_t)w->bytes_in_seg) != 0) {
+        LOG_WRN("[SEG] ftruncate failed: %s", strerror(errno));
+    }
+    close(w->fd);
+    w->fd = -1;
+    w->dirty = 0;
 }
 
 /**
  * @brief 디스크 기록을 전담하는 워커 스레드 함수입니다.
+ * g_rxq에 들어오는 레거시 수신 경로(server_legacy.h feed_bytes → on_frame_copy)의 프레임만 기록합니다.
+ * 세그먼트는 첫 항목을 꺼낼 때 열므로(선할당 포함), 이 경로를 쓰지 않는 서버는 파일을 만들지 않습니다.
  */
 static inline void* writer_thread(void* arg){
     seg_writer_t* w = (seg_writer_t*)arg;
-    const size_t ROLL = (size_t)1 << 30; /* 1GB마다 파일 롤링(새로 생성) */
-    
-    if (seg_open_new(w) != 0) return NULL;
+    const size_t ROLL = seg_roll_bytes(w); /* 기본 1GB마다 파일 롤링(새로 생성) */
+
+    /* 그룹 fsync 모드에서는 기록할 것이 남아 있는 동안만 주기적으로 깨어나면 됨 */
+    uint64_t wait_us = w->sync_interval_us ? w->sync_interval_us : SEG_SYNC_US_DEFAULT;
 
     while (1){
         rx_item_t it;
         
-        /* 큐에서 데이터 팝 (데이터가 들어올 때까지 블로킹됨) */
-        if (rxq_pop(&g_rxq, &it) != 0) break;
+        /* 큐에서 데이터 팝 (INTERVAL 모드는 더티일 때 주기마다 깨어나 fsync 처리) */
+        int pr = (w->sync_mode == SEG_SYNC_INTERVAL && w->dirty)
+                 ? rxq_pop_timed(&g_rxq, &it, wait_us)
+                 : rxq_pop(&g_rxq, &it);
+        if (pr < 0) break;
+        if (pr > 0) {
+            seg_maybe_sync(w, picoquic_current_time());
+            continue;
+        }
+
+        /* 첫 항목(또는 롤링 후 첫 항목)에서 세그먼트를 엶 */
+        if (w->fd < 0 && seg_open_new(w) != 0) {
+            free(it.buf);
+            break;
+        }
 
         /* 기록할 데이터 길이(Body Len) 헤더 준비 (4바이트) */
         uint32_t body_len = (uint32_t)it.len;
@@ -205,20 +455,24 @@ static inline void* writer_thread(void* arg){
             {(void*)it.buf, it.len} 
         };
         
-        (void)writev(w->fd, iov, 2);
-        w->bytes_in_seg += 4 + it.len;
+        if (seg_write_iov(w, iov, 2) != 0) {
+            LOG_WRN("[SEG] write failed: %s", strerror(errno));
+        }
+        w->dirty = 1;
 
         /* 기록 완료 후 버퍼 해제 */
         free(it.buf);
 
+        seg_writeback_smooth(w);
+        seg_maybe_sync(w, picoquic_current_time());
+
         /* 파일 크기가 ROLL 임계값을 넘으면 새로운 파일로 전환 */
-        if (w->bytes_in_seg >= ROLL){ 
-            close(w->fd); 
-            seg_open_new(w); 
-        }
+        if (w->bytes_in_seg >= ROLL) seg_close(w);   /* 다음 세그먼트는 다음 항목이 올 때 엶 */
     }
     
-    close(w->fd);
+    seg_close(w);
+    free(w->stage);
+    w->stage = NULL;
     return NULL;
 }
 